@@ -28,7 +28,9 @@
  * @details This program manupulates netPBM images.To run this program we
  * use command line arguments. The program will read the file mentioned
  * in the command line arguments. The input file can be a ascii or binary
- * file with the magic number of P6 or P3.
+ * file with the magic number of P6 or P3, a gray file with the magic
+ * number of P5 or P2, a P7 (PAM) file or a QOI file. Ascii files are
+ * parsed on all threads.
  * The data files with the extension .ppm are coloured the ones with
  * .pgm are grayscale. It will read in the option if
  * mentioned and try to implemend it .
@@ -39,10 +41,36 @@
  * Rotate counter clockwise
  * Convert image to grayscale
  * Convert image to Antique
+ * Resize the image with a box, bilinear or lanczos filter
+ * Make a thumbnail by shrinking the image while it is read
+ * Brightness, contrast, gamma, invert, threshold, posterize and levels
+ * Auto levels and histogram equalization
+ * Print the statistics of the image as JSON
+ * Compare two images and print the largest difference, PSNR and SSIM
+ * Run as a server taking jobs on a local socket
+ * Chains of per pixel steps done in a single pass
+ * Blur, sharpen or convolve the image with a custom kernel
+ * Rotate by any angle or warp with any affine matrix
+ * Sobel edges worked out on the gray values in the same pass
+ * Erode, dilate, open and close with rectangles of any size
+ * Median filter with a cost that does not grow with the radius
+ * Quantize to a palette or to a few levels, with dithering
+ * Blend a watermark with alpha from a P7 file at a place or tiled
+ * Convert between RGB and YCbCr or HSV, and write raw 4:4:4 or 4:2:0 planes
+ * Cache finished images and serve repeated work from the cache
+ * Write many outputs from one read of the image
+ * Read, compute and write at the same time for batches, and in strips
+ * of rows for per pixel options on a single binary image
+ * Decode, change and encode images in memory through the library
+ * interface in imageLibrary.h, without files
+ * Stream P5 and P6 video frames from standard input to standard output
  * If no options are mentioned, the program will go to write.
  * Writing options include
  * writing in integer form / ascii with the magic number P3 or P2
  * writing in binary form in with the magic number P5 or p6
+ * writing a lossless QOI file, coded in stripes on all threads
+ * Without an option, or with grayscale, the encoding is converted chunk by
+ * chunk in the same memory for any size of image
  * The program uses dynamically allocated memory and reads the data in this
  * 2D array. This program has a structure which stores all the data.
  * The program will check for the errors and output the required error
@@ -56,17 +84,89 @@
  * @section compile_section Compiling and Usage
  *
  * @par Compiling Instructions:
- *      None
+ *      The image code is built as the static library ImageManipulationLib,
+ *      the program only adds ProgramMain.cpp. Other programs link the
+ *      library and include imageLibrary.h
  *
  * @par Usage:
    @verbatim
 
    "C:\> theExam.exe [option] --outputtype basename image.ppm"
    "C:\> theExam.exe --outputtype basename image.ppm"
+   "C:\> theExam.exe --stats image.ppm"
+
+     --stats prints the histograms, min, max, mean and percentiles of
+     every channel as JSON
+
+   "C:\> theExam.exe --compare first.ppm second.ppm"
+
+     --compare prints the largest difference, MSE, PSNR and SSIM of
+     every channel as JSON. The exit code is 0 for the same pixels, 1
+     otherwise and 2 if the images have a different size or maxPixel
+     or cannot be read
+
+   "C:\> theExam.exe --serve socketpath [jobs]"
+
+     --serve runs as a server on a UNIX domain socket, taking up to jobs
+     jobs at once (one per hardware thread by default). See server.cpp
+     for the job protocol
+
+   "C:\> theExam.exe --cache=DIR[:MB] [option] --outputtype basename image.ppm"
+
+     --cache keeps finished images in DIR, keyed by a hash of the input
+     file, the option and the output type. A repeat of the same work is
+     served from DIR by a reflink, hard link or copy. The entries used
+     the longest time ago are removed when DIR is over MB (1024 by
+     default)
+
+   "C:\> theExam.exe --profile [option] --outputtype basename image.ppm"
+
+     --profile reads the file, does the option and writes the output as
+     usual and prints the time of each of them as JSON. On Linux it also
+     prints the cycles, instructions, IPC, branch misses and L1, last
+     level cache and TLB misses, in total and per pixel, of each of them.
+     Counters the system does not allow are null
+
+   "C:\> theExam.exe --cachestats DIR"
+
+     --cachestats prints the hits, misses, evictions and size of the
+     cache as JSON
+
+   "C:\> theExam.exe --batch option --outputtype outdir image.ppm [image.ppm ...]"
+
+     --batch handles every image with the same option, - is no option,
+     and writes outdir/name.ppm (or .pgm). The next image is read while
+     the current one is computed and the one before it is written
+
+   "C:\> theExam.exe --fanout --outputtype image.ppm basename option [basename option ...]"
+
+     --fanout reads the image once and writes basename.ppm (or .pgm) for
+     every basename and option pair, - is no option. The pairs run at the
+     same time and share the decoded image, a copy is only made for a
+     pair whose option changes the pixels
+
+   "C:\> theExam.exe --pyramid[=LEVELS] --outputtype basename image.ppm"
+
+     --pyramid writes basename_1.ppm, basename_2.ppm and on, every level
+     half the size of the one before it, until the image is one pixel or
+     LEVELS levels are written. The input is read once, a row at a time.
+     The output type is --binary or --ascii
+
+   "ffmpeg -i in.mp4 -f image2pipe -vcodec ppm - | theExam.exe --stream option --outputtype [frames]"
+
+     --stream reads P5 or P6 frames from standard input and writes every
+     frame with the option done to standard output, - is no option. Up to
+     frames frames are computed at the same time (1 by default) and the
+     output stays in order. Errors are printed on standard error
 
      output Type
      --ascii - integer text will be written to the file
      --binary - integer numbers will be written in binary form
+     --qoi - a lossless QOI file basename.qoi will be written
+     --planar - the three arrays as raw planes one after the other in
+                basename.yuv, with no header
+     --planar420 - like --planar with the last two planes averaged over
+                2 X 2 blocks, the yuv420p layout after a ycbcr step
 
      Option code
      --flipX      flip the image on the X axis
@@ -75,6 +175,56 @@
      --rotateCCW  Rotate the image counter clockwise
      --grarscale  Convert image to grayscale
      --sepia      convert image to sepia
+     --resize=WxH[:filter]  resize to W columns and H rows using the box,
+                  bilinear or lanczos filter (box if none is given)
+     --thumbnail=N  shrink the image by a whole number N while it is
+                  being read, the full size image is never stored
+     --tone=OP[,OP...]  tonal operations composed into one look up table
+                  and applied while reading. OP is brightness=N,
+                  contrast=F, gamma=G, invert, threshold=T, posterize=N
+                  or levels=LOW-HIGH. Prefix an OP with r. g. or b. to
+                  change only that channel
+     --autolevels stretch every channel so the darkest and brightest
+                  0.5% of its pixels become 0 and 255
+     --equalize   equalize the histogram of every channel
+     --chain=STEP[+STEP...]  per pixel steps done in one pass over the
+                  image. STEP is sepia, grayscale, matrix=A,B,C,D,E,F,G,H,I
+                  (a color matrix row by row) or any tone OP. A chain that
+                  ends with grayscale is written as a .pgm. The color space
+                  steps are ycbcr[=601|709][:full|:limited] and hsv, with
+                  fromycbcr and fromhsv to go back to RGB. Y, Cb, Cr or H,
+                  S, V are kept in the red, green and blue arrays
+     --blur=SIGMA[:border]  gaussian blur with the given sigma
+     --sharpen[=AMOUNT][:border]  sharpen the image, amount defaults to 1
+     --convolve=1,2,1/2,4,2/1,2,1[:border]  convolve with a square kernel,
+                  rows split by / and entries by a comma. The border is
+                  clamp, mirror, wrap or zero (clamp if none is given)
+     --rotate=DEG[:filter][:border]  rotate DEG degrees clockwise around
+                  the center, keeping the size of the image
+     --affine=a,b,c,d,e,f[:filter][:border]  move the pixel x, y to
+                  a x + b y + c, d x + e y + f. The filter is nearest or
+                  bilinear (bilinear if none is given) and the border is
+                  zero if none is given
+     --edges[=THRESHOLD][:border]  Sobel edges of the gray image, written
+                  as a .pgm. With a threshold the edges are 255 and the
+                  rest is 0
+     --erode=WxH, --dilate=WxH, --open=WxH, --close=WxH  minimum, maximum,
+                  opening or closing over a W X H rectangle, or N X N for
+                  a single number N. The cost does not grow with the size
+     --median=RADIUS[:border]  median of the square of 2 RADIUS + 1 pixels
+                  around each pixel, RADIUS up to 127. The cost does not
+                  grow with the radius
+     --quantize=N[:kmeans|:mediancut][:nodither]  reduce to a palette of N
+                  colors with Floyd-Steinberg dithering, 2 to 256 colors
+     --quantize=grayN[:nodither]  N levels of gray, written as a .pgm with
+                  a maxPixel of N - 1
+     --quantize=rgbN[:nodither]  N levels of each of red, green and blue,
+                  written with a maxPixel of N - 1
+     --overlay=X,Y:FILE  blend the watermark FILE with its top left corner
+                  at column X, row Y. The alpha comes from a P7 file with
+                  GRAYSCALE_ALPHA or RGB_ALPHA, other files are opaque.
+                  Only the pixels under the watermark are touched
+     --overlay=tile:FILE  repeat the watermark FILE over the whole image
 
    @endverbatim
  * @section todo_bugs_modification_section Todo, Bugs, and Modifications
@@ -91,6 +241,15 @@
  *
  ***********************************************************************/
 #include"netPBM.h"
+#include"pixelOps.h"
+
+/************************************************************************
+ *             Constants
+ ***********************************************************************/
+ /*!
+  * @brief size of the cache in MB when --cache does not give one
+  */
+const unsigned long long DEFAULT_CACHE_MB = 1024;
 
 
 
@@ -135,206 +294,251 @@ int main(int argc, char** argv)
 {
     ifstream fin;
     ofstream fout;
-    bool isInput, isOutput, read;
-    image img;
+    image img{};
     int maxPixel;
-    string output;
-
-    //check if the number of command line arguments are correct
-    if (argc != 5 && argc != 4)
-    {
-        //output an error message
-        printUsage();
-        return 0;
-    }
-    //open the input file
-    isInput = isBinFileOpen(string(argv[argc - 1]), fin);
+    string output, cache;
+    unsigned long long cacheBytes = DEFAULT_CACHE_MB << 20;
+    size_t colon;
+    bool profile = false;
 
-    //if grayscale, add .pgm extension to the output file name
-    if (string(argv[argc - 4]) == "--grayscale")
+    //run as a server taking jobs on a local socket
+    if ((argc == 3 || argc == 4) && string(argv[1]) == "--serve")
     {
-        output = string(argv[argc - 2]) + ".pgm";
+        return runServer(string(argv[2]), argc == 4 ? atoi(argv[3]) : threadCount());
     }
 
-    //else add .ppm
-    else
+    //print the statistics of the image as JSON
+    if (argc == 3 && string(argv[1]) == "--stats")
     {
-        output = string(argv[argc - 2]) + ".ppm";
+        try
+        {
+            printStats(string(argv[2]));
+        }
+        catch (exception& error)
+        {
+            cout << error.what() << endl;
+        }
+        return 0;
     }
 
-
-    //check the outpute type in the command line arguments
-    if (string(argv[argc - 3]) == "--binary" || string(argv[argc - 3]) == "--ascii")
+    //compare two images and print how much they differ as JSON
+    if (argc == 4 && string(argv[1]) == "--compare")
     {
-        isOutput = isBinOutputOpen(output, fout);
+        try
+        {
+            return printCompare(string(argv[2]), string(argv[3])) ? 0 : 1;
+        }
+        catch (exception& error)
+        {
+            cout << error.what() << endl;
+        }
+        return 2;
     }
 
-    else
+    //read the image once and write one output per basename and option
+    if (argc >= 6 && argc % 2 == 0 && string(argv[1]) == "--fanout")
     {
-        //print usage error
-        printUsage();
-        exit(0);
+        vector<string> basenames, options;
+        for (int i = 4; i < argc; i += 2)
+        {
+            basenames.push_back(string(argv[i]));
+            options.push_back(string(argv[i + 1]));
+        }
+        try
+        {
+            runFanout(string(argv[2]), string(argv[3]), basenames, options);
+        }
+        catch (invalid_argument&)
+        {
+            printUsage();
+        }
+        catch (exception& error)
+        {
+            cout << error.what() << endl;
+        }
+        return 0;
     }
 
-
-    if (isInput && isOutput)
+    //write every level of a pyramid in one pass of the input
+    if (argc == 5 && string(argv[1]).compare(0, 9, "--pyramid") == 0)
     {
-        //read file
-        read = readFile(fin, img, maxPixel);
-
-        //handle options
-        if (argc == 5)
+        try
         {
-            handleOptions(string(argv[argc - 4]), img);
+            runPyramid(string(argv[1]), string(argv[2]), string(argv[3]), string(argv[4]));
         }
-
-        //handle output
-        handleOutput(string(argv[argc - 4]), string(argv[argc - 3]), img, fout, maxPixel);
+        catch (invalid_argument&)
+        {
+            printUsage();
+        }
+        catch (exception& error)
+        {
+            cout << error.what() << endl;
+        }
+        return 0;
     }
-    //clear the temp arrays
-    clearArray(img.redGray, img.rows);
-    clearArray(img.green, img.rows);
-    clearArray(img.blue, img.rows);
-
-
-    //close the files
-    fin.close();
-    fout.close();
-
-
-    //return 0
-    return 0;
-}
-
-
-/** *********************************************************************
- * @author Niven Fernandes
- *
- * @par Description:
- * According to the string passed, this function will call the appropriate
- * image manupulation function. The strucure is passed by reference.
- *
- * @param[in] option - the image manupulation option
- * @param[in,out] img - the structure that has the data that will be modified
- *
- *
- * @par Example:
-   @verbatim
-
-   image img;
-
-    handleOptions("--sepia" , img);
-    //this function will call the sepia function and the sepia functions
-   // will modify the data of the image to sepia
-
-   @endverbatim
 
- ***********************************************************************/
-void handleOptions(string option, image& img)
-{
-    //if option is --rotataCW , call rotateImageCW function
-    if (option == "--rotateCW")
+    //stream frames from standard input to standard output
+    if ((argc == 4 || argc == 5) && string(argv[1]) == "--stream")
     {
-        rotateImageCW(img);
+        try
+        {
+            runStream(string(argv[2]), string(argv[3]), argc == 5 ? atoi(argv[4]) : 1);
+        }
+        catch (invalid_argument&)
+        {
+            printUsage();
+        }
+        catch (exception& error)
+        {
+            cerr << error.what() << endl;
+        }
+        return 0;
     }
 
-    //else if option is --rotataCCW , call rotateImageCCW function
-    else if (option == "--rotateCCW")
+    //handle a batch of images with reading, computing and writing overlapped
+    if (argc >= 6 && string(argv[1]) == "--batch")
     {
-        rotateImageCCW(img);
+        try
+        {
+            runBatch(string(argv[2]), string(argv[3]), string(argv[4]),
+                vector<string>(argv + 5, argv + argc));
+        }
+        catch (invalid_argument&)
+        {
+            printUsage();
+        }
+        catch (exception& error)
+        {
+            cout << error.what() << endl;
+        }
+        return 0;
     }
 
-    //else if option is --flipX, call flipX function
-    else if (option == "--flipX")
+    //print the counters of the cache as JSON
+    if (argc == 3 && string(argv[1]) == "--cachestats")
     {
-        flipX(img);
+        try
+        {
+            printCacheStats(string(argv[2]));
+        }
+        catch (exception& error)
+        {
+            cout << error.what() << endl;
+        }
+        return 0;
     }
 
-    //else if option is --flipY, call flipY function
-    else if (option == "--flipY")
+    //keep finished images in a cache directory, the size is in MB
+    if (argc > 1 && string(argv[1]).compare(0, 8, "--cache=") == 0)
     {
-        flipY(img);
+        cache = string(argv[1]).substr(8);
+        colon = cache.rfind(':');
+        if (colon != string::npos && colon + 1 < cache.size() &&
+            cache.find_first_not_of("0123456789", colon + 1) == string::npos)
+        {
+            cacheBytes = strtoull(cache.c_str() + colon + 1, nullptr, 10) << 20;
+            cache.erase(colon);
+        }
+        argc--;
+        argv++;
     }
 
-    //else if option is --grayscale call grayscale function
-    else if (option == "--grayscale")
+    //measure every stage with hardware counters and print them as JSON
+    if (argc > 1 && cache == "" && string(argv[1]) == "--profile")
     {
-        grayScale(img);
+        profile = true;
+        argc--;
+        argv++;
     }
 
-    //else if option is --sepia, call sepia function
-    else if (option == "--sepia")
+    //check if the number of command line arguments are correct
+    if (argc != 5 && argc != 4)
     {
-        sepia(img);
+        //output an error message
+        printUsage();
+        return 0;
     }
-
-    else
+    //check the outpute type in the command line arguments
+    if (!isOutputType(string(argv[argc - 3])))
     {
+        //print usage error
         printUsage();
-        exit(0);
+        return 0;
     }
-}
 
+    //add .qoi for a QOI file, .yuv for planes, .pgm if grayscale, else .ppm
+    output = string(argv[argc - 2]) + outputExtension(string(argv[argc - 4]),
+        string(argv[argc - 3]));
 
-/** *********************************************************************
- * @author Niven Fernandes
- *
- * @par Description:
- * According to the option string and the output type string passed to this
- * function, this function will call the approprite function to write the
- * data to the array. we pass the structure, output stream and the maxPixel
- * to this function.
- *
- * @param[in] option - the image manupulation option
- * @param[in] type - the image output type
- * @param[in] img - the structure having the data
- * @param[out] fout - the output stream
- * @param[in] maxPixel -  the maximum pixel in the file
- *
- *
- * @par Example:
-   @verbatim
-   ofstream fout;
-   image img;
-   int maxPixel=255;
-
-   handleOutput("--sepia", "--binary",img, fout, int maxPixel)
-   //this function will call writeFileP6(fout, img, maxpixel)
-   //to write the data to the file
-
-   @endverbatim
-
- ***********************************************************************/
-void handleOutput(string option, string type, image img, ofstream& fout, int maxPixel)
-{
-    //check if option is --grayscale
-    if (option == "--grayscale")
+    try
     {
-        //if grayscale, call P5 or P2 functions according to the option string
-        if (type == "--binary")
+        //the stages are measured one at a time
+        if (profile)
         {
-            writeGrayP5(fout, img, maxPixel);
+            runProfile(argc == 5 ? string(argv[argc - 4]) : "", string(argv[argc - 3]),
+                string(argv[argc - 1]), output);
         }
 
-        else if (type == "--ascii")
+        //a finished image may already be in the cache
+        else if (cache != "")
+        {
+            runCached(cache, cacheBytes, argc == 5 ? string(argv[argc - 4]) : "",
+                string(argv[argc - 3]), string(argv[argc - 1]), output);
+        }
+        else
         {
-            writeGrayP2(fout, img, maxPixel);
+            //open the input and the output file
+            isBinFileOpen(string(argv[argc - 1]), fin);
+            isBinOutputOpen(output, fout);
+
+            //a change of encoding goes straight from input to output,
+            //per pixel options on a binary file are done in strips with
+            //reading, computing and writing overlapped
+            if (!transcodeImage(fin, fout, argc == 5 ? string(argv[argc - 4]) : "",
+                string(argv[argc - 3])) &&
+                !pipeStrips(fin, fout, argc == 5 ? string(argv[argc - 4]) : "",
+                string(argv[argc - 3])))
+            {
+                //read the file and handle the option
+                processImage(fin, argc == 5 ? string(argv[argc - 4]) : "", img, maxPixel);
+
+                //handle output
+                handleOutput(string(argv[argc - 4]), string(argv[argc - 3]), img, fout, maxPixel);
+            }
         }
     }
 
-
-    //if type is --ascii, call writeP3
-    else if (type == "--ascii")
+    //a bad option prints the usage statement
+    catch (invalid_argument&)
     {
-        writeFileP3(fout, img, maxPixel);
+        printUsage();
     }
 
+    //a file that cannot be opened or read prints what was wrong with it
+    catch (runtime_error& error)
+    {
+        cout << error.what() << endl;
+    }
 
-    //if type is --ascii, call writeP6
-    else if (type == "--binary")
+    //not enough memory for the image
+    catch (bad_alloc&)
     {
-        writeFileP6(fout, img, maxPixel);
+        cout << "Unable to allocate memory" << endl;
     }
+
+    //clear the temp arrays
+    clearArray(img.redGray, img.rows);
+    clearArray(img.green, img.rows);
+    clearArray(img.blue, img.rows);
+
+
+    //close the files
+    fin.close();
+    fout.close();
+
+
+    //return 0
+    return 0;
 }
 
 
@@ -370,12 +574,25 @@ void printUsage()
 
     //print the usage error statement
     cout << "Usage:thpExam1.exe [option] --outputtype basename image.ppm" << endl;
+    cout << "      thpExam1.exe --stats image.ppm" << endl;
+    cout << "      thpExam1.exe --compare first.ppm second.ppm" << endl;
+    cout << "      thpExam1.exe --serve socketpath [jobs]" << endl;
+    cout << "      thpExam1.exe --cache=DIR[:MB] [option] --outputtype basename image.ppm" << endl;
+    cout << "      thpExam1.exe --profile [option] --outputtype basename image.ppm" << endl;
+    cout << "      thpExam1.exe --cachestats DIR" << endl;
+    cout << "      thpExam1.exe --batch option --outputtype outdir image.ppm [image.ppm ...]" << endl;
+    cout << "      thpExam1.exe --fanout --outputtype image.ppm basename option [basename option ...]" << endl;
+    cout << "      thpExam1.exe --pyramid[=LEVELS] --outputtype basename image.ppm" << endl;
+    cout << "      thpExam1.exe --stream option --outputtype [frames] < frames.ppm > out.ppm" << endl;
     cout << endl;
 
     cout << "Output Type" << endl;
     cout << endl;
     cout << "       --ascii            integer text numbers will be written for the data" << endl;
     cout << "       --binary            integer numbers will be written in binary form" << endl;
+    cout << "       --qoi              a lossless QOI file will be written" << endl;
+    cout << "       --planar           raw planes will be written as a .yuv" << endl;
+    cout << "       --planar420        raw planes with 4:2:0 chroma, a .yuv" << endl;
 
     cout << endl;
 
@@ -387,5 +604,36 @@ void printUsage()
     cout << "       --roatateCCW       Rotate the image counter clockwise" << endl;
     cout << "       --grayscale        Convert image to grayscale" << endl;
     cout << "       --sepia            Antique a color image" << endl;
+    cout << "       --resize=WxH[:filter]  Resize to W columns and H rows," << endl;
+    cout << "                          filter is box, bilinear or lanczos" << endl;
+    cout << "       --thumbnail=N      Shrink by N while reading the file" << endl;
+    cout << "       --tone=OP[,OP...]  Tonal operations done as one table," << endl;
+    cout << "                          OP is brightness=N, contrast=F, gamma=G," << endl;
+    cout << "                          invert, threshold=T, posterize=N or" << endl;
+    cout << "                          levels=LOW-HIGH, r. g. or b. before an OP" << endl;
+    cout << "                          changes only that channel" << endl;
+    cout << "       --autolevels       Stretch every channel to the full range" << endl;
+    cout << "       --equalize         Equalize the histogram of every channel" << endl;
+    cout << "       --chain=STEP[+STEP...]  Per pixel steps done in one pass," << endl;
+    cout << "                          STEP is sepia, grayscale, matrix=9 numbers" << endl;
+    cout << "                          or a tone OP, color spaces are" << endl;
+    cout << "                          ycbcr[=601|709][:full|:limited], hsv," << endl;
+    cout << "                          fromycbcr[=...] and fromhsv" << endl;
+    cout << "       --blur=SIGMA[:border]  Gaussian blur" << endl;
+    cout << "       --sharpen[=AMOUNT][:border]  Sharpen the image" << endl;
+    cout << "       --convolve=1,2,1/2,4,2/1,2,1[:border]  Custom kernel," << endl;
+    cout << "                          border is clamp, mirror, wrap or zero" << endl;
+    cout << "       --rotate=DEG[:filter][:border]  Rotate DEG degrees clockwise" << endl;
+    cout << "       --affine=a,b,c,d,e,f[:filter][:border]  Move x, y to" << endl;
+    cout << "                          ax+by+c, dx+ey+f, filter is nearest or" << endl;
+    cout << "                          bilinear, the border is zero by default" << endl;
+    cout << "       --edges[=THRESHOLD][:border]  Sobel edges, written as gray" << endl;
+    cout << "       --erode=WxH, --dilate=WxH, --open=WxH, --close=WxH" << endl;
+    cout << "                          Morphology with a W X H rectangle" << endl;
+    cout << "       --median=RADIUS[:border]  Median filter, RADIUS up to 127" << endl;
+    cout << "       --quantize=[gray|rgb]N[:kmeans|:mediancut][:nodither]" << endl;
+    cout << "                          Reduce to N colors or levels, dithered" << endl;
+    cout << "       --overlay=X,Y:FILE, --overlay=tile:FILE  Blend a watermark," << endl;
+    cout << "                          with alpha from a P7 file" << endl;
 
 }
\ No newline at end of file
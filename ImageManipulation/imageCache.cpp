@@ -0,0 +1,717 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Cache of finished images keyed by the input and the option
+ *
+ * @par Layout:
+ * Every finished image is kept in the cache directory as
+   @verbatim
+   <hash of the input>-<hash of the option and type>.ppm (or .pgm, .qoi, .yuv)
+   @endverbatim
+ * The entries are read only. An output is a reflink or a copy of its
+ * entry, never a hard link, so writing to the output later can not
+ * change the entry. The file counters holds the number of hits, misses
+ * and evictions. The modified time of an entry is its last use, the
+ * oldest entries are removed first when the cache is over its size.
+ ***********************************************************************/
+#include "netPBM.h"
+#include "imageLibrary.h"
+#include <cstring>
+#include <cstdio>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+#endif
+
+/************************************************************************
+ *             Constants
+ ***********************************************************************/
+ /*!
+  * @brief changed when the output of an option changes, so old entries
+  *        are no longer found
+  */
+const unsigned long long CACHE_VERSION = 1;
+
+/*!
+ * @brief the primes of the 64 bit xxHash
+ */
+const unsigned long long HASH_PRIME[5] =
+{
+    11400714785074694791ULL, 14029467366897019727ULL, 1609587929392839161ULL,
+    9650029242287828579ULL, 2870177450012600261ULL
+};
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * These functions are the steps of the 64 bit xxHash. rotateLeft rotates
+ * the bits, hashRound mixes 8 bytes into a lane, hashMerge folds a lane
+ * into the hash and readWord reads 8 or 4 bytes in little endian order.
+ *
+ * @par Example:
+   @verbatim
+
+   lane = hashRound(lane, readWord(data, 8));
+
+   @endverbatim
+
+ ***********************************************************************/
+static unsigned long long rotateLeft(unsigned long long value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static unsigned long long hashRound(unsigned long long lane, unsigned long long input)
+{
+    lane += input * HASH_PRIME[1];
+    return rotateLeft(lane, 31) * HASH_PRIME[0];
+}
+
+static unsigned long long hashMerge(unsigned long long hash, unsigned long long lane)
+{
+    hash ^= hashRound(0, lane);
+    return hash * HASH_PRIME[0] + HASH_PRIME[3];
+}
+
+static unsigned long long readWord(const unsigned char* data, int bytes)
+{
+    unsigned long long value = 0;
+    int k;
+
+    for (k = bytes - 1; k >= 0; k--)
+    {
+        value = (value << 8) | data[k];
+    }
+    return value;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function computes the 64 bit xxHash of the bytes. Four lanes take
+ * 32 bytes a time so the hash runs at memory speed, and the result is the
+ * same as the reference xxHash64.
+ *
+ * @param[in] data - the bytes
+ * @param[in] size - the number of bytes
+ * @param[in] seed - the starting value of the hash
+ *
+ * @returns the hash
+ *
+ * @par Example:
+   @verbatim
+
+   unsigned long long hash = hashBytes("", 0, 0);
+   //hash is 0xEF46DB3751D8E999
+
+   @endverbatim
+
+ ***********************************************************************/
+unsigned long long hashBytes(const void* data, size_t size, unsigned long long seed)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    const unsigned char* end = p + size;
+    unsigned long long lane[4], hash;
+    int k;
+
+    if (size >= 32)
+    {
+        lane[0] = seed + HASH_PRIME[0] + HASH_PRIME[1];
+        lane[1] = seed + HASH_PRIME[1];
+        lane[2] = seed;
+        lane[3] = seed - HASH_PRIME[0];
+
+        for (; end - p >= 32; p += 32)
+        {
+            for (k = 0; k < 4; k++)
+            {
+                lane[k] = hashRound(lane[k], readWord(p + k * 8, 8));
+            }
+        }
+
+        hash = rotateLeft(lane[0], 1) + rotateLeft(lane[1], 7) +
+            rotateLeft(lane[2], 12) + rotateLeft(lane[3], 18);
+        for (k = 0; k < 4; k++)
+        {
+            hash = hashMerge(hash, lane[k]);
+        }
+    }
+    else
+    {
+        hash = seed + HASH_PRIME[4];
+    }
+
+    hash += size;
+
+    //the bytes left over after the 32 byte blocks
+    for (; end - p >= 8; p += 8)
+    {
+        hash ^= hashRound(0, readWord(p, 8));
+        hash = rotateLeft(hash, 27) * HASH_PRIME[0] + HASH_PRIME[3];
+    }
+    if (end - p >= 4)
+    {
+        hash ^= readWord(p, 4) * HASH_PRIME[0];
+        hash = rotateLeft(hash, 23) * HASH_PRIME[1] + HASH_PRIME[2];
+        p += 4;
+    }
+    for (; p < end; p++)
+    {
+        hash ^= *p * HASH_PRIME[4];
+        hash = rotateLeft(hash, 11) * HASH_PRIME[0];
+    }
+
+    //mix the bits so every input bit changes every output bit
+    hash ^= hash >> 33;
+    hash *= HASH_PRIME[1];
+    hash ^= hash >> 29;
+    hash *= HASH_PRIME[2];
+    hash ^= hash >> 32;
+    return hash;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function writes an option the same way every time it means the
+ * same thing, so equal work shares a cache entry. Defaults that were
+ * written out are removed and a chain of one sepia or grayscale step
+ * becomes the plain option.
+ *
+ * @param[in] option - the image manupulation option
+ *
+ * @returns the option in its short form
+ *
+ * @par Example:
+   @verbatim
+
+   string key = normalizeOption("--resize=640x480:box");
+   //key is --resize=640x480
+
+   @endverbatim
+
+ ***********************************************************************/
+string normalizeOption(string option)
+{
+    size_t end;
+
+    if (option == "--chain=sepia" || option == "--chain=grayscale")
+    {
+        return "--" + option.substr(8);
+    }
+
+    //the default filter of a resize and border of a filter
+    end = option.size();
+    if (option.compare(0, 9, "--resize=") == 0 && end > 4 &&
+        option.compare(end - 4, 4, ":box") == 0)
+    {
+        option.erase(end - 4);
+    }
+    else if ((option.compare(0, 7, "--blur=") == 0 ||
+        option.compare(0, 9, "--sharpen") == 0 ||
+        option.compare(0, 11, "--convolve=") == 0) && end > 6 &&
+        option.compare(end - 6, 6, ":clamp") == 0)
+    {
+        option.erase(end - 6);
+    }
+
+    //the default amount of a sharpen
+    if (option == "--sharpen=1")
+    {
+        option = "--sharpen";
+    }
+
+    return option;
+}
+
+
+#ifndef _WIN32
+
+/************************************************************************
+ *             Structure
+ ***********************************************************************/
+ /**
+ * @brief One finished image in the cache directory
+ */
+struct cacheEntry
+{
+    /**
+    * @brief the path of the entry
+    */
+    string path;
+    /**
+    * @brief the size of the entry in bytes
+    */
+    unsigned long long size;
+    /**
+    * @brief the last time the entry was used, in nanoseconds
+    */
+    long long used;
+};
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function adds to the counters file of the cache. The file is
+ * locked while it is changed so programs sharing the cache do not lose
+ * counts.
+ *
+ * @param[in] dir - the cache directory
+ * @param[in] hits - the hits to add
+ * @param[in] misses - the misses to add
+ * @param[in] evictions - the evictions to add
+ * @param[out] totals - the hits, misses and evictions after adding
+ *
+ * @par Example:
+   @verbatim
+
+   unsigned long long totals[3];
+   addCounters("/tmp/cache", 1, 0, 0, totals);
+
+   @endverbatim
+
+ ***********************************************************************/
+static void addCounters(string dir, unsigned long long hits,
+    unsigned long long misses, unsigned long long evictions,
+    unsigned long long totals[3])
+{
+    char text[128];
+    ssize_t got;
+    int fd;
+
+    totals[0] = totals[1] = totals[2] = 0;
+    fd = open((dir + "/counters").c_str(), O_RDWR | O_CREAT, 0666);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    flock(fd, LOCK_EX);
+    got = pread(fd, text, sizeof(text) - 1, 0);
+    text[got > 0 ? got : 0] = '\0';
+    sscanf(text, "hits %llu misses %llu evictions %llu", &totals[0], &totals[1],
+        &totals[2]);
+
+    totals[0] += hits;
+    totals[1] += misses;
+    totals[2] += evictions;
+    if (hits + misses + evictions > 0)
+    {
+        got = snprintf(text, sizeof(text), "hits %llu\nmisses %llu\nevictions %llu\n",
+            totals[0], totals[1], totals[2]);
+        if (ftruncate(fd, 0) != 0 || pwrite(fd, text, size_t(got), 0) != got)
+        {
+            cout << "Unable to update the cache counters" << endl;
+        }
+    }
+    flock(fd, LOCK_UN);
+    close(fd);
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function lists the finished images in the cache directory.
+ *
+ * @param[in] dir - the cache directory
+ * @param[out] total - the size of all of the entries in bytes
+ *
+ * @returns the entries
+ *
+ * @par Example:
+   @verbatim
+
+   unsigned long long total;
+   vector<cacheEntry> entries = listEntries("/tmp/cache", total);
+
+   @endverbatim
+
+ ***********************************************************************/
+static vector<cacheEntry> listEntries(string dir, unsigned long long& total)
+{
+    vector<cacheEntry> entries;
+    cacheEntry entry;
+    DIR* listing;
+    dirent* item;
+    struct stat info;
+    string name;
+
+    total = 0;
+    listing = opendir(dir.c_str());
+    if (listing == nullptr)
+    {
+        return entries;
+    }
+
+    while ((item = readdir(listing)) != nullptr)
+    {
+        name = item->d_name;
+        if (name.size() < 4 || (name.compare(name.size() - 4, 4, ".ppm") != 0 &&
+            name.compare(name.size() - 4, 4, ".pgm") != 0 &&
+            name.compare(name.size() - 4, 4, ".qoi") != 0 &&
+            name.compare(name.size() - 4, 4, ".yuv") != 0))
+        {
+            continue;
+        }
+
+        entry.path = dir + "/" + name;
+        if (stat(entry.path.c_str(), &info) == 0)
+        {
+            entry.size = (unsigned long long)info.st_size;
+            entry.used = (long long)info.st_mtim.tv_sec * 1000000000 +
+                info.st_mtim.tv_nsec;
+            total += entry.size;
+            entries.push_back(entry);
+        }
+    }
+    closedir(listing);
+    return entries;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function removes the entries used the longest time ago until the
+ * cache is no larger than maxBytes. The entry just added is kept even if
+ * it is larger than the whole cache.
+ *
+ * @param[in] dir - the cache directory
+ * @param[in] maxBytes - the largest size of the cache
+ * @param[in] keep - the entry just added
+ *
+ * @returns the number of entries removed
+ *
+ * @par Example:
+   @verbatim
+
+   evictEntries("/tmp/cache", 1 << 30, "/tmp/cache/0123-4567.ppm");
+
+   @endverbatim
+
+ ***********************************************************************/
+static unsigned long long evictEntries(string dir, unsigned long long maxBytes,
+    string keep)
+{
+    unsigned long long total, removed = 0;
+    vector<cacheEntry> entries = listEntries(dir, total);
+    size_t i;
+
+    if (total <= maxBytes)
+    {
+        return 0;
+    }
+
+    sort(entries.begin(), entries.end(), [](const cacheEntry& a, const cacheEntry& b)
+    {
+        return a.used < b.used;
+    });
+
+    for (i = 0; i < entries.size() && total > maxBytes; i++)
+    {
+        if (entries[i].path != keep && unlink(entries[i].path.c_str()) == 0)
+        {
+            total -= entries[i].size;
+            removed++;
+        }
+    }
+    return removed;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function makes the output file from a cache entry without
+ * encoding the image again. It first asks the file system to share the
+ * blocks of the entry (a reflink), and copies the bytes if that does not
+ * work, for example when the cache is on another file system. A hard
+ * link is not used since the output would be the entry itself, a later
+ * run writing the same output would change the entry.
+ *
+ * @param[in] entry - the path of the cache entry
+ * @param[in] output - the path of the output file
+ *
+ * @par Example:
+   @verbatim
+
+   serveEntry("/tmp/cache/0123-4567.ppm", "sepia.ppm");
+
+   @endverbatim
+
+ ***********************************************************************/
+static void serveEntry(string entry, string output)
+{
+    ifstream fin;
+    ofstream fout;
+
+    //never write through an old link into an entry
+    unlink(output.c_str());
+
+#ifdef FICLONE
+    int source, target;
+
+    source = open(entry.c_str(), O_RDONLY);
+    target = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (source >= 0 && target >= 0 && ioctl(target, FICLONE, source) == 0)
+    {
+        close(source);
+        close(target);
+        return;
+    }
+    if (source >= 0)
+    {
+        close(source);
+    }
+    if (target >= 0)
+    {
+        close(target);
+        unlink(output.c_str());
+    }
+#endif
+
+    fin.open(entry, ios::in | ios::binary);
+    isBinOutputOpen(output, fout);
+    fout << fin.rdbuf();
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function does the work of main through the cache. The input file
+ * is read once, the xxHash of its bytes is computed on that read and the
+ * key is made from it, the option in its short form and the output type.
+ * The bytes of the watermark of an overlay are part of the key as well.
+ * On a hit the output is made from the entry and the image is not
+ * decoded. On a miss the image is decoded from the bytes already read,
+ * handled and encoded into a new entry, which is then used for the
+ * output. The cache is kept under maxBytes by removing the entries used
+ * the longest time ago.
+ *
+ * @param[in] dir - the cache directory, made if it does not exist
+ * @param[in] maxBytes - the largest size of the cache
+ * @param[in] option - the image manupulation option, can be empty
+ * @param[in] type - --binary, --ascii or --qoi
+ * @param[in] input - the path of the input image
+ * @param[in] output - the path of the output image
+ *
+ * @returns true - if the output came from the cache
+ *
+ * @par Example:
+   @verbatim
+
+   runCached("/tmp/cache", 1 << 30, "--sepia", "--binary", "in.ppm", "out.ppm");
+
+   @endverbatim
+
+ ***********************************************************************/
+bool runCached(string dir, unsigned long long maxBytes, string option, string type,
+    string input, string output)
+{
+    ifstream fin;
+    ofstream fout;
+    string bytes, entry, temp, key, mark;
+    unsigned long long totals[3];
+    char name[64];
+    image img{};
+    int maxPixel, x, y;
+    bool tiled;
+
+    //read the whole input once
+    isBinFileOpen(input, fin);
+    bytes.resize(size_t(fin.tellg()));
+    fin.seekg(0, ios::beg);
+    fin.read(&bytes[0], bytes.size());
+    fin.close();
+
+    key = normalizeOption(option) + " " + type;
+
+    //a watermark is an input too, a new one must not hit the old entries
+    if (parseOverlay(option, temp, x, y, tiled))
+    {
+        isBinFileOpen(temp, fin);
+        mark.resize(size_t(fin.tellg()));
+        fin.seekg(0, ios::beg);
+        fin.read(&mark[0], mark.size());
+        fin.close();
+        key += " " + to_string(hashBytes(mark.data(), mark.size(), CACHE_VERSION));
+    }
+    snprintf(name, sizeof(name), "/%016llx-%016llx",
+        hashBytes(bytes.data(), bytes.size(), CACHE_VERSION),
+        hashBytes(key.data(), key.size(), CACHE_VERSION));
+    entry = dir + name + output.substr(output.size() - 4);
+
+    //a hit marks the entry as used and skips all of the work
+    if (access(entry.c_str(), R_OK) == 0)
+    {
+        utime(entry.c_str(), nullptr);
+        serveEntry(entry, output);
+        addCounters(dir, 1, 0, 0, totals);
+        return true;
+    }
+
+    //a miss decodes the bytes already in memory
+    mkdir(dir.c_str(), 0777);
+    temp = entry + "." + to_string(getpid());
+    try
+    {
+        memoryInput buffer(bytes.data(), bytes.size());
+        istream in(&buffer);
+
+        processImage(in, option, img, maxPixel);
+        isBinOutputOpen(temp, fout);
+        handleOutput(option, type, img, fout, maxPixel);
+        fout.close();
+    }
+    catch (...)
+    {
+        clearArray(img.redGray, img.rows);
+        clearArray(img.green, img.rows);
+        clearArray(img.blue, img.rows);
+        unlink(temp.c_str());
+        throw;
+    }
+    clearArray(img.redGray, img.rows);
+    clearArray(img.green, img.rows);
+    clearArray(img.blue, img.rows);
+
+    //entries are read only and appear whole
+    chmod(temp.c_str(), 0444);
+    rename(temp.c_str(), entry.c_str());
+    serveEntry(entry, output);
+    addCounters(dir, 0, 1, evictEntries(dir, maxBytes, entry), totals);
+    return false;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function prints the counters and the size of the cache as JSON.
+ *
+ * @param[in] dir - the cache directory
+ *
+ * @par Example:
+   @verbatim
+
+   printCacheStats("/tmp/cache");
+   //{"hits": 3, "misses": 1, "evictions": 0, "entries": 1, "bytes": 921615}
+
+   @endverbatim
+
+ ***********************************************************************/
+void printCacheStats(string dir)
+{
+    unsigned long long totals[3], total;
+    vector<cacheEntry> entries = listEntries(dir, total);
+
+    addCounters(dir, 0, 0, 0, totals);
+    cout << "{\"hits\": " << totals[0] << ", \"misses\": " << totals[1]
+        << ", \"evictions\": " << totals[2] << ", \"entries\": " << entries.size()
+        << ", \"bytes\": " << total << "}" << endl;
+}
+
+#else
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * The cache uses POSIX file calls, so on Windows the work is done
+ * without it.
+ *
+ * @param[in] dir - the cache directory
+ * @param[in] maxBytes - the largest size of the cache
+ * @param[in] option - the image manupulation option, can be empty
+ * @param[in] type - --binary, --ascii or --qoi
+ * @param[in] input - the path of the input image
+ * @param[in] output - the path of the output image
+ *
+ * @returns false, the output never comes from the cache
+ *
+ * @par Example:
+   @verbatim
+
+   runCached("cache", 1 << 30, "--sepia", "--binary", "in.ppm", "out.ppm");
+
+   @endverbatim
+
+ ***********************************************************************/
+bool runCached(string dir, unsigned long long maxBytes, string option, string type,
+    string input, string output)
+{
+    ifstream fin;
+    ofstream fout;
+    image img{};
+    int maxPixel;
+
+    (void)dir;
+    (void)maxBytes;
+    isBinFileOpen(input, fin);
+    isBinOutputOpen(output, fout);
+    try
+    {
+        processImage(fin, option, img, maxPixel);
+        handleOutput(option, type, img, fout, maxPixel);
+    }
+    catch (...)
+    {
+        clearArray(img.redGray, img.rows);
+        clearArray(img.green, img.rows);
+        clearArray(img.blue, img.rows);
+        throw;
+    }
+    clearArray(img.redGray, img.rows);
+    clearArray(img.green, img.rows);
+    clearArray(img.blue, img.rows);
+    return false;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * The cache is not available on Windows, so there is nothing to print.
+ *
+ * @param[in] dir - the cache directory
+ *
+ * @par Example:
+   @verbatim
+
+   printCacheStats("cache");
+
+   @endverbatim
+
+ ***********************************************************************/
+void printCacheStats(string dir)
+{
+    cout << "The cache is not available on this platform: " << dir << endl;
+}
+
+#endif
@@ -0,0 +1,416 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Comparing two images, largest difference, MSE, PSNR and SSIM
+ ***********************************************************************/
+#include "netPBM.h"
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+/************************************************************************
+ *             Constants
+ ***********************************************************************/
+ /*!
+  * @brief rows and columns of a block, a SSIM window is 2 X 2 blocks and
+  *        the windows step one block at a time
+  */
+const int COMPARE_BLOCK = 4;
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function adds up the blocks of one band of COMPARE_BLOCK rows of
+ * one array of the two images. Every block gets four sums, the values of
+ * the first image, the values of the second image, the squares of both
+ * and the products of the two, which is all a SSIM window needs.
+ *
+ * @param[in] a - the array of the first image
+ * @param[in] b - the array of the second image
+ * @param[in] band - the band, its first row is band X COMPARE_BLOCK
+ * @param[in] blocks - the number of whole blocks across the band
+ * @param[out] sums - four sums per block
+ *
+ * @par Example:
+   @verbatim
+
+   vector<long long> sums(size_t(blocks) * 4);
+   blockSums(first.redGray, second.redGray, 0, blocks, sums.data());
+
+   @endverbatim
+
+ ***********************************************************************/
+static void blockSums(pixel** a, pixel** b, int band, int blocks, long long* sums)
+{
+    int i, j, x;
+    const pixel* rowA;
+    const pixel* rowB;
+
+    memset(sums, 0, size_t(blocks) * 4 * sizeof(long long));
+    for (i = band * COMPARE_BLOCK; i < (band + 1) * COMPARE_BLOCK; i++)
+    {
+        rowA = a[i];
+        rowB = b[i];
+        for (x = 0; x < blocks; x++)
+        {
+            int sa = 0, sb = 0, squares = 0, products = 0;
+            for (j = x * COMPARE_BLOCK; j < (x + 1) * COMPARE_BLOCK; j++)
+            {
+                sa += rowA[j];
+                sb += rowB[j];
+                squares += rowA[j] * rowA[j] + rowB[j] * rowB[j];
+                products += rowA[j] * rowB[j];
+            }
+            sums[x * 4] += sa;
+            sums[x * 4 + 1] += sb;
+            sums[x * 4 + 2] += squares;
+            sums[x * 4 + 3] += products;
+        }
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function works out the SSIM of one window from its sums, with
+ * the usual constants (0.01 L)^2 and (0.03 L)^2 for a largest value L.
+ *
+ * @param[in] sa - the sum of the values of the first image
+ * @param[in] sb - the sum of the values of the second image
+ * @param[in] squares - the sum of the squares of both images
+ * @param[in] products - the sum of the products of the two images
+ * @param[in] count - the number of pixels in the window
+ * @param[in] maxPixel - the largest value
+ *
+ * @returns the SSIM of the window, 1 for the same pixels
+ *
+ * @par Example:
+   @verbatim
+
+   double ssim = windowSsim(sa, sb, squares, products, 64, 255);
+
+   @endverbatim
+
+ ***********************************************************************/
+static double windowSsim(double sa, double sb, double squares, double products, double count,
+    int maxPixel)
+{
+    double c1 = (0.01 * maxPixel) * (0.01 * maxPixel);
+    double c2 = (0.03 * maxPixel) * (0.03 * maxPixel);
+    double meanA = sa / count, meanB = sb / count;
+    double variances = squares / count - meanA * meanA - meanB * meanB;
+    double covariance = products / count - meanA * meanB;
+
+    return (2 * meanA * meanB + c1) * (2 * covariance + c2) /
+        ((meanA * meanA + meanB * meanB + c1) * (variances + c2));
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function compares two images of the same size. The arrays are
+ * first checked row by row with memcmp, and two images that are the same
+ * stop there. Otherwise every thread takes bands of COMPARE_BLOCK rows
+ * and in one read of each band finds the largest difference, the sum of
+ * the squared differences and the block sums of the band. A SSIM window
+ * is 2 X 2 blocks, 8 X 8 pixels, and the windows step 4 pixels, so a band
+ * and the band below it give one row of windows. Every band keeps its
+ * own results and they are added in order at the end, so the result is
+ * the same for any number of threads. An image too small for a window is
+ * one window.
+ *
+ * @param[in] first - the first image
+ * @param[in] second - the second image
+ * @param[in] maxPixel - the largest value, for the SSIM constants
+ * @param[out] result - how much the images differ
+ *
+ * @par Example:
+   @verbatim
+
+   imageCompare result;
+   compareImages(golden, output, 255, result);
+
+   @endverbatim
+
+ ***********************************************************************/
+void compareImages(const image& first, const image& second, int maxPixel,
+    imageCompare& result)
+{
+    pixel** a[3] = { first.redGray, first.green, first.blue };
+    pixel** b[3] = { second.redGray, second.green, second.blue };
+    int rows = first.rows, cols = first.cols;
+    int bands = rows / COMPARE_BLOCK, blocks = cols / COMPARE_BLOCK;
+    int tasks = (rows + COMPARE_BLOCK - 1) / COMPARE_BLOCK;
+    int i, k, t;
+    long long windows;
+    vector<unsigned long long> squared(size_t(tasks) * 3, 0);
+    vector<int> largest(size_t(tasks) * 3, 0);
+    vector<double> ssimRows(size_t(tasks) * 3, 0.0);
+    unsigned long long total;
+    double sum;
+
+    if (first.rows != second.rows || first.cols != second.cols)
+    {
+        throw runtime_error("The images are not the same size");
+    }
+
+    //the same bytes, nothing more to work out
+    result.identical = true;
+    for (k = 0; k < 3 && result.identical; k++)
+    {
+        for (i = 0; i < rows && result.identical; i++)
+        {
+            result.identical = memcmp(a[k][i], b[k][i], size_t(cols)) == 0;
+        }
+    }
+    if (result.identical)
+    {
+        for (k = 0; k < 3; k++)
+        {
+            result.maxDiff[k] = 0;
+            result.mse[k] = 0.0;
+            result.ssim[k] = 1.0;
+        }
+        return;
+    }
+
+    parallelFor(tasks, [&](int firstTask, int lastTask)
+    {
+        int task, channel, row, j, difference, most;
+        unsigned long long squares;
+        double windowSum;
+        vector<long long> above(size_t(blocks) * 4), below(size_t(blocks) * 4);
+        const pixel* rowA;
+        const pixel* rowB;
+
+        for (channel = 0; channel < 3; channel++)
+        {
+            for (task = firstTask; task < lastTask; task++)
+            {
+                //largest and squared differences of the rows of the band
+                squares = 0;
+                most = 0;
+                for (row = task * COMPARE_BLOCK; row < min((task + 1) * COMPARE_BLOCK, rows); row++)
+                {
+                    rowA = a[channel][row];
+                    rowB = b[channel][row];
+                    for (j = 0; j < cols; j++)
+                    {
+                        difference = rowA[j] - rowB[j];
+                        squares += unsigned(difference * difference);
+                        difference = difference < 0 ? -difference : difference;
+                        most = difference > most ? difference : most;
+                    }
+                }
+                squared[size_t(task) * 3 + channel] = squares;
+                largest[size_t(task) * 3 + channel] = most;
+
+                //the row of windows over this band and the next
+                if (task + 1 >= bands)
+                {
+                    continue;
+                }
+                if (task == firstTask)
+                {
+                    blockSums(a[channel], b[channel], task, blocks, above.data());
+                }
+                blockSums(a[channel], b[channel], task + 1, blocks, below.data());
+                windowSum = 0.0;
+                for (j = 0; j + 1 < blocks; j++)
+                {
+                    windowSum += windowSsim(
+                        double(above[j * 4] + above[j * 4 + 4] + below[j * 4] + below[j * 4 + 4]),
+                        double(above[j * 4 + 1] + above[j * 4 + 5] + below[j * 4 + 1] + below[j * 4 + 5]),
+                        double(above[j * 4 + 2] + above[j * 4 + 6] + below[j * 4 + 2] + below[j * 4 + 6]),
+                        double(above[j * 4 + 3] + above[j * 4 + 7] + below[j * 4 + 3] + below[j * 4 + 7]),
+                        4.0 * COMPARE_BLOCK * COMPARE_BLOCK, maxPixel);
+                }
+                ssimRows[size_t(task) * 3 + channel] = windowSum;
+                swap(above, below);
+            }
+        }
+    });
+
+    windows = (long long)max(bands - 1, 0) * max(blocks - 1, 0);
+    for (k = 0; k < 3; k++)
+    {
+        total = 0;
+        sum = 0.0;
+        result.maxDiff[k] = 0;
+        for (t = 0; t < tasks; t++)
+        {
+            total += squared[size_t(t) * 3 + k];
+            sum += ssimRows[size_t(t) * 3 + k];
+            result.maxDiff[k] = max(result.maxDiff[k], largest[size_t(t) * 3 + k]);
+        }
+        result.mse[k] = double(total) / (double(rows) * cols);
+
+        //an image too small for a window is one window
+        if (windows == 0)
+        {
+            double sa = 0, sb = 0, squares = 0, products = 0;
+            for (i = 0; i < rows; i++)
+            {
+                for (t = 0; t < cols; t++)
+                {
+                    sa += a[k][i][t];
+                    sb += b[k][i][t];
+                    squares += a[k][i][t] * a[k][i][t] + b[k][i][t] * b[k][i][t];
+                    products += a[k][i][t] * b[k][i][t];
+                }
+            }
+            result.ssim[k] = windowSsim(sa, sb, squares, products, double(rows) * cols, maxPixel);
+        }
+        else
+        {
+            result.ssim[k] = sum / windows;
+        }
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function writes a comparison as JSON. Every array gets its
+ * largest difference, MSE, PSNR and SSIM, then the three are averaged.
+ * The PSNR of arrays with no difference is null since it has no end.
+ *
+ * @param[out] out - the stream the JSON is written to
+ * @param[in] result - the comparison
+ * @param[in] rows - the rows of the images
+ * @param[in] cols - the columns of the images
+ * @param[in] maxPixel - the largest value, for the PSNR
+ *
+ * @par Example:
+   @verbatim
+
+   writeCompareJson(cout, result, img.rows, img.cols, 255);
+
+   @endverbatim
+
+ ***********************************************************************/
+void writeCompareJson(ostream& out, const imageCompare& result, int rows, int cols,
+    int maxPixel)
+{
+    int c, most = 0;
+    double mse = 0.0, ssim = 0.0;
+    const char* names[3] = { "red", "green", "blue" };
+
+    //the PSNR, or null with no error
+    auto psnr = [&](double error)
+    {
+        ostringstream text;
+        if (error <= 0.0)
+        {
+            return string("null");
+        }
+        text << fixed << setprecision(3) << 10.0 * log10(double(maxPixel) * maxPixel / error);
+        return text.str();
+    };
+
+    out << "{\n";
+    out << "  \"rows\": " << rows << ",\n";
+    out << "  \"cols\": " << cols << ",\n";
+    out << "  \"identical\": " << (result.identical ? "true" : "false") << ",\n";
+    out << "  \"channels\": [\n";
+
+    for (c = 0; c < 3; c++)
+    {
+        most = max(most, result.maxDiff[c]);
+        mse += result.mse[c] / 3.0;
+        ssim += result.ssim[c] / 3.0;
+
+        out << "    {\n";
+        out << "      \"name\": \"" << names[c] << "\",\n";
+        out << "      \"maxDiff\": " << result.maxDiff[c] << ",\n";
+        out << "      \"mse\": " << fixed << setprecision(6) << result.mse[c] << ",\n";
+        out << "      \"psnr\": " << psnr(result.mse[c]) << ",\n";
+        out << "      \"ssim\": " << fixed << setprecision(6) << result.ssim[c] << "\n";
+        out << "    }" << (c < 2 ? "," : "") << "\n";
+    }
+
+    out << "  ],\n";
+    out << "  \"maxDiff\": " << most << ",\n";
+    out << "  \"mse\": " << fixed << setprecision(6) << mse << ",\n";
+    out << "  \"psnr\": " << psnr(mse) << ",\n";
+    out << "  \"ssim\": " << fixed << setprecision(6) << ssim << "\n";
+    out << "}" << endl;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function reads two images with the readers of the program, so
+ * any netPBM or QOI file can be compared to any other, and writes how
+ * much they differ as JSON to the standard output. The values of two
+ * images with a different maxPixel are not on the same scale, so that
+ * throws a runtime_error like two images of a different size. The shared
+ * maxPixel is used for PSNR and SSIM.
+ *
+ * @param[in] first - the name of the first image, like the golden image
+ * @param[in] second - the name of the second image
+ *
+ * @returns true - if the images are the same
+ *
+ * @par Example:
+   @verbatim
+
+   bool same = printCompare("golden/sepia.ppm", "out/sepia.ppm");
+
+   @endverbatim
+
+ ***********************************************************************/
+bool printCompare(string first, string second)
+{
+    ifstream fin;
+    image a{}, b{};
+    int maxPixel, secondMax;
+    imageCompare result;
+
+    try
+    {
+        isBinFileOpen(first, fin);
+        readFile(fin, a, maxPixel);
+        fin.close();
+
+        isBinFileOpen(second, fin);
+        readFile(fin, b, secondMax);
+        fin.close();
+
+        if (secondMax != maxPixel)
+        {
+            throw runtime_error("The images do not have the same maxPixel");
+        }
+
+        compareImages(a, b, maxPixel, result);
+        writeCompareJson(cout, result, a.rows, a.cols, maxPixel);
+    }
+    catch (...)
+    {
+        clearArray(a.redGray, a.rows);
+        clearArray(a.green, a.rows);
+        clearArray(a.blue, a.rows);
+        clearArray(b.redGray, b.rows);
+        clearArray(b.green, b.rows);
+        clearArray(b.blue, b.rows);
+        throw;
+    }
+
+    clearArray(a.redGray, a.rows);
+    clearArray(a.green, a.rows);
+    clearArray(a.blue, a.rows);
+    clearArray(b.redGray, b.rows);
+    clearArray(b.green, b.rows);
+    clearArray(b.blue, b.rows);
+    return result.identical;
+}
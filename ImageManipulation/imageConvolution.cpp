@@ -0,0 +1,954 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Convolution operations - blur, sharpen and custom kernels
+ ***********************************************************************/
+#include "netPBM.h"
+#include <cmath>
+
+/************************************************************************
+ *             Constants
+ ***********************************************************************/
+ /*!
+  * @brief number of fraction bits in the fixed point kernel weights
+  */
+const int KERNEL_BITS = 12;
+
+/*!
+ * @brief number of fraction bits kept between the horizontal and
+ *        vertical pass of a separable kernel
+ */
+const int MID_BITS = 6;
+
+/*!
+ * @brief rows in one tile, a tile is filtered by one thread at a time
+ */
+const int TILE_ROWS = 64;
+
+/*!
+ * @brief columns in one tile
+ */
+const int TILE_COLS = 512;
+
+/*!
+ * @brief sigma above which the gaussian blur switches to running sums
+ */
+const double BOX_BLUR_SIGMA = 4.0;
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function maps a position that can be outside of the array back
+ * into the array using the border mode. Clamp repeats the edge pixel,
+ * mirror reflects around the edge, wrap continues from the other side
+ * and zero returns -1 so the caller uses 0. Only the edges of the image
+ * go through this function so the image never has to be copied into a
+ * larger padded array.
+ *
+ * @param[in] i - the position, can be negative or past the end
+ * @param[in] size - the number of positions in the array
+ * @param[in] border - how positions outside of the array are handled
+ *
+ * @returns a position inside the array, or -1 for a zero border
+ *
+ * @par Example:
+   @verbatim
+
+   int j = borderIndex(-2, 10, BORDER_MIRROR);
+   //j is 1
+
+   @endverbatim
+
+ ***********************************************************************/
+int borderIndex(int i, int size, borderMode border)
+{
+    //inside of the array, nothing to do
+    if (i >= 0 && i < size)
+    {
+        return i;
+    }
+
+    if (border == BORDER_ZERO)
+    {
+        return -1;
+    }
+
+    if (border == BORDER_WRAP)
+    {
+        i = i % size;
+        return i < 0 ? i + size : i;
+    }
+
+    if (border == BORDER_MIRROR && size > 1)
+    {
+        //reflect until the position lands in the array
+        while (i < 0 || i >= size)
+        {
+            i = i < 0 ? -i - 1 : 2 * size - i - 1;
+        }
+        return i;
+    }
+
+    //clamp to the nearest edge
+    return i < 0 ? 0 : size - 1;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function turns the name of a border mode into the enum. The names
+ * are clamp, mirror, wrap and zero. An empty name gives clamp.
+ *
+ * @param[in] name - the name of the border mode
+ * @param[out] border - the border mode
+ *
+ * @returns true - if the name is a border mode
+ *
+ * @par Example:
+   @verbatim
+
+   borderMode border;
+   parseBorder("wrap", border);
+   //border is BORDER_WRAP
+
+   @endverbatim
+
+ ***********************************************************************/
+bool parseBorder(string name, borderMode& border)
+{
+    if (name == "" || name == "clamp")
+    {
+        border = BORDER_CLAMP;
+    }
+    else if (name == "mirror")
+    {
+        border = BORDER_MIRROR;
+    }
+    else if (name == "wrap")
+    {
+        border = BORDER_WRAP;
+    }
+    else if (name == "zero")
+    {
+        border = BORDER_ZERO;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function checks if a square kernel can be written as a column
+ * times a row. If it can, the convolution can be done as a horizontal
+ * and a vertical pass which costs 2 X size instead of size X size per
+ * pixel. The largest entry of the kernel is used to pick the row and the
+ * column, then every entry is checked against their product.
+ *
+ * @param[in] kernel - the size X size kernel, row by row
+ * @param[in] size - the width and height of the kernel
+ * @param[out] colPart - the vertical part of the kernel
+ * @param[out] rowPart - the horizontal part of the kernel
+ *
+ * @returns true - if the kernel is separable
+ *
+ * @par Example:
+   @verbatim
+
+   vector<double> col, row;
+   vector<double> kernel = { 1, 2, 1, 2, 4, 2, 1, 2, 1 };
+   bool separable = isSeparable(kernel, 3, col, row);
+   //separable is true, col is 1,2,1 and row is 1,2,1
+
+   @endverbatim
+
+ ***********************************************************************/
+static bool isSeparable(const vector<double>& kernel, int size,
+    vector<double>& colPart, vector<double>& rowPart)
+{
+    int i, j;
+    int pivot = 0;
+    double scale = 0.0;
+
+    //find the largest entry
+    for (i = 0; i < size * size; i++)
+    {
+        if (fabs(kernel[i]) > fabs(kernel[pivot]))
+        {
+            pivot = i;
+        }
+        scale = max(scale, fabs(kernel[i]));
+    }
+
+    if (scale == 0.0)
+    {
+        return false;
+    }
+
+    //column through the pivot, row through the pivot divided by the pivot
+    colPart.resize(size);
+    rowPart.resize(size);
+    for (i = 0; i < size; i++)
+    {
+        colPart[i] = kernel[i * size + pivot % size];
+        rowPart[i] = kernel[(pivot / size) * size + i] / kernel[pivot];
+    }
+
+    //every entry has to be the product of its column and row part
+    for (i = 0; i < size; i++)
+    {
+        for (j = 0; j < size; j++)
+        {
+            if (fabs(colPart[i] * rowPart[j] - kernel[i * size + j]) > 1e-6 * scale)
+            {
+                return false;
+            }
+        }
+    }
+
+    //make the row add up to one so both parts keep their precision
+    scale = 0.0;
+    for (i = 0; i < size; i++)
+    {
+        scale += rowPart[i];
+    }
+    if (scale != 0.0)
+    {
+        for (i = 0; i < size; i++)
+        {
+            rowPart[i] /= scale;
+            colPart[i] *= scale;
+        }
+    }
+
+    return true;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function turns kernel weights into fixed point numbers with
+ * KERNEL_BITS fraction bits. The rounding error is added to the center
+ * so a kernel that adds up to one still adds up to one.
+ *
+ * @param[in] weights - the weights as doubles
+ *
+ * @returns the weights in fixed point
+ *
+ * @par Example:
+   @verbatim
+
+   vector<int> w = fixedWeights({ 0.25, 0.5, 0.25 });
+   //w is 1024, 2048, 1024
+
+   @endverbatim
+
+ ***********************************************************************/
+static vector<int> fixedWeights(const vector<double>& weights)
+{
+    int i;
+    double sum = 0.0;
+    int total = 0;
+    vector<int> result(weights.size());
+
+    for (i = 0; i < int(weights.size()); i++)
+    {
+        result[i] = int(lround(weights[i] * (1 << KERNEL_BITS)));
+        total += result[i];
+        sum += weights[i];
+    }
+
+    //give the rounding error to the center tap
+    result[weights.size() / 2] += int(lround(sum * (1 << KERNEL_BITS))) - total;
+    return result;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function rounds a fixed point sum with the given number of
+ * fraction bits back to a pixel between 0 and 255.
+ *
+ * @param[in] sum - the fixed point sum
+ * @param[in] bits - the number of fraction bits in sum
+ *
+ * @returns the sum as a pixel
+ *
+ * @par Example:
+   @verbatim
+
+   pixel p = clampFixed(100 << 12, 12);
+   //p is 100
+
+   @endverbatim
+
+ ***********************************************************************/
+static inline pixel clampFixed(int sum, int bits)
+{
+    sum = (sum + (1 << (bits - 1))) >> bits;
+    return pixel(sum < 0 ? 0 : (sum > 255 ? 255 : sum));
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function convolves one 2D array with a separable kernel. The
+ * output is cut into tiles of TILE_ROWS X TILE_COLS and the tiles are
+ * shared out to the threads. For each tile the horizontal pass is run
+ * over the rows the tile needs, including the rows above and below it,
+ * into a small buffer of fixed point numbers that stays in the cache.
+ * The vertical pass then adds rows of that buffer into the output. The
+ * borders are handled with borderIndex on the edge tiles only.
+ *
+ * @param[in] src - the array to filter
+ * @param[out] dst - the array the result is stored to
+ * @param[in] rows - the rows of the array
+ * @param[in] cols - the columns of the array
+ * @param[in] rowPart - fixed point horizontal weights
+ * @param[in] colPart - fixed point vertical weights
+ * @param[in] border - how pixels outside of the image are handled
+ *
+ * @par Example:
+   @verbatim
+
+   convolveSeparable(img.redGray, temp, img.rows, img.cols,
+       fixedWeights(row), fixedWeights(col), BORDER_CLAMP);
+
+   @endverbatim
+
+ ***********************************************************************/
+static void convolveSeparable(pixel** src, pixel** dst, int rows, int cols,
+    const vector<int>& rowPart, const vector<int>& colPart, borderMode border)
+{
+    int tilesDown = (rows + TILE_ROWS - 1) / TILE_ROWS;
+    int tilesAcross = (cols + TILE_COLS - 1) / TILE_COLS;
+    int radius = int(rowPart.size()) / 2;
+
+    parallelFor(tilesDown * tilesAcross, [&](int firstTile, int lastTile)
+    {
+        int t, i, j, k, m, r0, r1, c0, c1, width, sum;
+        const pixel* in;
+        vector<int> buffer;
+        vector<int> sums;
+
+        for (t = firstTile; t < lastTile; t++)
+        {
+            r0 = (t / tilesAcross) * TILE_ROWS;
+            r1 = min(r0 + TILE_ROWS, rows);
+            c0 = (t % tilesAcross) * TILE_COLS;
+            c1 = min(c0 + TILE_COLS, cols);
+            width = c1 - c0;
+            buffer.assign(size_t(r1 - r0 + 2 * radius) * width, 0);
+            sums.resize(width);
+
+            //horizontal pass over the tile rows and the rows around them
+            for (i = r0 - radius; i < r1 + radius; i++)
+            {
+                m = borderIndex(i, rows, border);
+                if (m < 0)
+                {
+                    continue;
+                }
+                in = src[m];
+                int* out = &buffer[size_t(i - r0 + radius) * width];
+
+                for (j = c0; j < c1; j++)
+                {
+                    sum = 0;
+                    //inside of the image, read straight from the row
+                    if (j - radius >= 0 && j + radius < cols)
+                    {
+                        for (k = 0; k < int(rowPart.size()); k++)
+                        {
+                            sum += rowPart[k] * in[j - radius + k];
+                        }
+                    }
+                    //on the edge, map every position through the border
+                    else
+                    {
+                        for (k = 0; k < int(rowPart.size()); k++)
+                        {
+                            m = borderIndex(j - radius + k, cols, border);
+                            if (m >= 0)
+                            {
+                                sum += rowPart[k] * in[m];
+                            }
+                        }
+                    }
+                    //keep MID_BITS of the fraction for the vertical pass
+                    out[j - c0] = (sum + (1 << (KERNEL_BITS - MID_BITS - 1))) >> (KERNEL_BITS - MID_BITS);
+                }
+            }
+
+            //vertical pass, add whole buffer rows into a row of sums
+            for (i = r0; i < r1; i++)
+            {
+                fill(sums.begin(), sums.end(), 0);
+                for (k = 0; k < int(colPart.size()); k++)
+                {
+                    const int* mid = &buffer[size_t(i - r0 + k) * width];
+                    for (j = 0; j < width; j++)
+                    {
+                        sums[j] += colPart[k] * mid[j];
+                    }
+                }
+                for (j = 0; j < width; j++)
+                {
+                    dst[i][c0 + j] = clampFixed(sums[j], KERNEL_BITS + MID_BITS);
+                }
+            }
+        }
+    });
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function convolves one 2D array with a kernel that is not
+ * separable. Every output pixel adds up size X size input pixels. The
+ * rows are split across threads and the borders are handled with
+ * borderIndex only when the kernel hangs over the edge.
+ *
+ * @param[in] src - the array to filter
+ * @param[out] dst - the array the result is stored to
+ * @param[in] rows - the rows of the array
+ * @param[in] cols - the columns of the array
+ * @param[in] kernel - fixed point size X size kernel, row by row
+ * @param[in] size - the width and height of the kernel
+ * @param[in] border - how pixels outside of the image are handled
+ *
+ * @par Example:
+   @verbatim
+
+   convolveFull(img.redGray, temp, img.rows, img.cols,
+       fixedWeights(kernel), 3, BORDER_CLAMP);
+
+   @endverbatim
+
+ ***********************************************************************/
+static void convolveFull(pixel** src, pixel** dst, int rows, int cols,
+    const vector<int>& kernel, int size, borderMode border)
+{
+    int radius = size / 2;
+
+    parallelFor(rows, [&](int first, int last)
+    {
+        int i, j, k, l, m, n, sum;
+        bool inside;
+
+        for (i = first; i < last; i++)
+        {
+            for (j = 0; j < cols; j++)
+            {
+                sum = 0;
+                inside = i - radius >= 0 && i + radius < rows &&
+                    j - radius >= 0 && j + radius < cols;
+
+                for (k = 0; k < size; k++)
+                {
+                    //row of the image under this row of the kernel
+                    m = inside ? i - radius + k : borderIndex(i - radius + k, rows, border);
+                    if (m < 0)
+                    {
+                        continue;
+                    }
+                    for (l = 0; l < size; l++)
+                    {
+                        n = inside ? j - radius + l : borderIndex(j - radius + l, cols, border);
+                        if (n >= 0)
+                        {
+                            sum += kernel[k * size + l] * src[m][n];
+                        }
+                    }
+                }
+                dst[i][j] = clampFixed(sum, KERNEL_BITS);
+            }
+        }
+    });
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function convolves all three arrays of the image with a square
+ * kernel of odd size. If the kernel is separable the tiled two pass
+ * version is used, otherwise every pixel adds up the full kernel. The
+ * results go to temporary arrays which then replace the originals.
+ *
+ * @param[in, out] img - the structure where the data of the image is stored
+ * @param[in] kernel - the size X size kernel, row by row
+ * @param[in] size - the width and height of the kernel, must be odd
+ * @param[in] border - how pixels outside of the image are handled
+ *
+ * @par Example:
+   @verbatim
+
+   image img;
+   vector<double> kernel = { 1 / 16.0, 2 / 16.0, 1 / 16.0,
+                             2 / 16.0, 4 / 16.0, 2 / 16.0,
+                             1 / 16.0, 2 / 16.0, 1 / 16.0 };
+
+   convolveImage(img, kernel, 3, BORDER_MIRROR);
+   //img is now slightly blurred
+
+   @endverbatim
+
+ ***********************************************************************/
+void convolveImage(image& img, vector<double> kernel, int size, borderMode border)
+{
+    int p;
+    vector<double> colPart, rowPart;
+    vector<int> fixedRow, fixedCol, fixedKernel;
+    bool separable;
+    pixel** planes[3] = { img.redGray, img.green, img.blue };
+    pixel** temp;
+
+    if (size < 1 || size % 2 == 0 || int(kernel.size()) != size * size)
+    {
+        throw invalid_argument("Invalid option values");
+    }
+
+    separable = isSeparable(kernel, size, colPart, rowPart);
+    if (separable)
+    {
+        fixedRow = fixedWeights(rowPart);
+        fixedCol = fixedWeights(colPart);
+    }
+    else
+    {
+        fixedKernel = fixedWeights(kernel);
+    }
+
+    //filter every array into a new one and replace the original
+    for (p = 0; p < 3; p++)
+    {
+        temp = createArrays(img.rows, img.cols);
+        if (separable)
+        {
+            convolveSeparable(planes[p], temp, img.rows, img.cols, fixedRow, fixedCol, border);
+        }
+        else
+        {
+            convolveFull(planes[p], temp, img.rows, img.cols, fixedKernel, size, border);
+        }
+        clearArray(planes[p], img.rows);
+        planes[p] = temp;
+    }
+
+    img.redGray = planes[0];
+    img.green = planes[1];
+    img.blue = planes[2];
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function runs a box blur of the given radius over one 2D array
+ * using running sums, so the cost per pixel does not depend on the
+ * radius. The horizontal pass keeps a sum of the window along each row,
+ * adding the pixel that enters and taking away the one that leaves. The
+ * vertical pass does the same with a whole row of column sums so it
+ * still walks memory row by row. Rows, then columns, are split across
+ * threads.
+ *
+ * @param[in, out] array - the array to blur
+ * @param[in] rows - the rows of the array
+ * @param[in] cols - the columns of the array
+ * @param[in] radius - the box covers 2 X radius + 1 pixels each way
+ * @param[in] border - how pixels outside of the image are handled
+ *
+ * @par Example:
+   @verbatim
+
+   boxBlurPlane(img.redGray, img.rows, img.cols, 10, BORDER_CLAMP);
+
+   @endverbatim
+
+ ***********************************************************************/
+static void boxBlurPlane(pixel** array, int rows, int cols, int radius, borderMode border)
+{
+    int width = 2 * radius + 1;
+    pixel** temp = createArrays(rows, cols);
+
+    //horizontal pass into temp
+    parallelFor(rows, [&](int first, int last)
+    {
+        int i, j, m, sum;
+        const pixel* in;
+
+        for (i = first; i < last; i++)
+        {
+            in = array[i];
+
+            //sum of the window around the first pixel
+            sum = 0;
+            for (j = -radius; j <= radius; j++)
+            {
+                m = borderIndex(j, cols, border);
+                sum += m < 0 ? 0 : in[m];
+            }
+
+            for (j = 0; j < cols; j++)
+            {
+                temp[i][j] = pixel((sum + width / 2) / width);
+
+                //slide the window one pixel to the right
+                m = borderIndex(j + radius + 1, cols, border);
+                sum += m < 0 ? 0 : in[m];
+                m = borderIndex(j - radius, cols, border);
+                sum -= m < 0 ? 0 : in[m];
+            }
+        }
+    });
+
+    //vertical pass back into the array, each thread owns some columns
+    parallelFor(cols, [&](int first, int last)
+    {
+        int i, j, m, n = last - first;
+        vector<int> sums(n, 0);
+
+        //column sums of the window around the first row
+        for (i = -radius; i <= radius; i++)
+        {
+            m = borderIndex(i, rows, border);
+            if (m >= 0)
+            {
+                for (j = 0; j < n; j++)
+                {
+                    sums[j] += temp[m][first + j];
+                }
+            }
+        }
+
+        for (i = 0; i < rows; i++)
+        {
+            for (j = 0; j < n; j++)
+            {
+                array[i][first + j] = pixel((sums[j] + width / 2) / width);
+            }
+
+            //slide the window one row down
+            m = borderIndex(i + radius + 1, rows, border);
+            if (m >= 0)
+            {
+                for (j = 0; j < n; j++)
+                {
+                    sums[j] += temp[m][first + j];
+                }
+            }
+            m = borderIndex(i - radius, rows, border);
+            if (m >= 0)
+            {
+                for (j = 0; j < n; j++)
+                {
+                    sums[j] -= temp[m][first + j];
+                }
+            }
+        }
+    });
+
+    clearArray(temp, rows);
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function blurs the image with a gaussian of the given sigma. For
+ * small sigmas the exact separable kernel is used. For large sigmas the
+ * kernel gets too wide, so three box blurs with running sums are used
+ * instead. Three boxes in a row are very close to a gaussian and cost the
+ * same no matter how large the sigma is.
+ *
+ * @param[in, out] img - the structure where the data of the image is stored
+ * @param[in] sigma - the standard deviation of the gaussian in pixels
+ * @param[in] border - how pixels outside of the image are handled
+ *
+ * @par Example:
+   @verbatim
+
+   image img;
+
+   gaussianBlur(img, 2.0, BORDER_CLAMP);
+   //img is now blurred
+
+   @endverbatim
+
+ ***********************************************************************/
+void gaussianBlur(image& img, double sigma, borderMode border)
+{
+    int i, j, p, radius, size, boxes[3];
+    double sum, ideal;
+    int lower, upper, count;
+    vector<double> kernel;
+    vector<double> line;
+    pixel** planes[3] = { img.redGray, img.green, img.blue };
+
+    if (sigma <= 0.0)
+    {
+        throw invalid_argument("Invalid option values");
+    }
+
+    if (sigma <= BOX_BLUR_SIGMA)
+    {
+        //exact gaussian out to 3 sigma
+        radius = int(ceil(3.0 * sigma));
+        size = 2 * radius + 1;
+        line.resize(size);
+        sum = 0.0;
+        for (i = 0; i < size; i++)
+        {
+            line[i] = exp(-(i - radius) * (i - radius) / (2.0 * sigma * sigma));
+            sum += line[i];
+        }
+
+        //the outer product of the normalized line is the 2D kernel
+        kernel.resize(size_t(size) * size);
+        for (i = 0; i < size; i++)
+        {
+            for (j = 0; j < size; j++)
+            {
+                kernel[i * size + j] = line[i] * line[j] / (sum * sum);
+            }
+        }
+        convolveImage(img, kernel, size, border);
+        return;
+    }
+
+    //widths of three boxes whose variance adds up to sigma squared
+    ideal = sqrt(12.0 * sigma * sigma / 3.0 + 1.0);
+    lower = int(floor(ideal));
+    if (lower % 2 == 0)
+    {
+        lower--;
+    }
+    upper = lower + 2;
+    count = int(lround((12.0 * sigma * sigma - 3.0 * lower * lower
+        - 12.0 * lower - 9.0) / (-4.0 * lower - 4.0)));
+    for (i = 0; i < 3; i++)
+    {
+        boxes[i] = (i < count ? lower : upper) / 2;
+    }
+
+    //the boxes blur every array where it is
+    unshareImage(img);
+    planes[0] = img.redGray;
+    planes[1] = img.green;
+    planes[2] = img.blue;
+    for (p = 0; p < 3; p++)
+    {
+        for (i = 0; i < 3; i++)
+        {
+            boxBlurPlane(planes[p], img.rows, img.cols, boxes[i], border);
+        }
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function sharpens the image with a 3 X 3 kernel that takes amount
+ * times the four neighbors away from the center. An amount of 1 is a
+ * normal sharpen.
+ *
+ * @param[in, out] img - the structure where the data of the image is stored
+ * @param[in] amount - how strong the sharpen is
+ * @param[in] border - how pixels outside of the image are handled
+ *
+ * @par Example:
+   @verbatim
+
+   image img;
+
+   sharpen(img, 1.0, BORDER_CLAMP);
+   //the edges in img are now stronger
+
+   @endverbatim
+
+ ***********************************************************************/
+void sharpen(image& img, double amount, borderMode border)
+{
+    vector<double> kernel =
+    {
+        0.0, -amount, 0.0,
+        -amount, 1.0 + 4.0 * amount, -amount,
+        0.0, -amount, 0.0
+    };
+
+    convolveImage(img, kernel, 3, border);
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function reads a sharpen option. The option looks like
+ * --sharpen, --sharpen=AMOUNT, --sharpen:BORDER or
+ * --sharpen=AMOUNT:BORDER. The amount defaults to 1 and the border to
+ * clamp.
+ *
+ * @param[in] option - the full option string
+ * @param[out] amount - how strong the sharpen is
+ * @param[out] border - the border mode
+ *
+ * @returns true - if the option is valid
+ *
+ * @par Example:
+   @verbatim
+
+   double amount;
+   borderMode border;
+
+   bool valid = parseSharpen("--sharpen:mirror", amount, border);
+   //amount is 1 and border is BORDER_MIRROR
+
+   @endverbatim
+
+ ***********************************************************************/
+bool parseSharpen(string option, double& amount, borderMode& border)
+{
+    string value, number;
+    size_t colon;
+    char* end;
+
+    if (option.compare(0, 9, "--sharpen") != 0)
+    {
+        return false;
+    }
+    value = option.substr(9);
+    colon = value.find(':');
+    number = value.substr(0, colon);
+    amount = 1.0;
+
+    if (!parseBorder(colon == string::npos ? "" : value.substr(colon + 1), border))
+    {
+        return false;
+    }
+    if (number == "")
+    {
+        return true;
+    }
+    if (number[0] != '=' || number.size() == 1)
+    {
+        return false;
+    }
+
+    amount = strtod(number.c_str() + 1, &end);
+    return *end == '\0' && std::isfinite(amount);
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function reads a kernel out of a convolve option. The option looks
+ * like --convolve=1,2,1/2,4,2/1,2,1:mirror. The rows are split by a
+ * slash and the entries by a comma, the border mode after the colon is
+ * optional. The kernel is divided by the sum of its entries unless they
+ * add up to zero, like an edge kernel does.
+ *
+ * @param[in] option - the full option string
+ * @param[out] kernel - the kernel, row by row
+ * @param[out] size - the width and height of the kernel
+ * @param[out] border - the border mode
+ *
+ * @returns true - if the option could be read
+ *
+ * @par Example:
+   @verbatim
+
+   vector<double> kernel;
+   int size;
+   borderMode border;
+   parseConvolve("--convolve=0,1,0/1,1,1/0,1,0", kernel, size, border);
+   //size is 3 and every entry is divided by 5
+
+   @endverbatim
+
+ ***********************************************************************/
+bool parseConvolve(string option, vector<double>& kernel, int& size, borderMode& border)
+{
+    size_t i, colon;
+    int rows = 1;
+    double sum = 0.0;
+    string text = option.substr(option.find('=') + 1);
+    string number;
+
+    //split off the border mode
+    colon = text.find(':');
+    if (!parseBorder(colon == string::npos ? "" : text.substr(colon + 1), border))
+    {
+        return false;
+    }
+    text = text.substr(0, colon);
+
+    //read the numbers, counting the rows
+    kernel.clear();
+    for (i = 0; i <= text.size(); i++)
+    {
+        if (i == text.size() || text[i] == ',' || text[i] == '/')
+        {
+            if (number == "")
+            {
+                return false;
+            }
+            kernel.push_back(atof(number.c_str()));
+            number = "";
+            if (i < text.size() && text[i] == '/')
+            {
+                rows++;
+            }
+        }
+        else
+        {
+            number += text[i];
+        }
+    }
+
+    //the kernel has to be square with an odd size
+    size = rows;
+    if (int(kernel.size()) != size * size || size % 2 == 0)
+    {
+        return false;
+    }
+
+    for (i = 0; i < kernel.size(); i++)
+    {
+        sum += kernel[i];
+    }
+    if (sum != 0.0)
+    {
+        for (i = 0; i < kernel.size(); i++)
+        {
+            kernel[i] /= sum;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,213 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Sobel edge detection done on the gray values of a color image
+ ***********************************************************************/
+#include "netPBM.h"
+#include <cmath>
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function works out the gray values of one row of the image with
+ * the weights of grayOp and stores them with one extra value on each
+ * side for the border. A row outside of the image is mapped back in by
+ * the border mode, a zero border gives a row of 0.
+ *
+ * @param[in] img - the color image
+ * @param[in] i - the row, can be outside of the image
+ * @param[in] border - how positions outside of the image are handled
+ * @param[out] gray - cols + 2 gray values, gray[1] is column 0
+ *
+ * @par Example:
+   @verbatim
+
+   vector<int> gray(img.cols + 2);
+   grayRow(img, -1, BORDER_CLAMP, gray.data());
+   //gray holds the gray values of row 0
+
+   @endverbatim
+
+ ***********************************************************************/
+static void grayRow(const image& img, int i, borderMode border, int* gray)
+{
+    int j, cols = img.cols;
+    const pixel* red;
+    const pixel* green;
+    const pixel* blue;
+
+    i = borderIndex(i, img.rows, border);
+    if (i < 0)
+    {
+        fill(gray, gray + cols + 2, 0);
+        return;
+    }
+
+    //the same sum as grayOp, so this matches grayScale exactly
+    red = img.redGray[i];
+    green = img.green[i];
+    blue = img.blue[i];
+    for (j = 0; j < cols; j++)
+    {
+        gray[j + 1] = int(0.3 * red[j] + 0.6 * green[j] + 0.1 * blue[j]);
+    }
+
+    j = borderIndex(-1, cols, border);
+    gray[0] = j < 0 ? 0 : gray[j + 1];
+    j = borderIndex(cols, cols, border);
+    gray[cols + 1] = j < 0 ? 0 : gray[j + 1];
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function finds the edges of the image with the Sobel operator on
+ * its gray values. The gray values are worked out while the edges are
+ * found, three rows at a time, so the image is read once and no gray
+ * copy of it is ever stored. Every thread takes a band of rows and keeps
+ * its own three rows, when it moves down one row only the new bottom row
+ * is worked out. The result is the length of the gradient, at most 255,
+ * or with a threshold 255 where the length is at least the threshold and
+ * 0 everywhere else. It is written once into a single new array that
+ * the three arrays of the image share, so it is written as P5 or P2.
+ *
+ * @param[in, out] img - the structure where the data of the image is stored
+ * @param[in] threshold - -1 for the length of the gradient, else the
+ *                        length at which a pixel is an edge
+ * @param[in] border - how positions outside of the image are handled
+ *
+ * @par Example:
+   @verbatim
+
+   edgeDetect(img, -1, BORDER_CLAMP);
+   //img holds the edge map of the image
+
+   @endverbatim
+
+ ***********************************************************************/
+void edgeDetect(image& img, int threshold, borderMode border)
+{
+    pixel** out = createArrays(img.rows, img.cols);
+
+    parallelFor(img.rows, [&](int first, int last)
+    {
+        const int cols = img.cols;
+        const int limit = threshold * threshold;
+        int i, j, gx, gy, length;
+        vector<int> window(size_t(cols + 2) * 3);
+        int* above = window.data();
+        int* middle = above + cols + 2;
+        int* below = middle + cols + 2;
+        pixel* to;
+
+        grayRow(img, first - 1, border, above);
+        grayRow(img, first, border, middle);
+
+        for (i = first; i < last; i++)
+        {
+            grayRow(img, i + 1, border, below);
+            to = out[i];
+
+            //gray[j] is column j - 1, so column j uses j, j + 1 and j + 2
+            for (j = 0; j < cols; j++)
+            {
+                gx = above[j + 2] + 2 * middle[j + 2] + below[j + 2] -
+                    above[j] - 2 * middle[j] - below[j];
+                gy = below[j] + 2 * below[j + 1] + below[j + 2] -
+                    above[j] - 2 * above[j + 1] - above[j + 2];
+                length = gx * gx + gy * gy;
+                if (threshold < 0)
+                {
+                    length = int(sqrtf(float(length)));
+                    to[j] = pixel(length > 255 ? 255 : length);
+                }
+                else
+                {
+                    to[j] = pixel(length >= limit ? 255 : 0);
+                }
+            }
+
+            //move the window down one row
+            swap(above, middle);
+            swap(middle, below);
+        }
+    });
+
+    //delete the color arrays, the three arrays share the edges
+    clearArray(img.redGray, img.rows);
+    clearArray(img.green, img.rows);
+    clearArray(img.blue, img.rows);
+    shareArray(out, 2);
+    img.redGray = out;
+    img.green = out;
+    img.blue = out;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function reads an edges option. The option looks like --edges,
+ * --edges=THRESHOLD, --edges:BORDER or --edges=THRESHOLD:BORDER. The
+ * threshold is between 0 and 255 and the border defaults to clamp.
+ *
+ * @param[in] option - the full option string
+ * @param[out] threshold - the threshold, -1 when there is none
+ * @param[out] border - the border mode
+ *
+ * @returns true - if the option is valid
+ *
+ * @par Example:
+   @verbatim
+
+   int threshold;
+   borderMode border;
+
+   bool valid = parseEdges("--edges=64:mirror", threshold, border);
+   //threshold is 64 and border is BORDER_MIRROR
+
+   @endverbatim
+
+ ***********************************************************************/
+bool parseEdges(string option, int& threshold, borderMode& border)
+{
+    string value, number;
+    size_t colon;
+    char* end;
+    long parsed;
+
+    if (option.compare(0, 7, "--edges") != 0)
+    {
+        return false;
+    }
+    value = option.substr(7);
+    colon = value.find(':');
+    number = value.substr(0, colon);
+    threshold = -1;
+
+    if (!parseBorder(colon == string::npos ? "" : value.substr(colon + 1), border))
+    {
+        return false;
+    }
+    if (number == "")
+    {
+        return true;
+    }
+    if (number[0] != '=' || number.size() == 1)
+    {
+        return false;
+    }
+
+    parsed = strtol(number.c_str() + 1, &end, 10);
+    if (*end != '\0' || parsed < 0 || parsed > 255)
+    {
+        return false;
+    }
+    threshold = int(parsed);
+    return true;
+}
@@ -0,0 +1,141 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   One read of an image handled by many options at once
+ ***********************************************************************/
+#include "netPBM.h"
+#include "pixelOps.h"
+#include <thread>
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function handles one branch of a fan out. The branch starts with
+ * the arrays of the decoded image. Every operation that changes pixels
+ * where they are unshares just the arrays it writes, so an option that
+ * makes new arrays or changes one channel copies nothing or one array.
+ * The result is written to basename.ppm, basename.pgm for a gray result
+ * or basename.qoi.
+ *
+ * @param[in] source - the decoded image, its arrays are shared
+ * @param[in] maxPixel - the maximum pixel of the image
+ * @param[in] option - the image manupulation option, - for none
+ * @param[in] type - --binary, --ascii or --qoi
+ * @param[in] basename - the name of the output without the extension
+ *
+ * @par Example:
+   @verbatim
+
+   runBranch(source, 255, "--sepia", "--binary", "sepia");
+
+   @endverbatim
+
+ ***********************************************************************/
+static void runBranch(const image& source, int maxPixel, string option, string type,
+    string basename)
+{
+    ofstream fout;
+    image img = source;
+
+    if (option == "-")
+    {
+        option = "";
+    }
+
+    try
+    {
+        isBinOutputOpen(basename + outputExtension(option, type), fout);
+
+        //copy on write happens inside the operations
+        if (option != "")
+        {
+            handleOptions(option, img);
+        }
+        handleOutput(option, type, img, fout, maxPixel);
+    }
+    catch (exception& error)
+    {
+        cout << basename << ": " << error.what() << endl;
+    }
+
+    clearArray(img.redGray, img.rows);
+    clearArray(img.green, img.rows);
+    clearArray(img.blue, img.rows);
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function reads the image once and writes one output for every
+ * basename and option pair. The decoded arrays are shared by all of the
+ * branches and an array is only copied by a branch that changes it, so
+ * memory grows with the arrays written in place. The branches run at the same time
+ * on their own threads and the work inside each of them is split over
+ * the thread pool of parallelFor. A branch that fails prints its error
+ * and the others still finish.
+ *
+ * @param[in] type - --binary, --ascii or --qoi
+ * @param[in] input - the path of the input image
+ * @param[in] basenames - the output name of each branch
+ * @param[in] options - the option of each branch, - for none
+ *
+ * @par Example:
+   @verbatim
+
+   runFanout("--binary", "image.ppm", { "gray", "sepia", "turned" },
+       { "--grayscale", "--sepia", "--rotateCW" });
+
+   @endverbatim
+
+ ***********************************************************************/
+void runFanout(string type, string input, const vector<string>& basenames,
+    const vector<string>& options)
+{
+    ifstream fin;
+    image source{};
+    int maxPixel;
+    size_t i;
+    vector<thread> branches;
+
+    if (!isOutputType(type))
+    {
+        throw invalid_argument("Invalid output type: " + type);
+    }
+
+    isBinFileOpen(input, fin);
+    try
+    {
+        readFile(fin, source, maxPixel);
+    }
+    catch (...)
+    {
+        clearArray(source.redGray, source.rows);
+        clearArray(source.green, source.rows);
+        clearArray(source.blue, source.rows);
+        throw;
+    }
+    fin.close();
+
+    //every branch owns a share of the arrays
+    shareArray(source.redGray, int(options.size()));
+    shareArray(source.green, int(options.size()));
+    shareArray(source.blue, int(options.size()));
+
+    for (i = 0; i < options.size(); i++)
+    {
+        branches.push_back(thread(runBranch, cref(source), maxPixel, options[i], type,
+            basenames[i]));
+    }
+    for (i = 0; i < branches.size(); i++)
+    {
+        branches[i].join();
+    }
+
+    clearArray(source.redGray, source.rows);
+    clearArray(source.green, source.rows);
+    clearArray(source.blue, source.rows);
+}
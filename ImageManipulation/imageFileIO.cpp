@@ -4,6 +4,96 @@
  * @brief   simple sorts and supporting functions.
  ***********************************************************************/
 #include "netPBM.h"
+#include <cstring>
+#include <sstream>
+
+/************************************************************************
+ *             Constants
+ ***********************************************************************/
+ /*!
+  * @brief rows of an ascii file formatted by one thread at a time
+  */
+const int ASCII_BAND_ROWS = 32;
+
+/*!
+ * @brief rows of a QOI file coded by one thread, every stripe starts with
+ *        an empty index so the stripes can be coded at the same time
+ */
+const int QOI_STRIPE_ROWS = 64;
+
+/*!
+ * @brief bytes of a QOI file read from the stream at a time
+ */
+const int QOI_READ_BYTES = 1 << 16;
+
+/*!
+ * @brief the bytes that end a QOI file
+ */
+const unsigned char QOI_END[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+
+
+/************************************************************************
+ *             Structure
+ ***********************************************************************/
+ /**
+ * @brief The state of a QOI decoder, so a file can be decoded a row at a
+ *        time straight from the stream
+ */
+struct qoiDecoder
+{
+    /**
+    * @brief the pixels seen before, at the hash of their value
+    */
+    unsigned char index[64][4];
+    /**
+    * @brief the last pixel decoded, red, green, blue and alpha
+    */
+    unsigned char px[4];
+    /**
+    * @brief pixels left in the current run
+    */
+    int run;
+    /**
+    * @brief bytes read from the stream and not decoded yet
+    */
+    vector<unsigned char> buffer;
+    /**
+    * @brief the next byte of buffer to decode
+    */
+    size_t at;
+    /**
+    * @brief the number of bytes in buffer
+    */
+    size_t size;
+
+    /**
+    * @brief starts with an empty index and an opaque black pixel
+    */
+    qoiDecoder() : index{}, px{ 0, 0, 0, 255 }, run(0), buffer(QOI_READ_BYTES),
+        at(0), size(0)
+    {
+    }
+
+    /**
+    * @brief the next byte of the file, the buffer is filled when it is empty
+    */
+    unsigned char next(istream& fin)
+    {
+        if (at == size)
+        {
+            fin.read((char*)buffer.data(), buffer.size());
+            size = size_t(fin.gcount());
+            at = 0;
+            if (size == 0)
+            {
+                throw runtime_error("The QOI data is cut short");
+            }
+        }
+        return buffer[at++];
+    }
+
+    void readRow(istream& fin, pixel* row, int cols);
+};
 
 
  /** *********************************************************************
@@ -11,7 +101,8 @@
   *
   * @par Description:
   * This function will open the file with the given name in binary for
-  * input in ate so that we can move around in the file to input data
+  * input in ate so that we can move around in the file to input data.
+  * A file that cannot be opened throws a runtime_error.
   *
   * @param[in] bfile - the name of the binary file to be opened
   * @param[out] fin - the input file stream
@@ -34,11 +125,10 @@ bool isBinFileOpen(string bfile, ifstream& fin)
     //open the files
     fin.open(bfile, ios::in | ios::ate | ios::binary);
 
-    //check if the files were opened if not give a message and exit the program
+    //check if the files were opened
     if (!fin.is_open())
     {
-        cout << "Unable to open binary file: " << bfile;
-        exit(0);
+        throw runtime_error("Unable to open binary file: " + bfile);
     }
     return true;
 }
@@ -49,7 +139,7 @@ bool isBinFileOpen(string bfile, ifstream& fin)
  *
  * @par Description:
  * This function will open the file with the given name in binary for
- * output.
+ * output. A file that cannot be opened throws a runtime_error.
  *
  * @param[in] file - the name of the binary file to be opened
  * @param[out] fout - the output file stream
@@ -71,11 +161,10 @@ bool isBinOutputOpen(string file, ofstream& fout)
     //open the files
     fout.open(file, ios::out | ios::binary);
 
-    //check if the files were opened if not give a message and exit the program
+    //check if the files were opened
     if (!fout.is_open())
     {
-        cout << "Unable to open output file: " << file;
-        exit(0);
+        throw runtime_error("Unable to open output file: " + file);
     }
     return true;
 }
@@ -85,15 +174,23 @@ bool isBinOutputOpen(string file, ofstream& fout)
  * @author Niven Fernandes
  *
  * @par Description:
- * This function will read all the data in the structure. It reads the
- * file till the maxPixel, calls the appropriate functino to read
- * the rest data
+ * This function reads the header of the file, that is the magic number,
+ * the comments, the columns, the rows and the maxPixel. The stream is
+ * left at the first byte of the image data. It does not allocate any
+ * arrays so the caller can decide how the rows are stored. A bad magic
+ * number or size throws a runtime_error. A QOI file gives the magic
+ * number qoif and a maxPixel of 255. A P7 (PAM) file has a header of
+ * names and values ending with ENDHDR, its DEPTH is kept in img.depth.
+ * The stream is read from the
+ * start unless rewind is false, which reads the next header of a stream
+ * that cannot seek, like the frames of a pipe.
  *
- * @param[out] fin - the input stream
- * @param[out] img -  the structure which will store the data
+ * @param[in, out] fin - the input stream
+ * @param[out] img -  the structure which will store the header data
  * @param[out] maxPixel - the varaible which will store the msxPixel
+ * @param[in] rewind - false to read from where the stream is
  *
- * @returns true - if it is able to read all the data
+ * @returns true - if it is able to read the header
  * @par Example:
    @verbatim
 
@@ -101,47 +198,117 @@ bool isBinOutputOpen(string file, ofstream& fout)
    image img;
    int maxPixel;
 
-   bool read =readFile(fin, img, maxPixel)
-   //image will contain all the data from the file
-   // maxPixel will contain the max pixel
+   bool read = readHeader(fin, img, maxPixel)
+   //img.rows, img.cols and img.magicNumber are set,
+   //maxPixel will contain the max pixel
 
    @endverbatim
 
  ***********************************************************************/
-bool readFile(ifstream& fin, image& img, int& maxPixel)
+bool readHeader(istream& fin, image& img, int& maxPixel, bool rewind)
 {
-    bool isComment = true;
-    string line;
-    unsigned char comment;
-    bool read;
+    string line, name;
+    unsigned char head[14];
+    istringstream words;
 
-    //seek to th begaining
-    fin.seekg(0, ios::beg);
+    //seek to th begaining, a stream of frames is read where it is
+    if (rewind)
+    {
+        fin.seekg(0, ios::beg);
+    }
+
+    //a QOI file has a binary header of its own
+    if (fin.peek() == 'q')
+    {
+        fin.read((char*)head, sizeof(head));
+        if (!fin || string((char*)head, 4) != "qoif" || (head[12] != 3 && head[12] != 4))
+        {
+            throw runtime_error("Invalid  magic number");
+        }
+        img.magicNumber = "qoif";
+        img.comment = "";
+        img.cols = int((unsigned(head[4]) << 24) | (head[5] << 16) | (head[6] << 8) | head[7]);
+        img.rows = int((unsigned(head[8]) << 24) | (head[9] << 16) | (head[10] << 8) | head[11]);
+        img.depth = head[12];
+        maxPixel = 255;
+        if (img.rows <= 0 || img.cols <= 0)
+        {
+            throw runtime_error("Invalid image header");
+        }
+        return true;
+    }
     //read the magic number
     fin >> img.magicNumber;
 
-    //if the magic number is not P3 or P6 exit the program
-    if (img.magicNumber != "P3" && img.magicNumber != "P6")
+    //if the magic number is not P2, P3, P5, P6 or P7 exit the program
+    if (img.magicNumber != "P2" && img.magicNumber != "P3" &&
+        img.magicNumber != "P5" && img.magicNumber != "P6" && img.magicNumber != "P7")
     {
-        cout << "Invalid  magic number" << endl;
-        exit(0);
+        throw runtime_error("Invalid  magic number");
     }
 
     //ignore any extra character
     fin.ignore();
 
-    //read the comments
-    while (isComment)
+    //a P7 header is one name and value per line until ENDHDR
+    if (img.magicNumber == "P7")
     {
-        isComment = false;
-        //peek to see if the next line is a comment
-        comment = fin.peek();
-        if (comment = '#')
+        img.comment = "";
+        img.rows = img.cols = img.depth = maxPixel = 0;
+        while (getline(fin, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.pop_back();
+            }
+            if (!line.empty() && line[0] == '#')
+            {
+                img.comment = img.comment + line + '\n';
+                continue;
+            }
+            words.clear();
+            words.str(line);
+            name = "";
+            words >> name;
+            if (name == "ENDHDR")
+            {
+                break;
+            }
+            else if (name == "WIDTH")
+            {
+                words >> img.cols;
+            }
+            else if (name == "HEIGHT")
+            {
+                words >> img.rows;
+            }
+            else if (name == "DEPTH")
+            {
+                words >> img.depth;
+            }
+            else if (name == "MAXVAL")
+            {
+                words >> maxPixel;
+            }
+        }
+
+        //only one byte values of gray or color, with or without alpha
+        if (!fin || name != "ENDHDR" || img.rows <= 0 || img.cols <= 0 ||
+            img.depth < 1 || img.depth > 4 || maxPixel < 1 || maxPixel > 255)
         {
-            getline(fin, line);
-            //use += and '\n' to get multiple line comments
-            img.comment = img.comment + line + '\n';
+            throw runtime_error("Invalid image header");
         }
+        return true;
+    }
+    img.depth = img.magicNumber == "P2" || img.magicNumber == "P5" ? 1 : 3;
+
+    //read the comments, there can be none or many lines of them
+    img.comment = "";
+    while (fin.peek() == '#')
+    {
+        getline(fin, line);
+        //use += and '\n' to get multiple line comments
+        img.comment = img.comment + line + '\n';
     }
 
     //read image columns
@@ -153,21 +320,88 @@ bool readFile(ifstream& fin, image& img, int& maxPixel)
     fin >> maxPixel;
     fin.ignore();
 
+    //the header has to give a usable size
+    if (!fin || img.rows <= 0 || img.cols <= 0)
+    {
+        throw runtime_error("Invalid image header");
+    }
+
+    return true;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function will read all the data in the structure. It calls
+ * readHeader to read the file till the maxPixel, calls the appropriate
+ * functino to read the rest data. If a look up table is given every value
+ * is passed through it as it is stored, so tonal operations cost no extra
+ * pass over the image.
+ *
+ * @param[out] fin - the input stream
+ * @param[out] img -  the structure which will store the data
+ * @param[out] maxPixel - the varaible which will store the msxPixel
+ * @param[in] lut - a look up table to apply while reading, or nullptr
+ * @param[out] stats - histograms of the values in the file, or nullptr
+ *
+ * @returns true - if it is able to read all the data
+ * @par Example:
+   @verbatim
+
+   ifstream fin;
+   image img;
+   int maxPixel;
+
+   bool read =readFile(fin, img, maxPixel)
+   //image will contain all the data from the file
+   // maxPixel will contain the max pixel
+
+   @endverbatim
+
+ ***********************************************************************/
+bool readFile(istream& fin, image& img, int& maxPixel, const pixelLut* lut,
+    imageStats* stats)
+{
+    bool read;
+
+    //read from the magic number till maxPixel
+    readHeader(fin, img, maxPixel);
+
     //call createArray function to create dynamic arrays
     img.redGray = createArrays(img.rows, img.cols);
     img.green = createArrays(img.rows, img.cols);
     img.blue = createArrays(img.rows, img.cols);
 
-    //if magic number is P3 call readFileP# function
-    if (img.magicNumber == "P3")
+    //if magic number is P3 or P2 call readFileP3 function
+    if (img.magicNumber == "P3" || img.magicNumber == "P2")
+    {
+        read = readFileP3(fin, img, lut, stats, maxPixel);
+    }
+
+    //else if magic number is P5 call readFileP5 function
+    else if (img.magicNumber == "P5")
+    {
+        read = readFileP5(fin, img, lut, stats);
+    }
+
+    //else if it is a QOI file call readFileQoi function
+    else if (img.magicNumber == "qoif")
     {
-        read = readFileP3(fin, img);
+        read = readFileQoi(fin, img, lut, stats);
+    }
+
+    //else if it is a PAM file call readFileP7, the alpha is not kept
+    else if (img.magicNumber == "P7")
+    {
+        read = readFileP7(fin, img, nullptr, lut, stats);
     }
 
     //else call readFileP6 funcxtion
     else
     {
-        read = readFileP6(fin, img);
+        read = readFileP6(fin, img, lut, stats);
     }
 
     //return the boolean
@@ -179,51 +413,31 @@ bool readFile(ifstream& fin, image& img, int& maxPixel)
  * @author Niven Fernandes
  *
  * @par Description:
- * reads the integer data from a ascii file which is stored as pixels
- * into the dynamic arrays in  the strucure
+ * This function returns a row buffer of at least size bytes that belongs
+ * to the calling thread. It only grows, so a thread that reads or writes
+ * one frame after another allocates a row once instead of every frame.
  *
- * @param[in, out] fin - the input stream
- * @param[in, out] img - the strucure to which the data is stored to
+ * @param[in] size - the number of bytes needed
+ *
+ * @returns the buffer, valid until the next call on the same thread
  *
- * @returns true - sucessful in reading the file
  * @par Example:
    @verbatim
 
-   ifstream fin;
-   image img;
-   int maxPixel;
-   bool read;
-
-   read=readFileP3(fin, img, maxPixel);
-   //if read is true the data from the ascii file is stored in dynamic
-   //arrays of img
+   pixel* row = scratchRow(size_t(img.cols) * 3);
 
    @endverbatim
 
  ***********************************************************************/
-bool readFileP3(ifstream& fin, image& img)
+static pixel* scratchRow(size_t size)
 {
-    //declare variables
-    int i, j;
-    int input, input1, input2;
+    thread_local vector<pixel> row;
 
-    //go through each row 
-    for (i = 0; i < img.rows; i++)
+    if (row.size() < size)
     {
-        //go through each column
-        for (j = 0; j < img.cols; j++)
-        {
-            //input the data as int into the temp variables
-            fin >> input >> input1 >> input2;
-            //store them as pixels in the array
-            img.redGray[i][j] = pixel(input);
-            img.green[i][j] = pixel(input1);
-            img.blue[i][j] = pixel(input2);
-        }
+        row.resize(size);
     }
-
-    //sucessful in reading
-    return true;
+    return row.data();
 }
 
 
@@ -231,46 +445,24 @@ bool readFileP3(ifstream& fin, image& img)
  * @author Niven Fernandes
  *
  * @par Description:
- * reads the pixel data from a binary file into the dynamic arrays in the
- * strucure
+ * This function tells if a character separates numbers in an ascii file.
  *
- * @returns true - sucessful in reading the file
+ * @param[in] c - the character
  *
- * @param[in, out] fin - the input stream
- * @param[in, out] img - the strucure to which the data is stored to
+ * @returns true - if c is a space, tab, carriage return or new line
  *
  * @par Example:
    @verbatim
 
-   ifstream fin;
-   image img;
-   int maxPixel;
-   bool read;
+   bool space = isSeparator('\n');
+   //space is true
 
-   read=readFileP6(fin, img, maxPixel);
-   //if read is true, the data from the binary file is stored
-   //in dynamic arrays in img
    @endverbatim
 
  ***********************************************************************/
-bool readFileP6(ifstream& fin, image& img)
+bool isSeparator(char c)
 {
-    int i, j;
-
-    //go through each row 
-    for (i = 0; i < img.rows; i++)
-    {
-        //go through each column
-        for (j = 0; j < img.cols; j++)
-        {
-            //use fin.read to input the data in the 2D dynamic array
-            fin.read((char*)&img.redGray[i][j], sizeof(unsigned char));
-            fin.read((char*)&img.green[i][j], sizeof(unsigned char));
-            fin.read((char*)&img.blue[i][j], sizeof(unsigned char));
-        }
-    }
-    //sucessful in reading
-    return true;
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
 }
 
 
@@ -278,54 +470,36 @@ bool readFileP6(ifstream& fin, image& img)
  * @author Niven Fernandes
  *
  * @par Description:
- * This function writes the data from the 2D dynamic array and the maxPixel
- * to the file in ascii. the magic number will be P3
+ * This function gives the text of a value in an ascii file, the number
+ * followed by a new line. The text of every value is made once, so
+ * formatting a value is a copy.
  *
- * @returns true - sucessful in writing the file
+ * @param[in] value - the value
  *
- * @param[in] fout - the output stream
- * @param[in] img - the strucure which has the data
- * @param[in] maxPixel - the maxPixel in the data file
+ * @returns the text of the value
  *
  * @par Example:
    @verbatim
 
-   ofstream fout;
-   image img;
-   //consider we allocate some data to dynamic arrays in img
-   int maxPixel=255;
-   bool write;
+   string line = asciiNumber(42);
+   //line is "42\n"
 
-   write=writeFileP3(fout, img, maxPixel);
-   //if write is true the data from the structure and maxPixel is
-   //written to the file in ascii
    @endverbatim
 
  ***********************************************************************/
-bool writeFileP3(ofstream& fout, image img, int maxPixel)
+const string& asciiNumber(pixel value)
 {
-    int i, j;
-    //write data from the magic number till maxPixel
-    fout << "P3" << '\n';
-    fout << img.comment;
-    fout << img.cols << " " << img.rows << endl;
-    fout << maxPixel << '\n';
-
-    //Go through each row of the array
-    for (i = 0; i < img.rows; i++)
+    static const vector<string> text = []()
     {
-        //Go through each column 
-        for (j = 0; j < img.cols; j++)
+        vector<string> numbers(256);
+        for (int v = 0; v < 256; v++)
         {
-            //write data as int to the file
-            fout << int(img.redGray[i][j]) << endl;
-            fout << int(img.green[i][j]) << endl;
-            fout << int(img.blue[i][j]) << endl;
+            numbers[v] = to_string(v) + '\n';
         }
-    }
+        return numbers;
+    }();
 
-    //sucessful in writing
-    return true;
+    return text[value];
 }
 
 
@@ -333,55 +507,132 @@ bool writeFileP3(ofstream& fout, image img, int maxPixel)
  * @author Niven Fernandes
  *
  * @par Description:
- * This function writes the data from the 2D dynamic array and the maxPixel
- * to the file in binary. The magic number will be P6
- *
- * @returns true - sucessful in writing the file
+ * This function parses the numbers of an ascii raster in parallel. The
+ * text is cut into one chunk per thread, and every cut is moved forward
+ * to the next separator so no number is split. In the first pass every
+ * thread counts the numbers in its chunk. A running total of the counts
+ * gives every chunk the index of its first number. In the second pass
+ * every thread parses its chunk again and stores each number straight
+ * into its row and column of the arrays. With samples set to 1 the
+ * numbers go into redGray only. Too few numbers, a character that is not
+ * a digit or a value over maxPixel throws a runtime_error.
  *
- * @param[in] fout - the output stream
- * @param[in] img - the strucure which has the data
- * @param[in] maxPixel - the maxPixel in the data file
+ * @param[in] text - the raster text after the header
+ * @param[in] size - the number of characters in text
+ * @param[in, out] img - the strucure to which the data is stored to
+ * @param[in] samples - numbers per pixel, 3 for P3 and 1 for P2
+ * @param[in] maxPixel - the largest value allowed
  *
  * @par Example:
    @verbatim
 
-   ofstream fout;
-   image img;
-   //consider we allocate some data to dynamic arrays in img
-   int maxPixel=255;
-   bool write;
+   vector<char> text;
+   //text holds "1 2 3 4 5 6"
+   parseAsciiRaster(text.data(), text.size(), img, 3, 255);
+   //a 2 X 1 image gets the pixels 1,2,3 and 4,5,6
 
-   write=writeFileP6(fout, img, maxPixel);
-   //if write is true the data from the structure and maxPixel is
-   //written to the file in binary
    @endverbatim
 
  ***********************************************************************/
-bool writeFileP6(ofstream& fout, image img, int maxPixel)
+static void parseAsciiRaster(const char* text, size_t size, image& img, int samples,
+    int maxPixel)
 {
-    int i, j;
-
-    //write data from the magic number till maxPixel
-    fout << "P6" << '\n';
-    fout << img.comment;
-    fout << img.cols << " " << img.rows << endl;
-    fout << maxPixel << '\n';
+    int c, chunks = threadCount();
+    size_t total = size_t(img.rows) * img.cols * samples;
+    vector<size_t> bounds(chunks + 1);
+    vector<size_t> counts(chunks + 1, 0);
+    pixel** planes[3] = { img.redGray, img.green, img.blue };
+
+    //cut the text, moving each cut to a separator
+    bounds[0] = 0;
+    bounds[chunks] = size;
+    for (c = 1; c < chunks; c++)
+    {
+        bounds[c] = max(bounds[c - 1], size * c / chunks);
+        while (bounds[c] < size && !isSeparator(text[bounds[c]]))
+        {
+            bounds[c]++;
+        }
+    }
 
-    //Go through each row of the array
-    for (i = 0; i < img.rows; i++)
+    //first pass, count the numbers in every chunk
+    parallelFor(chunks, [&](int first, int last)
     {
-        //Go through each column of the array
-        for (j = 0; j < img.cols; j++)
+        int k;
+        size_t i, count;
+
+        for (k = first; k < last; k++)
         {
-            //write the data as pixels to the binary file
-            fout.write((char*)&img.redGray[i][j], sizeof(unsigned char));
-            fout.write((char*)&img.green[i][j], sizeof(unsigned char));
-            fout.write((char*)&img.blue[i][j], sizeof(unsigned char));
+            count = 0;
+            for (i = bounds[k]; i < bounds[k + 1]; i++)
+            {
+                //a number starts where a separator ends
+                if (!isSeparator(text[i]) && (i == bounds[k] || isSeparator(text[i - 1])))
+                {
+                    count++;
+                }
+            }
+            counts[k + 1] = count;
         }
+    });
+
+    //running total, counts[k] becomes the index of the first number of k
+    for (c = 1; c <= chunks; c++)
+    {
+        counts[c] += counts[c - 1];
+    }
+    if (counts[chunks] < total)
+    {
+        throw runtime_error("The image data is cut short");
     }
 
-    //sucessful in writing
-    return true;
+    //second pass, parse the numbers and store them where they belong
+    parallelFor(chunks, [&](int first, int last)
+    {
+        int k, value;
+        size_t i, index, pix;
+
+        for (k = first; k < last; k++)
+        {
+            index = counts[k];
+            i = bounds[k];
+            while (i < bounds[k + 1] && index < total)
+            {
+                //skip to the next number
+                while (i < bounds[k + 1] && isSeparator(text[i]))
+                {
+                    i++;
+                }
+                if (i == bounds[k + 1])
+                {
+                    break;
+                }
+
+                //stop adding digits once the value is too large
+                value = 0;
+                while (i < bounds[k + 1] && !isSeparator(text[i]))
+                {
+                    if (text[i] < '0' || text[i] > '9')
+                    {
+                        throw runtime_error("The image data has a character that is not a digit");
+                    }
+                    if (value <= maxPixel)
+                    {
+                        value = value * 10 + (text[i] - '0');
+                    }
+                    i++;
+                }
+                if (value > maxPixel)
+                {
+                    throw runtime_error("The image data has a value over the maxPixel");
+                }
+
+                pix = index / samples;
+                planes[index % samples][pix / img.cols][pix % img.cols] = pixel(value);
+                index++;
+            }
+        }
+    });
 }
 
 
@@ -389,103 +640,1346 @@ bool writeFileP6(ofstream& fout, image img, int maxPixel)
  * @author Niven Fernandes
  *
  * @par Description:
- * This function writes the data from img.redGray and the maxPixel
- * to the file in ascii. The magic number will be P2.
- *
- * @returns true - sucessful in writing the file
+ * reads the integer data from a ascii file which is stored as pixels
+ * into the dynamic arrays in  the strucure. The rest of the file is read
+ * into memory at once and parsed by parseAsciiRaster on all threads. A
+ * P2 file has one number per pixel, it is stored in redGray and copied to
+ * green and blue so the image can be used like any other. Missing
+ * numbers, text that is not a number and values over maxPixel throw a
+ * runtime_error.
  *
- * @param[in] fout - the output stream
- * @param[in] img - the strucure which has the img.redGray data
- * @param[in] maxPixel - the maxPixel in the data file
+ * @param[in, out] fin - the input stream
+ * @param[in, out] img - the strucure to which the data is stored to
+ * @param[in] lut - a look up table to apply while reading, or nullptr
+ * @param[out] stats - histograms of the values in the file, or nullptr
+ * @param[in] maxPixel - the maxPixel of the header
  *
+ * @returns true - sucessful in reading the file
  * @par Example:
    @verbatim
 
-   ofstream fout;
+   ifstream fin;
    image img;
-   //consider we allocate some data to dynamic array img.redGray
-   int maxPixel=255;
-   bool write;
+   int maxPixel;
+   bool read;
+
+   read=readFileP3(fin, img, nullptr);
+   //if read is true the data from the ascii file is stored in dynamic
+   //arrays of img
 
-   write = writeGrayP2(fout, img, maxPixel);
-   //if write is true the data from the structure and maxPixel is
-   //written to the file in ascii
    @endverbatim
 
  ***********************************************************************/
-bool writeGrayP2(ofstream& fout, image img, int maxPixel)
+bool readFileP3(istream& fin, image& img, const pixelLut* lut, imageStats* stats,
+    int maxPixel)
 {
-    int i, j;
+    streampos start;
+    size_t size;
+    vector<char> text;
+
+    //read everything after the header into memory
+    start = fin.tellg();
+    fin.seekg(0, ios::end);
+    size = size_t(fin.tellg() - start);
+    fin.seekg(start);
+    text.resize(size);
+    fin.read(text.data(), size);
+
+    //parse on all threads
+    parseAsciiRaster(text.data(), size, img, img.magicNumber == "P2" ? 1 : 3, maxPixel);
+
+    //a gray file fills all three arrays
+    if (img.magicNumber == "P2")
+    {
+        copyArray(img.green, img.redGray, img);
+        copyArray(img.blue, img.redGray, img);
+    }
 
-    //write data from the magic number till maxPixel
-    fout << "P2" << '\n';
-    fout << img.comment;
-    fout << img.cols << " " << img.rows << endl;
-    fout << maxPixel << '\n';
+    //count the values as they are in the file
+    if (stats != nullptr)
+    {
+        computeStats(img, *stats);
+    }
 
-    //Go through each row of the array
-    for (i = 0; i < img.rows; i++)
+    //pass the values through the look up table
+    if (lut != nullptr)
     {
-        //Go through each row of the array
-        for (j = 0; j < img.cols; j++)
-        {
-            //write the data from img.redGray as int to the file
-            fout << int(img.redGray[i][j]) << endl;
-        }
+        applyLut(img, *lut);
     }
-    //sucessful in writing
+
+    //sucessful in reading
     return true;
 }
 
+
 /** *********************************************************************
  * @author Niven Fernandes
  *
  * @par Description:
- * This function writes the data from img.redGray and the maxPixel
- * to the file in binary. The magic number will be P5.
+ * reads the pixel data from a gray binary file into the dynamic arrays
+ * in the strucure. Each row is read straight into redGray and copied to
+ * green and blue so the image can be used like any other.
  *
- * @returns true - sucessful in writing the file
+ * @returns true - sucessful in reading the file
  *
- * @param[in] fout - the output stream
- * @param[in] img - the strucure which has the img.redGray data
- * @param[in] maxPixel - the maxPixel in the data file
+ * @param[in, out] fin - the input stream
+ * @param[in, out] img - the strucure to which the data is stored to
+ * @param[in] lut - a look up table to apply while reading, or nullptr
+ * @param[out] stats - histograms of the values in the file, or nullptr
  *
  * @par Example:
    @verbatim
 
-   ofstream fout;
+   ifstream fin;
    image img;
-   //consider we allocate some data to dynamic array img.redGray
-   int maxPixel=255;
-   bool write;
+   bool read;
 
-   write = writeGrayP5=(fout, img, maxPixel);
-   //if write is true the data from the structure and maxPixel is
-   //written to the file in binary
+   read=readFileP5(fin, img, nullptr);
+   //if read is true, the data from the binary file is stored
+   //in dynamic arrays in img
    @endverbatim
 
  ***********************************************************************/
-bool writeGrayP5(ofstream& fout, image img, int maxPixel)
+bool readFileP5(istream& fin, image& img, const pixelLut* lut, imageStats* stats)
 {
-    int i, j;
+    int i;
 
-    //write data from the magic number till maxPixel
-    fout << "P5" << '\n';
-    fout << img.comment;
-    fout << img.cols << " " << img.rows << endl;
-    fout << maxPixel << '\n';
-
-    //Go through each row of the array
+    //go through each row
     for (i = 0; i < img.rows; i++)
     {
-        //Go through each row of the array
-        for (j = 0; j < img.cols; j++)
-        {
-            //write the data from the array to the files as pixels
-            fout.write((char*)&img.redGray[i][j], sizeof(unsigned char));
-        }
+        fin.read((char*)img.redGray[i], img.cols);
     }
 
+    //a short file is an error like a bad header
+    if (!fin)
+    {
+        throw runtime_error("The image data is cut short");
+    }
+
+    //a gray file fills all three arrays
+    copyArray(img.green, img.redGray, img);
+    copyArray(img.blue, img.redGray, img);
+
+    //count the values as they are in the file
+    if (stats != nullptr)
+    {
+        computeStats(img, *stats);
+    }
+
+    //pass the values through the look up table
+    if (lut != nullptr)
+    {
+        applyLut(img, *lut);
+    }
+
+    //sucessful in reading
+    return true;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * reads the pixel data from a binary file into the dynamic arrays in the
+ * strucure. A whole row is read at a time and split into the three
+ * arrays, passing every value through the look up table if one is given.
+ * If stats is given the histograms are counted from the same row. The row
+ * buffer is kept by the thread from call to call.
+ *
+ * @returns true - sucessful in reading the file
+ *
+ * @param[in, out] fin - the input stream
+ * @param[in, out] img - the strucure to which the data is stored to
+ * @param[in] lut - a look up table to apply while reading, or nullptr
+ * @param[out] stats - histograms of the values in the file, or nullptr
+ *
+ * @par Example:
+   @verbatim
+
+   ifstream fin;
+   image img;
+   int maxPixel;
+   bool read;
+
+   read=readFileP6(fin, img, nullptr);
+   //if read is true, the data from the binary file is stored
+   //in dynamic arrays in img
+   @endverbatim
+
+ ***********************************************************************/
+bool readFileP6(istream& fin, image& img, const pixelLut* lut, imageStats* stats)
+{
+    int i, j;
+    pixel* row = scratchRow(size_t(img.cols) * 3);
+    pixelLut identity;
+
+    //without a table the identity table keeps a single loop
+    if (lut == nullptr)
+    {
+        lutIdentity(identity);
+        lut = &identity;
+    }
+
+    if (stats != nullptr)
+    {
+        clearStats(*stats);
+    }
+
+    //go through each row 
+    for (i = 0; i < img.rows; i++)
+    {
+        //read the whole interleaved row at once
+        fin.read((char*)row, size_t(img.cols) * 3);
+
+        //count the row while it is in the cache
+        if (stats != nullptr)
+        {
+            addRowStats(*stats, row, img.cols);
+        }
+
+        //go through each column
+        for (j = 0; j < img.cols; j++)
+        {
+            //split the row into the 2D dynamic arrays
+            img.redGray[i][j] = lut->table[0][row[j * 3]];
+            img.green[i][j] = lut->table[1][row[j * 3 + 1]];
+            img.blue[i][j] = lut->table[2][row[j * 3 + 2]];
+        }
+    }
+
+    //a short file is an error like a bad header
+    if (!fin)
+    {
+        throw runtime_error("The image data is cut short");
+    }
+    //sucessful in reading
+    return true;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function turns one row of a P7 file into an interleaved color row
+ * like the one of a P6 file. A gray value is spread to all three values
+ * and the alpha, if the row has one, goes to its own row when alpha is
+ * not nullptr. A row without alpha gives 255, which covers everything.
+ *
+ * @param[in] in - the row as it is in the file
+ * @param[in] cols - the number of pixels in the row
+ * @param[in] depth - the values per pixel, 1 to 4
+ * @param[out] rgb - three values per pixel
+ * @param[out] alpha - one alpha per pixel, or nullptr
+ *
+ * @par Example:
+   @verbatim
+
+   pamRow(row.data(), img.cols, 4, rgb.data(), alpha[i]);
+
+   @endverbatim
+
+ ***********************************************************************/
+static void pamRow(const pixel* in, int cols, int depth, pixel* rgb, pixel* alpha)
+{
+    int j;
+
+    for (j = 0; j < cols; j++)
+    {
+        if (depth <= 2)
+        {
+            rgb[j * 3] = rgb[j * 3 + 1] = rgb[j * 3 + 2] = in[j * depth];
+        }
+        else
+        {
+            rgb[j * 3] = in[j * depth];
+            rgb[j * 3 + 1] = in[j * depth + 1];
+            rgb[j * 3 + 2] = in[j * depth + 2];
+        }
+    }
+
+    if (alpha != nullptr)
+    {
+        for (j = 0; j < cols; j++)
+        {
+            alpha[j] = depth == 2 || depth == 4 ? in[j * depth + depth - 1] : 255;
+        }
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * reads the pixel data of a P7 (PAM) file into the dynamic arrays in the
+ * strucure. The header has to be read already so img.depth is known.
+ * Gray, gray with alpha, color and color with alpha are read a row at a
+ * time. The alpha is stored in the arrays alpha if they are given and is
+ * dropped otherwise. The values go through the look up table and are
+ * counted into stats like a P6 file.
+ *
+ * @returns true - sucessful in reading the file
+ *
+ * @param[in, out] fin - the input stream
+ * @param[in, out] img - the strucure to which the data is stored to
+ * @param[out] alpha - arrays of img.rows X img.cols for the alpha, or nullptr
+ * @param[in] lut - a look up table to apply while reading, or nullptr
+ * @param[out] stats - histograms of the values in the file, or nullptr
+ *
+ * @par Example:
+   @verbatim
+
+   ifstream fin;
+   image img;
+   int maxPixel;
+   pixel** alpha;
+
+   readHeader(fin, img, maxPixel);
+   img.redGray = createArrays(img.rows, img.cols);
+   img.green = createArrays(img.rows, img.cols);
+   img.blue = createArrays(img.rows, img.cols);
+   alpha = createArrays(img.rows, img.cols);
+   readFileP7(fin, img, alpha);
+
+   @endverbatim
+
+ ***********************************************************************/
+bool readFileP7(istream& fin, image& img, pixel** alpha, const pixelLut* lut,
+    imageStats* stats)
+{
+    int i, j;
+    vector<pixel> row(size_t(img.cols) * img.depth), rgb(size_t(img.cols) * 3);
+    pixelLut identity;
+
+    //without a table the identity table keeps a single loop
+    if (lut == nullptr)
+    {
+        lutIdentity(identity);
+        lut = &identity;
+    }
+
+    if (stats != nullptr)
+    {
+        clearStats(*stats);
+    }
+
+    for (i = 0; i < img.rows; i++)
+    {
+        fin.read((char*)row.data(), row.size());
+        pamRow(row.data(), img.cols, img.depth, rgb.data(),
+            alpha != nullptr ? alpha[i] : nullptr);
+
+        if (stats != nullptr)
+        {
+            addRowStats(*stats, rgb.data(), img.cols);
+        }
+
+        for (j = 0; j < img.cols; j++)
+        {
+            img.redGray[i][j] = lut->table[0][rgb[j * 3]];
+            img.green[i][j] = lut->table[1][rgb[j * 3 + 1]];
+            img.blue[i][j] = lut->table[2][rgb[j * 3 + 2]];
+        }
+    }
+
+    //a short file is an error like a bad header
+    if (!fin)
+    {
+        throw runtime_error("The P7 data is cut short");
+    }
+    return true;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function writes the pixels of the image as ascii numbers, one
+ * number per line. The rows are done in bands of ASCII_BAND_ROWS rows
+ * per thread. Inside a band every block of rows is formatted by its own
+ * thread into its own buffer, then the buffers are written to the file
+ * in order. Only one band is held in memory at a time.
+ *
+ * @param[out] fout - the output stream
+ * @param[in] img - the strucure which has the data
+ * @param[in] samples - numbers per pixel, 3 for P3 and 1 for P2
+ *
+ * @par Example:
+   @verbatim
+
+   ofstream fout;
+   image img;
+
+   writeAsciiRaster(fout, img, 3);
+   //every pixel of img is written as three lines of text
+
+   @endverbatim
+
+ ***********************************************************************/
+static void writeAsciiRaster(ostream& fout, image img, int samples)
+{
+    int b, band, blocks = threadCount();
+    int bandRows = ASCII_BAND_ROWS * blocks;
+    vector<string> buffers(blocks);
+    pixel** planes[3] = { img.redGray, img.green, img.blue };
+
+    for (band = 0; band < img.rows; band += bandRows)
+    {
+        //every thread formats its own block of the band
+        parallelFor(blocks, [&](int first, int last)
+        {
+            int k, i, j, c, r0, r1;
+
+            for (k = first; k < last; k++)
+            {
+                r0 = min(band + k * ASCII_BAND_ROWS, img.rows);
+                r1 = min(r0 + ASCII_BAND_ROWS, img.rows);
+                buffers[k].clear();
+                buffers[k].reserve(size_t(r1 - r0) * img.cols * samples * 4);
+                for (i = r0; i < r1; i++)
+                {
+                    for (j = 0; j < img.cols; j++)
+                    {
+                        for (c = 0; c < samples; c++)
+                        {
+                            buffers[k] += asciiNumber(planes[c][i][j]);
+                        }
+                    }
+                }
+            }
+        });
+
+        //write the blocks in order
+        for (b = 0; b < blocks; b++)
+        {
+            fout.write(buffers[b].data(), buffers[b].size());
+        }
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function writes the header of a netPBM file, that is the magic
+ * number, the comments, the columns, the rows and the maxPixel.
+ *
+ * @param[out] fout - the output stream
+ * @param[in] magicNumber - P2, P3, P5 or P6
+ * @param[in] img - the strucure which has the size and the comments
+ * @param[in] maxPixel - the maxPixel in the data file
+ *
+ * @par Example:
+   @verbatim
+
+   ofstream fout;
+   image img;
+
+   writeHeader(fout, "P6", img, 255);
+   //P6, the comments, the size and 255 are written to the file
+
+   @endverbatim
+
+ ***********************************************************************/
+void writeHeader(ostream& fout, string magicNumber, image img, int maxPixel)
+{
+    fout << magicNumber << '\n';
+    fout << img.comment;
+    fout << img.cols << " " << img.rows << endl;
+    fout << maxPixel << '\n';
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function writes the pixels of the image without a header, so an
+ * image can also be written a strip of rows at a time. Binary rows are
+ * interleaved into one buffer kept by the thread and written with a
+ * single call, ascii rows are formatted by writeAsciiRaster.
+ *
+ * @param[out] fout - the output stream
+ * @param[in] img - the strucure which has the data
+ * @param[in] samples - numbers per pixel, 3 for color and 1 for gray
+ * @param[in] ascii - true for P3 or P2, false for P6 or P5
+ *
+ * @par Example:
+   @verbatim
+
+   ofstream fout;
+   image strip;
+
+   writeRaster(fout, strip, 3, false);
+   //the rows of strip are written as P6 pixels
+
+   @endverbatim
+
+ ***********************************************************************/
+void writeRaster(ostream& fout, image img, int samples, bool ascii)
+{
+    int i, j;
+    pixel* row;
+
+    if (ascii)
+    {
+        writeAsciiRaster(fout, img, samples);
+        return;
+    }
+    row = scratchRow(size_t(img.cols) * samples);
+
+    for (i = 0; i < img.rows; i++)
+    {
+        if (samples == 1)
+        {
+            fout.write((char*)img.redGray[i], img.cols);
+            continue;
+        }
+
+        //interleave the row
+        for (j = 0; j < img.cols; j++)
+        {
+            row[j * 3] = img.redGray[i][j];
+            row[j * 3 + 1] = img.green[i][j];
+            row[j * 3 + 2] = img.blue[i][j];
+        }
+        fout.write((char*)row, size_t(img.cols) * 3);
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function writes the data from the 2D dynamic array and the maxPixel
+ * to the file in ascii. the magic number will be P3. The numbers are
+ * formatted on all threads by writeAsciiRaster.
+ *
+ * @returns true - sucessful in writing the file
+ *
+ * @param[in] fout - the output stream
+ * @param[in] img - the strucure which has the data
+ * @param[in] maxPixel - the maxPixel in the data file
+ *
+ * @par Example:
+   @verbatim
+
+   ofstream fout;
+   image img;
+   //consider we allocate some data to dynamic arrays in img
+   int maxPixel=255;
+   bool write;
+
+   write=writeFileP3(fout, img, maxPixel);
+   //if write is true the data from the structure and maxPixel is
+   //written to the file in ascii
+   @endverbatim
+
+ ***********************************************************************/
+bool writeFileP3(ostream& fout, image img, int maxPixel)
+{
+    //write data from the magic number till maxPixel
+    writeHeader(fout, "P3", img, maxPixel);
+
+    //format the rows on all threads and write them in order
+    writeRaster(fout, img, 3, true);
+
+    //sucessful in writing
+    return true;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function writes the data from the 2D dynamic array and the maxPixel
+ * to the file in binary. The magic number will be P6
+ *
+ * @returns true - sucessful in writing the file
+ *
+ * @param[in] fout - the output stream
+ * @param[in] img - the strucure which has the data
+ * @param[in] maxPixel - the maxPixel in the data file
+ *
+ * @par Example:
+   @verbatim
+
+   ofstream fout;
+   image img;
+   //consider we allocate some data to dynamic arrays in img
+   int maxPixel=255;
+   bool write;
+
+   write=writeFileP6(fout, img, maxPixel);
+   //if write is true the data from the structure and maxPixel is
+   //written to the file in binary
+   @endverbatim
+
+ ***********************************************************************/
+bool writeFileP6(ostream& fout, image img, int maxPixel)
+{
+    //write data from the magic number till maxPixel
+    writeHeader(fout, "P6", img, maxPixel);
+
+    //write the rows interleaved as pixels
+    writeRaster(fout, img, 3, false);
+
+    //sucessful in writing
+    return true;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function writes the data from img.redGray and the maxPixel
+ * to the file in ascii. The magic number will be P2. The numbers are
+ * formatted on all threads by writeAsciiRaster.
+ *
+ * @returns true - sucessful in writing the file
+ *
+ * @param[in] fout - the output stream
+ * @param[in] img - the strucure which has the img.redGray data
+ * @param[in] maxPixel - the maxPixel in the data file
+ *
+ * @par Example:
+   @verbatim
+
+   ofstream fout;
+   image img;
+   //consider we allocate some data to dynamic array img.redGray
+   int maxPixel=255;
+   bool write;
+
+   write = writeGrayP2(fout, img, maxPixel);
+   //if write is true the data from the structure and maxPixel is
+   //written to the file in ascii
+   @endverbatim
+
+ ***********************************************************************/
+bool writeGrayP2(ostream& fout, image img, int maxPixel)
+{
+    //write data from the magic number till maxPixel
+    writeHeader(fout, "P2", img, maxPixel);
+
+    //format the rows on all threads and write them in order
+    writeRaster(fout, img, 1, true);
+
+    //sucessful in writing
+    return true;
+}
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function writes the data from img.redGray and the maxPixel
+ * to the file in binary. The magic number will be P5.
+ *
+ * @returns true - sucessful in writing the file
+ *
+ * @param[in] fout - the output stream
+ * @param[in] img - the strucure which has the img.redGray data
+ * @param[in] maxPixel - the maxPixel in the data file
+ *
+ * @par Example:
+   @verbatim
+
+   ofstream fout;
+   image img;
+   //consider we allocate some data to dynamic array img.redGray
+   int maxPixel=255;
+   bool write;
+
+   write = writeGrayP5=(fout, img, maxPixel);
+   //if write is true the data from the structure and maxPixel is
+   //written to the file in binary
+   @endverbatim
+
+ ***********************************************************************/
+bool writeGrayP5(ostream& fout, image img, int maxPixel)
+{
+    //write data from the magic number till maxPixel
+    writeHeader(fout, "P5", img, maxPixel);
+
+    //write the rows of img.redGray as pixels
+    writeRaster(fout, img, 1, false);
+
+    //sucessful in writing
+    return true;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function reads the raster of a file one row at a time, after the
+ * header has been read, and hands every row to use as interleaved red,
+ * green and blue values. Gray rows are spread out to three equal values
+ * and the alpha of a P7 file is dropped. Only one row is kept at a time,
+ * so a file of any size can be passed through in the memory of one row.
+ *
+ * @param[in, out] fin - the input stream, just past the header
+ * @param[in] magicNumber - the magic number from the header
+ * @param[in] rows - the number of rows
+ * @param[in] cols - the number of columns
+ * @param[in] depth - the number of values per pixel in the file
+ * @param[in] use - called with each row and its index, the row is
+ *                  only valid until it returns
+ *
+ * @par Example:
+   @verbatim
+
+   readHeader(fin, img, maxPixel);
+   readRows(fin, img.magicNumber, img.rows, img.cols, img.depth,
+       [&](const pixel* row, int i)
+   {
+       //row[j * 3] is the red value of column j of row i
+   });
+
+   @endverbatim
+
+ ***********************************************************************/
+void readRows(istream& fin, string magicNumber, int rows, int cols, int depth,
+    const function<void(const pixel*, int)>& use)
+{
+    int i, j;
+    int input, input1, input2;
+    vector<pixel> row, pam;
+    qoiDecoder qoi;
+
+    row.resize(size_t(cols) * 3);
+    if (magicNumber == "P7")
+    {
+        pam.resize(size_t(cols) * depth);
+    }
+
+    for (i = 0; i < rows; i++)
+    {
+        if (magicNumber == "P6")
+        {
+            fin.read((char*)row.data(), row.size());
+        }
+        else if (magicNumber == "qoif")
+        {
+            qoi.readRow(fin, row.data(), cols);
+        }
+        else if (magicNumber == "P7")
+        {
+            fin.read((char*)pam.data(), pam.size());
+            pamRow(pam.data(), cols, depth, row.data(), nullptr);
+        }
+        else if (magicNumber == "P5")
+        {
+            //read the gray row at the front and spread it out backwards
+            fin.read((char*)row.data(), cols);
+            for (j = cols - 1; j >= 0; j--)
+            {
+                row[j * 3] = row[j * 3 + 1] = row[j * 3 + 2] = row[j];
+            }
+        }
+        else if (magicNumber == "P2")
+        {
+            for (j = 0; j < cols; j++)
+            {
+                fin >> input;
+                row[j * 3] = row[j * 3 + 1] = row[j * 3 + 2] = pixel(input);
+            }
+        }
+        else
+        {
+            for (j = 0; j < cols; j++)
+            {
+                fin >> input >> input1 >> input2;
+                row[j * 3] = pixel(input);
+                row[j * 3 + 1] = pixel(input1);
+                row[j * 3 + 2] = pixel(input2);
+            }
+        }
+
+        use(row.data(), i);
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function reads the file and shrinks it by a whole number factor
+ * while it is reading. Every factor X factor block of the input becomes
+ * one pixel holding the average of the block. Only one input row is kept
+ * at a time, the rows are added into running sums and a output row is
+ * written every factor input rows. The full size image is never stored so
+ * the memory used depends only on the output size. Blocks on the right
+ * and bottom edge that are not full are averaged over the pixels they have.
+ * A QOI file is decoded a row at a time the same way.
+ *
+ * @param[in, out] fin - the input stream
+ * @param[out] img - the structure which will store the reduced image
+ * @param[out] maxPixel - the varaible which will store the msxPixel
+ * @param[in] factor - how many input pixels make one output pixel
+ *                     in each direction
+ *
+ * @returns true - if it is able to read all the data
+ * @par Example:
+   @verbatim
+
+   ifstream fin;
+   image img;
+   int maxPixel;
+
+   bool read = readFileThumbnail(fin, img, maxPixel, 4);
+   //a 4000 X 3000 file is stored in img as a 1000 X 750 image
+
+   @endverbatim
+
+ ***********************************************************************/
+bool readFileThumbnail(istream& fin, image& img, int& maxPixel, int factor)
+{
+    int outRows, outCols;
+    int inRows, inCols;
+    vector<unsigned int> sums;
+
+    //read from the magic number till maxPixel
+    readHeader(fin, img, maxPixel);
+
+    if (factor < 1)
+    {
+        throw invalid_argument("Invalid thumbnail factor");
+    }
+
+    //round up so the partial blocks on the edge are kept
+    outRows = (img.rows + factor - 1) / factor;
+    outCols = (img.cols + factor - 1) / factor;
+
+    //the structure describes the reduced image from here on, so the
+    //arrays can be cleared with the right size if an allocation fails
+    inRows = img.rows;
+    inCols = img.cols;
+    img.rows = outRows;
+    img.cols = outCols;
+
+    //only the output image is allocated
+    img.redGray = createArrays(outRows, outCols);
+    img.green = createArrays(outRows, outCols);
+    img.blue = createArrays(outRows, outCols);
+
+    //the running sums for one output row
+    sums.assign(size_t(outCols) * 3, 0);
+
+    readRows(fin, img.magicNumber, inRows, inCols, img.depth,
+        [&](const pixel* row, int i)
+    {
+        int j, k, outRow, blockRows, count;
+
+        //add the row into the sums of the blocks it belongs to
+        for (j = 0; j < inCols; j++)
+        {
+            k = (j / factor) * 3;
+            sums[k] += row[j * 3];
+            sums[k + 1] += row[j * 3 + 1];
+            sums[k + 2] += row[j * 3 + 2];
+        }
+
+        //the last row of a block, or of the image, finishes a output row
+        if ((i + 1) % factor == 0 || i == inRows - 1)
+        {
+            outRow = i / factor;
+            blockRows = i - outRow * factor + 1;
+
+            for (j = 0; j < outCols; j++)
+            {
+                //the last block in a row can be narrower
+                count = blockRows * min(factor, inCols - j * factor);
+                img.redGray[outRow][j] = pixel((sums[j * 3] + count / 2) / count);
+                img.green[outRow][j] = pixel((sums[j * 3 + 1] + count / 2) / count);
+                img.blue[outRow][j] = pixel((sums[j * 3 + 2] + count / 2) / count);
+            }
+
+            //start the next block with empty sums
+            fill(sums.begin(), sums.end(), 0);
+        }
+    });
+
+    //sucessful in reading
+    return true;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function decodes the next row of a QOI file into an interleaved
+ * row of red, green and blue values. The alpha of a RGBA file is read
+ * and dropped.
+ *
+ * @param[in, out] fin - the input stream, after the QOI header
+ * @param[out] row - cols X 3 values
+ * @param[in] cols - the columns of the image
+ *
+ * @par Example:
+   @verbatim
+
+   qoiDecoder qoi;
+   vector<pixel> row(img.cols * 3);
+   qoi.readRow(fin, row.data(), img.cols);
+
+   @endverbatim
+
+ ***********************************************************************/
+void qoiDecoder::readRow(istream& fin, pixel* row, int cols)
+{
+    int j, green;
+    unsigned char op, more;
+
+    for (j = 0; j < cols; j++)
+    {
+        if (run > 0)
+        {
+            run--;
+        }
+        else
+        {
+            op = next(fin);
+
+            //QOI_OP_RGB and QOI_OP_RGBA
+            if (op == 0xfe || op == 0xff)
+            {
+                px[0] = next(fin);
+                px[1] = next(fin);
+                px[2] = next(fin);
+                if (op == 0xff)
+                {
+                    px[3] = next(fin);
+                }
+            }
+
+            //QOI_OP_INDEX
+            else if ((op & 0xc0) == 0x00)
+            {
+                memcpy(px, index[op], 4);
+            }
+
+            //QOI_OP_DIFF
+            else if ((op & 0xc0) == 0x40)
+            {
+                px[0] += ((op >> 4) & 0x03) - 2;
+                px[1] += ((op >> 2) & 0x03) - 2;
+                px[2] += (op & 0x03) - 2;
+            }
+
+            //QOI_OP_LUMA
+            else if ((op & 0xc0) == 0x80)
+            {
+                more = next(fin);
+                green = (op & 0x3f) - 32;
+                px[0] += green - 8 + ((more >> 4) & 0x0f);
+                px[1] += green;
+                px[2] += green - 8 + (more & 0x0f);
+            }
+
+            //QOI_OP_RUN, this pixel and run more
+            else
+            {
+                run = op & 0x3f;
+            }
+
+            memcpy(index[(px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64], px, 4);
+        }
+
+        row[j * 3] = px[0];
+        row[j * 3 + 1] = px[1];
+        row[j * 3 + 2] = px[2];
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * reads the pixel data of a QOI file into the dynamic arrays in the
+ * strucure. Each row is decoded into an interleaved row and split into
+ * the three arrays the same way readFileP6 does, passing every value
+ * through the look up table if one is given. If stats is given the
+ * histograms are counted from the same row.
+ *
+ * @returns true - sucessful in reading the file
+ *
+ * @param[in, out] fin - the input stream, after the QOI header
+ * @param[in, out] img - the strucure to which the data is stored to
+ * @param[in] lut - a look up table to apply while reading, or nullptr
+ * @param[out] stats - histograms of the values in the file, or nullptr
+ *
+ * @par Example:
+   @verbatim
+
+   ifstream fin;
+   image img;
+
+   bool read = readFileQoi(fin, img);
+
+   @endverbatim
+
+ ***********************************************************************/
+bool readFileQoi(istream& fin, image& img, const pixelLut* lut, imageStats* stats)
+{
+    int i, j;
+    vector<pixel> row(size_t(img.cols) * 3);
+    pixelLut identity;
+    qoiDecoder qoi;
+
+    //without a table the identity table keeps a single loop
+    if (lut == nullptr)
+    {
+        lutIdentity(identity);
+        lut = &identity;
+    }
+
+    if (stats != nullptr)
+    {
+        clearStats(*stats);
+    }
+
+    for (i = 0; i < img.rows; i++)
+    {
+        qoi.readRow(fin, row.data(), img.cols);
+
+        if (stats != nullptr)
+        {
+            addRowStats(*stats, row.data(), img.cols);
+        }
+
+        for (j = 0; j < img.cols; j++)
+        {
+            img.redGray[i][j] = lut->table[0][row[j * 3]];
+            img.green[i][j] = lut->table[1][row[j * 3 + 1]];
+            img.blue[i][j] = lut->table[2][row[j * 3 + 2]];
+        }
+    }
+
+    //sucessful in reading
+    return true;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function codes the rows first to last of the image as QOI chunks
+ * at the end of out. The stripe starts with an empty index and only uses
+ * index entries it wrote itself, so any decoder reading the stripes one
+ * after the other has the same entries and the stripes can be coded on
+ * different threads. The previous pixel is the last pixel of the row
+ * before the stripe, which the decoder also has.
+ *
+ * @param[in] img - the strucure which has the data
+ * @param[in] first - the first row of the stripe
+ * @param[in] last - one past the last row of the stripe
+ * @param[out] out - the bytes of the stripe
+ *
+ * @par Example:
+   @verbatim
+
+   vector<unsigned char> out;
+   writeQoiStripe(img, 0, 64, out);
+
+   @endverbatim
+
+ ***********************************************************************/
+static void writeQoiStripe(const image& img, int first, int last, vector<unsigned char>& out)
+{
+    int i, j, run = 0, hash;
+    int dr, dg, db, drg, dbg;
+    unsigned char index[64][3];
+    bool used[64] = {};
+    unsigned char r, g, b, pr = 0, pg = 0, pb = 0;
+
+    if (first > 0)
+    {
+        pr = img.redGray[first - 1][img.cols - 1];
+        pg = img.green[first - 1][img.cols - 1];
+        pb = img.blue[first - 1][img.cols - 1];
+    }
+
+    out.clear();
+    out.reserve(size_t(last - first) * img.cols * 2);
+    for (i = first; i < last; i++)
+    {
+        for (j = 0; j < img.cols; j++)
+        {
+            r = img.redGray[i][j];
+            g = img.green[i][j];
+            b = img.blue[i][j];
+
+            //QOI_OP_RUN
+            if (r == pr && g == pg && b == pb)
+            {
+                if (++run == 62)
+                {
+                    out.push_back(0xc0 | (run - 1));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0)
+            {
+                out.push_back(0xc0 | (run - 1));
+                run = 0;
+            }
+
+            //QOI_OP_INDEX, the alpha is always 255
+            hash = (r * 3 + g * 5 + b * 7 + 255 * 11) % 64;
+            if (used[hash] && index[hash][0] == r && index[hash][1] == g && index[hash][2] == b)
+            {
+                out.push_back((unsigned char)hash);
+            }
+            else
+            {
+                used[hash] = true;
+                index[hash][0] = r;
+                index[hash][1] = g;
+                index[hash][2] = b;
+
+                dr = (signed char)(r - pr);
+                dg = (signed char)(g - pg);
+                db = (signed char)(b - pb);
+                drg = dr - dg;
+                dbg = db - dg;
+
+                //QOI_OP_DIFF
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                {
+                    out.push_back(0x40 | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2));
+                }
+
+                //QOI_OP_LUMA
+                else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 &&
+                    dbg >= -8 && dbg <= 7)
+                {
+                    out.push_back(0x80 | (dg + 32));
+                    out.push_back(((drg + 8) << 4) | (dbg + 8));
+                }
+
+                //QOI_OP_RGB
+                else
+                {
+                    out.push_back(0xfe);
+                    out.push_back(r);
+                    out.push_back(g);
+                    out.push_back(b);
+                }
+            }
+            pr = r;
+            pg = g;
+            pb = b;
+        }
+    }
+
+    //a run never goes on into the next stripe
+    if (run > 0)
+    {
+        out.push_back(0xc0 | (run - 1));
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * Writes the image as a QOI file, a fast lossless format. The rows are
+ * coded in stripes of QOI_STRIPE_ROWS rows, a band of stripes at a time
+ * with every stripe of a band on its own thread, then the stripes are
+ * written in order. The result is one ordinary QOI file that any QOI
+ * decoder reads. A gray image is written with three equal channels.
+ *
+ * @param[out] fout - the output stream
+ * @param[in] img - the strucure which has the data
+ *
+ * @returns true - sucessful in writing
+ *
+ * @par Example:
+   @verbatim
+
+   ofstream fout;
+   image img;
+
+   writeFileQoi(fout, img);
+   //the image is in fout as a QOI file
+
+   @endverbatim
+
+ ***********************************************************************/
+bool writeFileQoi(ostream& fout, image img)
+{
+    int b, band, blocks = threadCount();
+    int bandRows = QOI_STRIPE_ROWS * blocks;
+    vector<vector<unsigned char>> stripes(blocks);
+    unsigned char head[14] = { 'q', 'o', 'i', 'f' };
+
+    //the width and height are big endian, 3 channels in the sRGB space
+    head[4] = (unsigned char)(img.cols >> 24);
+    head[5] = (unsigned char)(img.cols >> 16);
+    head[6] = (unsigned char)(img.cols >> 8);
+    head[7] = (unsigned char)img.cols;
+    head[8] = (unsigned char)(img.rows >> 24);
+    head[9] = (unsigned char)(img.rows >> 16);
+    head[10] = (unsigned char)(img.rows >> 8);
+    head[11] = (unsigned char)img.rows;
+    head[12] = 3;
+    head[13] = 0;
+    fout.write((char*)head, sizeof(head));
+
+    for (band = 0; band < img.rows; band += bandRows)
+    {
+        //every thread codes its own stripe of the band
+        parallelFor(blocks, [&](int first, int last)
+        {
+            int k, r0;
+
+            for (k = first; k < last; k++)
+            {
+                r0 = min(band + k * QOI_STRIPE_ROWS, img.rows);
+                writeQoiStripe(img, r0, min(r0 + QOI_STRIPE_ROWS, img.rows), stripes[k]);
+            }
+        });
+
+        //write the stripes in order
+        for (b = 0; b < blocks; b++)
+        {
+            fout.write((char*)stripes[b].data(), stripes[b].size());
+        }
+    }
+
+    fout.write((const char*)QOI_END, sizeof(QOI_END));
+
     //sucessful in writing
     return true;
 }
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function halves two rows of an array into one, every 2 X 2 block
+ * becomes the rounded average of its four values. When cols is odd the
+ * last column is averaged with itself, so the output has (cols + 1) / 2
+ * values. The same row can be passed as top and bottom for the last row
+ * of an odd number of rows.
+ *
+ * @param[in] top - the first row
+ * @param[in] bottom - the second row
+ * @param[out] out - the halved row
+ * @param[in] cols - the number of values in top and bottom
+ *
+ * @par Example:
+   @verbatim
+
+   pixel top[3] = { 10, 20, 30 }, bottom[3] = { 30, 40, 50 }, out[2];
+   halveRow(top, bottom, out, 3);
+   //out is 25, 40
+
+   @endverbatim
+
+ ***********************************************************************/
+void halveRow(const pixel* top, const pixel* bottom, pixel* out, int cols)
+{
+    int j;
+
+    for (j = 0; j < cols / 2; j++)
+    {
+        out[j] = pixel((top[j * 2] + top[j * 2 + 1] +
+            bottom[j * 2] + bottom[j * 2 + 1] + 2) >> 2);
+    }
+    if (cols % 2 == 1)
+    {
+        out[j] = pixel((top[cols - 1] + bottom[cols - 1] + 1) >> 1);
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * Writes the arrays of the image as raw planes with no header, the red
+ * array, then the green, then the blue, each row by row. After a YCbCr
+ * conversion that is the Y, Cb and Cr planes of a planar YUV file. With
+ * subsample the last two planes are averaged over 2 X 2 blocks, half the
+ * rows and columns rounded up, which is 4:2:0 like yuv420p. The small
+ * planes are worked out on all threads. A gray image writes only the
+ * first plane.
+ *
+ * @param[out] fout - the output stream
+ * @param[in] img - the strucure which has the data
+ * @param[in] subsample - true for 4:2:0 instead of 4:4:4
+ * @param[in] gray - true to write only the first plane
+ *
+ * @returns true - sucessful in writing
+ *
+ * @par Example:
+   @verbatim
+
+   ofstream fout;
+   image img;
+
+   writePlanar(fout, img, true, false);
+   //fout has the Y plane, then Cb and Cr at a quarter of the size
+
+   @endverbatim
+
+ ***********************************************************************/
+bool writePlanar(ostream& fout, image img, bool subsample, bool gray)
+{
+    int i, c;
+    int rows = (img.rows + 1) / 2, cols = (img.cols + 1) / 2;
+    pixel** planes[3] = { img.redGray, img.green, img.blue };
+    vector<pixel> small;
+
+    for (i = 0; i < img.rows; i++)
+    {
+        fout.write((char*)img.redGray[i], img.cols);
+    }
+
+    for (c = 1; c < 3 && !gray; c++)
+    {
+        if (!subsample)
+        {
+            for (i = 0; i < img.rows; i++)
+            {
+                fout.write((char*)planes[c][i], img.cols);
+            }
+            continue;
+        }
+
+        //the average of every 2 X 2 block, the last row and column of an
+        //odd size are used twice
+        small.resize(size_t(rows) * cols);
+        parallelFor(rows, [&](int first, int last)
+        {
+            int k;
+
+            for (k = first; k < last; k++)
+            {
+                halveRow(planes[c][k * 2], planes[c][min(k * 2 + 1, img.rows - 1)],
+                    small.data() + size_t(k) * cols, img.cols);
+            }
+        });
+        fout.write((char*)small.data(), small.size());
+    }
+
+    return true;
+}
@@ -0,0 +1,534 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Library interface to decode, change and encode images in memory
+ ***********************************************************************/
+#include "imageLibrary.h"
+#include "pixelOps.h"
+#include <streambuf>
+#include <cstring>
+#include <climits>
+
+
+/************************************************************************
+ *             Structure
+ ***********************************************************************/
+ /**
+* @brief A stream buffer writing into a buffer of fixed size owned by the
+*        caller. Bytes that do not fit are only counted.
+*/
+struct memoryOutput : streambuf
+{
+    /**
+    * @brief bytes that did not fit in the buffer
+    */
+    size_t dropped = 0;
+
+    /**
+    * @brief writes to the capacity bytes at buffer
+    */
+    memoryOutput(char* buffer, size_t capacity)
+    {
+        setp(buffer, buffer + capacity);
+    }
+
+    /**
+    * @brief counts a byte that does not fit
+    */
+    int_type overflow(int_type c) override
+    {
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            dropped++;
+        }
+        return traits_type::not_eof(c);
+    }
+
+    /**
+    * @brief copies as much as fits and counts the rest
+    */
+    streamsize xsputn(const char* data, streamsize count) override
+    {
+        streamsize left = count;
+        int room;
+
+        while (left > 0 && epptr() > pptr())
+        {
+            room = int(min<streamsize>(min<streamsize>(left, epptr() - pptr()), INT_MAX));
+            memcpy(pptr(), data, size_t(room));
+            pbump(room);
+            data += room;
+            left -= room;
+        }
+        dropped += size_t(left);
+        return count;
+    }
+
+    /**
+    * @brief the number of bytes the image needs
+    */
+    size_t needed() const
+    {
+        return size_t(pptr() - pbase()) + dropped;
+    }
+};
+
+/**
+* @brief A stream buffer appending to a vector owned by the caller
+*/
+struct vectorOutput : streambuf
+{
+    /**
+    * @brief the vector the bytes are added to
+    */
+    vector<unsigned char>& out;
+
+    /**
+    * @brief appends to out
+    */
+    vectorOutput(vector<unsigned char>& bytes) : out(bytes)
+    {
+    }
+
+    /**
+    * @brief appends one byte
+    */
+    int_type overflow(int_type c) override
+    {
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            out.push_back((unsigned char)c);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    /**
+    * @brief appends count bytes
+    */
+    streamsize xsputn(const char* data, streamsize count) override
+    {
+        out.insert(out.end(), data, data + count);
+        return count;
+    }
+};
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function tells if the three arrays of the image hold the same
+ * values, so the image can be written as a gray image.
+ *
+ * @param[in] img - the structure having the data
+ *
+ * @returns true - if every pixel is gray
+ *
+ * @par Example:
+   @verbatim
+
+   image img;
+   bool gray = isGrayImage(img);
+
+   @endverbatim
+
+ ***********************************************************************/
+static bool isGrayImage(const image& img)
+{
+    int i;
+
+    for (i = 0; i < img.rows; i++)
+    {
+        if (memcmp(img.redGray[i], img.green[i], size_t(img.cols)) != 0 ||
+            memcmp(img.redGray[i], img.blue[i], size_t(img.cols)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * The constructor makes an empty image with no arrays.
+ *
+ * @par Example:
+   @verbatim
+
+   netpbmImage picture;
+   //picture.rows() is 0
+
+   @endverbatim
+
+ ***********************************************************************/
+netpbmImage::netpbmImage() : img{}, maxValue(255), gray(false)
+{
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * The copy constructor makes new arrays and copies the pixels of the
+ * other image into them.
+ *
+ * @param[in] other - the image to copy
+ *
+ * @par Example:
+   @verbatim
+
+   netpbmImage copy(picture);
+
+   @endverbatim
+
+ ***********************************************************************/
+netpbmImage::netpbmImage(const netpbmImage& other) : netpbmImage()
+{
+    img.magicNumber = other.img.magicNumber;
+    img.comment = other.img.comment;
+    maxValue = other.maxValue;
+    gray = other.gray;
+
+    if (other.img.redGray == nullptr)
+    {
+        return;
+    }
+
+    try
+    {
+        img.rows = other.img.rows;
+        img.cols = other.img.cols;
+        img.redGray = createArrays(img.rows, img.cols);
+        img.green = createArrays(img.rows, img.cols);
+        img.blue = createArrays(img.rows, img.cols);
+    }
+    catch (bad_alloc&)
+    {
+        release();
+        throw;
+    }
+    copyArray(img.redGray, other.img.redGray, img);
+    copyArray(img.green, other.img.green, img);
+    copyArray(img.blue, other.img.blue, img);
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * The move constructor takes the arrays of the other image and leaves it
+ * empty.
+ *
+ * @param[in, out] other - the image to take the arrays from
+ *
+ * @par Example:
+   @verbatim
+
+   netpbmImage moved(std::move(picture));
+
+   @endverbatim
+
+ ***********************************************************************/
+netpbmImage::netpbmImage(netpbmImage&& other) noexcept : img(other.img),
+    maxValue(other.maxValue), gray(other.gray)
+{
+    other.img = image{};
+    other.gray = false;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * The destructor deletes the arrays of the image.
+ *
+ * @par Example:
+   @verbatim
+
+   {
+       netpbmImage picture;
+   }
+   //the arrays of picture are deleted
+
+   @endverbatim
+
+ ***********************************************************************/
+netpbmImage::~netpbmImage()
+{
+    release();
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * The assignment operator takes a copy, or a moved image, and swaps it
+ * with this image. The old arrays are deleted with the copy.
+ *
+ * @param[in] other - the image to assign
+ *
+ * @returns this image
+ *
+ * @par Example:
+   @verbatim
+
+   netpbmImage a, b;
+   a = b;
+
+   @endverbatim
+
+ ***********************************************************************/
+netpbmImage& netpbmImage::operator=(netpbmImage other) noexcept
+{
+    swap(img, other.img);
+    swap(maxValue, other.maxValue);
+    swap(gray, other.gray);
+    return *this;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function deletes the arrays and leaves an empty image.
+ *
+ * @par Example:
+   @verbatim
+
+   release();
+
+   @endverbatim
+
+ ***********************************************************************/
+void netpbmImage::release()
+{
+    clearArray(img.redGray, img.rows);
+    clearArray(img.green, img.rows);
+    clearArray(img.blue, img.rows);
+    img = image{};
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function decodes a P2, P3, P5 or P6 image from size bytes in
+ * memory. The bytes are read in place without a copy. The option is
+ * handled the same way as on the command line, so a thumbnail or tone
+ * option is done while the bytes are decoded. If anything throws the
+ * image keeps what it held before.
+ *
+ * @param[in] data - the bytes of the netPBM image
+ * @param[in] size - the number of bytes
+ * @param[in] option - the image manupulation option, can be empty
+ *
+ * @par Example:
+   @verbatim
+
+   netpbmImage picture;
+   picture.decode(bytes.data(), bytes.size(), "--thumbnail=4");
+
+   @endverbatim
+
+ ***********************************************************************/
+void netpbmImage::decode(const void* data, size_t size, string option)
+{
+    memoryInput buffer((const char*)data, size);
+    istream in(&buffer);
+    netpbmImage decoded;
+
+    processImage(in, option, decoded.img, decoded.maxValue);
+    decoded.maxValue = outputMaxPixel(option, decoded.maxValue);
+    decoded.gray = isGrayChain(option) ||
+        ((decoded.img.magicNumber == "P2" || decoded.img.magicNumber == "P5") &&
+            isGrayImage(decoded.img));
+
+    *this = move(decoded);
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function runs one option on the image, any option handleOptions
+ * knows. A gray image stays gray as long as the option leaves the three
+ * arrays the same.
+ *
+ * @param[in] option - the image manupulation option
+ *
+ * @par Example:
+   @verbatim
+
+   picture.apply("--sepia");
+   picture.apply("--resize=320x200:lanczos");
+
+   @endverbatim
+
+ ***********************************************************************/
+void netpbmImage::apply(string option)
+{
+    if (img.redGray == nullptr)
+    {
+        throw runtime_error("No image has been decoded");
+    }
+
+    //an option like --edges leaves one array shared by all three,
+    //the next option needs arrays of its own
+    unshareArray(img.green, img.rows, img.cols);
+    unshareArray(img.blue, img.rows, img.cols);
+
+    handleOptions(option, img);
+    gray = isGrayChain(option) || (gray && isGrayImage(img));
+    maxValue = outputMaxPixel(option, maxValue);
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function encodes the image to any output stream. A gray image is
+ * written as P5 or P2 and a color image as P6 or P3.
+ *
+ * @param[out] sink - the output stream
+ * @param[in] binary - true for P5 or P6, false for P2 or P3
+ *
+ * @par Example:
+   @verbatim
+
+   ostringstream out;
+   picture.encode(out, true);
+
+   @endverbatim
+
+ ***********************************************************************/
+void netpbmImage::encode(ostream& sink, bool binary) const
+{
+    if (img.redGray == nullptr)
+    {
+        throw runtime_error("No image has been decoded");
+    }
+
+    handleOutput(gray ? "--grayscale" : "", binary ? "--binary" : "--ascii",
+        img, sink, maxValue);
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function encodes the image to the end of a vector of bytes.
+ *
+ * @param[out] out - the vector the image is added to
+ * @param[in] binary - true for P5 or P6, false for P2 or P3
+ *
+ * @par Example:
+   @verbatim
+
+   vector<unsigned char> bytes;
+   picture.encode(bytes, true);
+
+   @endverbatim
+
+ ***********************************************************************/
+void netpbmImage::encode(vector<unsigned char>& out, bool binary) const
+{
+    vectorOutput buffer(out);
+    ostream sink(&buffer);
+
+    encode(sink, binary);
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function encodes the image into a buffer given by the caller. It
+ * returns the number of bytes the image needs. When that is more than
+ * the capacity the buffer only holds the start of the image and the
+ * caller can call again with a buffer that is large enough.
+ *
+ * @param[out] buffer - the buffer the image is written to
+ * @param[in] capacity - the size of the buffer in bytes
+ * @param[in] binary - true for P5 or P6, false for P2 or P3
+ *
+ * @returns the number of bytes of the encoded image
+ *
+ * @par Example:
+   @verbatim
+
+   vector<char> buffer(1 << 20);
+   size_t size = picture.encode(buffer.data(), buffer.size(), true);
+   if (size > buffer.size())
+   {
+       buffer.resize(size);
+       picture.encode(buffer.data(), buffer.size(), true);
+   }
+
+   @endverbatim
+
+ ***********************************************************************/
+size_t netpbmImage::encode(void* buffer, size_t capacity, bool binary) const
+{
+    memoryOutput output((char*)buffer, capacity);
+    ostream sink(&output);
+
+    encode(sink, binary);
+    return output.needed();
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * These functions return the size, the maximum pixel value and the
+ * arrays of the image.
+ *
+ * @returns the value asked for
+ *
+ * @par Example:
+   @verbatim
+
+   int pixels = picture.rows() * picture.cols();
+   pixel corner = picture.data().redGray[0][0];
+
+   @endverbatim
+
+ ***********************************************************************/
+int netpbmImage::rows() const
+{
+    return img.rows;
+}
+
+int netpbmImage::cols() const
+{
+    return img.cols;
+}
+
+int netpbmImage::maxPixel() const
+{
+    return maxValue;
+}
+
+bool netpbmImage::isGray() const
+{
+    return gray;
+}
+
+const image& netpbmImage::data() const
+{
+    return img;
+}
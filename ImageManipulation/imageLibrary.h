@@ -0,0 +1,121 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Library interface to decode, change and encode images in memory
+ ***********************************************************************/
+
+#include "netPBM.h"
+#include <streambuf>
+
+#ifndef _IMAGELIBRARY_H_
+#define  _IMAGELIBRARY_H_
+
+/************************************************************************
+ *             Structure
+ ***********************************************************************/
+ /**
+ * @brief A stream buffer reading straight from bytes owned by the caller,
+ *        the bytes are never copied
+ */
+struct memoryInput : streambuf
+{
+    /**
+    * @brief reads the size bytes at data
+    */
+    memoryInput(const char* data, size_t size)
+    {
+        char* start = const_cast<char*>(data);
+        setg(start, start, start + size);
+    }
+
+    /**
+    * @brief moves the read position, the readers seek to find the size of
+    *        the data
+    */
+    pos_type seekoff(off_type offset, ios_base::seekdir dir,
+        ios_base::openmode which = ios_base::in) override
+    {
+        off_type base = 0;
+
+        if (dir == ios_base::cur)
+        {
+            base = gptr() - eback();
+        }
+        else if (dir == ios_base::end)
+        {
+            base = egptr() - eback();
+        }
+
+        if (!(which & ios_base::in) || base + offset < 0 ||
+            base + offset > egptr() - eback())
+        {
+            return pos_type(off_type(-1));
+        }
+        setg(eback(), eback() + base + offset, egptr());
+        return pos_type(base + offset);
+    }
+
+    /**
+    * @brief moves the read position from the start of the data
+    */
+    pos_type seekpos(pos_type position,
+        ios_base::openmode which = ios_base::in) override
+    {
+        return seekoff(off_type(position), ios_base::beg, which);
+    }
+};
+
+
+/************************************************************************
+ *             Class
+ ***********************************************************************/
+ /**
+ * @brief An image that owns its arrays. It is decoded from bytes in
+ *        memory, changed with the same options as the command line and
+ *        encoded to a buffer or any output stream. Nothing is read from
+ *        or written to a file and errors are thrown, never ending the
+ *        program. A bad option throws an invalid_argument, bad image
+ *        data throws a runtime_error and running out of memory throws a
+ *        bad_alloc. A decode that throws leaves the image as it was.
+ */
+class netpbmImage
+{
+public:
+    netpbmImage();
+    netpbmImage(const netpbmImage& other);
+    netpbmImage(netpbmImage&& other) noexcept;
+    ~netpbmImage();
+    netpbmImage& operator=(netpbmImage other) noexcept;
+
+    void decode(const void* data, size_t size, string option = "");
+    void apply(string option);
+
+    void encode(ostream& sink, bool binary) const;
+    void encode(vector<unsigned char>& out, bool binary) const;
+    size_t encode(void* buffer, size_t capacity, bool binary) const;
+
+    int rows() const;
+    int cols() const;
+    int maxPixel() const;
+    bool isGray() const;
+    const image& data() const;
+
+private:
+    void release();
+
+    /**
+    * @brief the arrays and size of the image
+    */
+    image img;
+    /**
+    * @brief the maximum pixel value of the image
+    */
+    int maxValue;
+    /**
+    * @brief true when the three arrays hold the same gray values, the
+    *        image is then encoded as P5 or P2
+    */
+    bool gray;
+};
+
+#endif
@@ -0,0 +1,368 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Look up table operations - brightness, contrast, gamma, etc.
+ ***********************************************************************/
+#include "netPBM.h"
+#include <cmath>
+#include <cstring>
+#include <cctype>
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function sets every table of the look up table so that every
+ * value maps to itself.
+ *
+ * @param[out] lut - the look up table
+ *
+ * @par Example:
+   @verbatim
+
+   pixelLut lut;
+   lutIdentity(lut);
+   //lut.table[0][100] is 100
+
+   @endverbatim
+
+ ***********************************************************************/
+void lutIdentity(pixelLut& lut)
+{
+    int c, v;
+
+    for (c = 0; c < 3; c++)
+    {
+        for (v = 0; v < 256; v++)
+        {
+            lut.table[c][v] = pixel(v);
+        }
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function adds a mapping after the ones already in the look up
+ * table. Every entry of the chosen tables is passed through the new
+ * mapping, so any number of mappings still cost one look up per pixel.
+ *
+ * @param[in, out] lut - the look up table
+ * @param[in] map - the 256 entry mapping to add
+ * @param[in] channel - 0, 1 or 2 for one table, -1 for all three
+ *
+ * @par Example:
+   @verbatim
+
+   pixelLut lut;
+   pixel invert[256];
+   //fill invert with 255 - v
+
+   lutIdentity(lut);
+   lutCompose(lut, invert, -1);
+   lutCompose(lut, invert, -1);
+   //lut maps every value to itself again
+
+   @endverbatim
+
+ ***********************************************************************/
+void lutCompose(pixelLut& lut, const pixel map[256], int channel)
+{
+    int c, v;
+
+    for (c = 0; c < 3; c++)
+    {
+        if (channel >= 0 && channel != c)
+        {
+            continue;
+        }
+        for (v = 0; v < 256; v++)
+        {
+            lut.table[c][v] = map[lut.table[c][v]];
+        }
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function builds the 256 entry mapping of one tonal operation.
+ * The operations are
+ * brightness=N adds N to every value
+ * contrast=F stretches the values around 128 by F
+ * gamma=G applies a gamma of G, above 1 brightens the mid tones
+ * invert turns v into 255 - v
+ * threshold=T turns values below T to 0 and the rest to 255
+ * posterize=N keeps only N levels
+ * levels=LOW-HIGH stretches LOW..HIGH to 0..255
+ * Every result is rounded and kept between 0 and 255. A value that is
+ * not a whole number, or a value given to invert, is not valid.
+ *
+ * @param[in] name - the name of the operation
+ * @param[in] value - the text after the equal sign, can be empty
+ * @param[out] map - the 256 entry mapping
+ *
+ * @returns true - if the operation and its value are valid
+ *
+ * @par Example:
+   @verbatim
+
+   pixel map[256];
+   toneMap("brightness", "20", map);
+   //map[100] is 120 and map[250] is 255
+
+   @endverbatim
+
+ ***********************************************************************/
+bool toneMap(string name, string value, pixel map[256])
+{
+    int v, levels = 0;
+    long low = 0, high = 0;
+    double x, number;
+    char* end;
+    bool numeric;
+
+    //every operation but invert and levels takes one number
+    number = strtod(value.c_str(), &end);
+    numeric = value != "" && !isspace((unsigned char)value[0]) && *end == '\0' &&
+        std::isfinite(number);
+    if (name == "invert" && value != "")
+    {
+        return false;
+    }
+    if (name != "invert" && name != "levels" && !numeric)
+    {
+        return false;
+    }
+
+    if (name == "posterize")
+    {
+        levels = int(number);
+        if (number != levels || levels < 2 || levels > 256)
+        {
+            return false;
+        }
+    }
+
+    //levels takes two whole numbers with a dash between them
+    if (name == "levels")
+    {
+        low = strtol(value.c_str(), &end, 10);
+        if (end == value.c_str() || isspace((unsigned char)value[0]) || *end != '-')
+        {
+            return false;
+        }
+        value = end + 1;
+        high = strtol(value.c_str(), &end, 10);
+        if (value == "" || isspace((unsigned char)value[0]) || *end != '\0' || high <= low)
+        {
+            return false;
+        }
+    }
+
+    for (v = 0; v < 256; v++)
+    {
+        if (name == "brightness")
+        {
+            x = v + number;
+        }
+        else if (name == "contrast")
+        {
+            x = (v - 128.0) * number + 128.0;
+        }
+        else if (name == "gamma")
+        {
+            if (number <= 0.0)
+            {
+                return false;
+            }
+            x = 255.0 * pow(v / 255.0, 1.0 / number);
+        }
+        else if (name == "invert")
+        {
+            x = 255.0 - v;
+        }
+        else if (name == "threshold")
+        {
+            x = v < number ? 0.0 : 255.0;
+        }
+        else if (name == "posterize")
+        {
+            //snap down to one of the evenly spaced levels
+            x = floor(v * levels / 256.0) * 255.0 / (levels - 1);
+        }
+        else if (name == "levels")
+        {
+            x = (v - low) * 255.0 / double(high - low);
+        }
+        else
+        {
+            return false;
+        }
+
+        //round and keep between 0 and 255
+        x = floor(x + 0.5);
+        map[v] = pixel(x < 0.0 ? 0 : (x > 255.0 ? 255 : int(x)));
+    }
+
+    return true;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function reads a tone option and builds one look up table out of
+ * all of the operations in it. The option looks like
+ * --tone=gamma=1.2,contrast=1.1,r.brightness=10,invert
+ * The operations are done left to right. An operation starting with r.,
+ * g. or b. only changes that channel.
+ *
+ * @param[in] option - the full option string
+ * @param[out] lut - the look up table of the whole chain
+ *
+ * @returns true - if every operation could be read
+ *
+ * @par Example:
+   @verbatim
+
+   pixelLut lut;
+   parseTone("--tone=invert,brightness=10", lut);
+   //lut.table[0][0] is 255 and lut.table[0][255] is 10
+
+   @endverbatim
+
+ ***********************************************************************/
+bool parseTone(string option, pixelLut& lut)
+{
+    size_t start, end, equal;
+    int channel;
+    string text = option.substr(option.find('=') + 1);
+    string op, name, value;
+    pixel map[256];
+
+    lutIdentity(lut);
+
+    for (start = 0; start <= text.size(); start = end + 1)
+    {
+        //one operation up to the next comma
+        end = text.find(',', start);
+        if (end == string::npos)
+        {
+            end = text.size();
+        }
+        op = text.substr(start, end - start);
+
+        //channel prefix
+        channel = -1;
+        if (op.size() > 2 && op[1] == '.')
+        {
+            if (string("rgb").find(op[0]) == string::npos)
+            {
+                return false;
+            }
+            channel = int(string("rgb").find(op[0]));
+            op = op.substr(2);
+        }
+
+        //split the name from the value
+        equal = op.find('=');
+        name = op.substr(0, equal);
+        value = equal == string::npos ? "" : op.substr(equal + 1);
+
+        if (!toneMap(name, value, map))
+        {
+            return false;
+        }
+        lutCompose(lut, map, channel);
+    }
+
+    return true;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function passes every pixel of the image through the look up
+ * table. The rows are split across threads and each array is done with
+ * its own table, so it is one load and one store per value no matter how
+ * many operations were composed into the table. An array whose table
+ * changes nothing is skipped, so it is neither read nor unshared.
+ *
+ * @param[in, out] img - the structure where the data of the image is stored
+ * @param[in] lut - the look up table
+ *
+ * @par Example:
+   @verbatim
+
+   image img;
+   pixelLut lut;
+   parseTone("--tone=gamma=2.2", lut);
+
+   applyLut(img, lut);
+   //the mid tones of img are brighter
+
+   @endverbatim
+
+ ***********************************************************************/
+void applyLut(image& img, const pixelLut& lut)
+{
+    pixel** planes[3];
+    pixelLut identity;
+    bool changes[3];
+    int k;
+
+    //only the arrays that change are copied out of a fan out
+    lutIdentity(identity);
+    for (k = 0; k < 3; k++)
+    {
+        changes[k] = memcmp(lut.table[k], identity.table[k], sizeof(identity.table[k])) != 0;
+    }
+    if (changes[0])
+    {
+        unshareArray(img.redGray, img.rows, img.cols);
+    }
+    if (changes[1])
+    {
+        unshareArray(img.green, img.rows, img.cols);
+    }
+    if (changes[2])
+    {
+        unshareArray(img.blue, img.rows, img.cols);
+    }
+    planes[0] = img.redGray;
+    planes[1] = img.green;
+    planes[2] = img.blue;
+
+    parallelFor(img.rows, [&](int first, int last)
+    {
+        int c, i, j;
+        pixel* row;
+        const pixel* table;
+
+        for (c = 0; c < 3; c++)
+        {
+            if (!changes[c])
+            {
+                continue;
+            }
+            table = lut.table[c];
+            for (i = first; i < last; i++)
+            {
+                row = planes[c][i];
+                for (j = 0; j < img.cols; j++)
+                {
+                    row[j] = table[row[j]];
+                }
+            }
+        }
+    });
+}
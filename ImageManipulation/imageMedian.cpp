@@ -0,0 +1,322 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Median filter at the same cost for any radius
+ ***********************************************************************/
+#include "netPBM.h"
+#include <cstdint>
+#include <cstring>
+
+/************************************************************************
+ *             Constants
+ ***********************************************************************/
+ /*!
+  * @brief the largest radius, the counts of a histogram fit in 16 bits
+  */
+const int MEDIAN_MAX_RADIUS = 127;
+
+/*!
+ * @brief values in one coarse bin, the top 4 bits of a value pick the
+ *        coarse bin and the bottom 4 bits the fine bin inside of it
+ */
+const int MEDIAN_FINE = 16;
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function adds or takes away one histogram of MEDIAN_FINE counts
+ * from another. The loop has a fixed length so the compiler does it
+ * with vector instructions.
+ *
+ * @param[in, out] to - the histogram that changes
+ * @param[in] from - the histogram added or taken away
+ * @param[in] add - true to add, false to take away
+ *
+ * @par Example:
+   @verbatim
+
+   addCounts(kernel, column, true);
+
+   @endverbatim
+
+ ***********************************************************************/
+static inline void addCounts(uint16_t* to, const uint16_t* from, bool add)
+{
+    uint16_t counts[MEDIAN_FINE];
+    int k;
+
+    memcpy(counts, from, sizeof(counts));
+    for (k = 0; k < MEDIAN_FINE; k++)
+    {
+        to[k] = uint16_t(add ? to[k] + counts[k] : to[k] - counts[k]);
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function runs the median filter on one array with the method of
+ * Perreault and Hebert. Every column has a histogram of the 2 radius + 1
+ * pixels above and below the row, and moving down a row takes one pixel
+ * out of each column histogram and puts one in. The histogram of the
+ * square is the sum of 2 radius + 1 column histograms, and moving right
+ * one pixel adds one column histogram and takes one away, so the cost
+ * per pixel does not depend on the radius. Every histogram has 16 coarse
+ * bins for the top 4 bits of a value and 256 fine bins. Only the coarse
+ * bins of the square are kept up to date, the median is found in them
+ * first and only the 16 fine bins under the coarse bin holding it are
+ * brought up to date, from the column where they were last used. Every
+ * thread takes a band of rows with its own histograms.
+ *
+ * @param[in] from - the input array
+ * @param[out] to - the output array, not the same as from
+ * @param[in] rows - the number of rows
+ * @param[in] cols - the number of columns
+ * @param[in] radius - the radius of the square
+ * @param[in] border - how positions outside of the array are handled
+ *
+ * @par Example:
+   @verbatim
+
+   medianPlane(img.redGray, spare, img.rows, img.cols, 15, BORDER_CLAMP);
+
+   @endverbatim
+
+ ***********************************************************************/
+static void medianPlane(pixel** from, pixel** to, int rows, int cols, int radius,
+    borderMode border)
+{
+    const int width = cols + 2 * radius;
+    const int side = 2 * radius + 1;
+    const int half = side * side / 2;
+
+    parallelFor(rows, [&](int first, int last)
+    {
+        int i, j, p, c, v, sum;
+        vector<uint16_t> fine(size_t(width) * 256), coarse(size_t(width) * MEDIAN_FINE);
+        vector<pixel> padded(width);
+        vector<int> sources(width);
+        uint16_t kernelCoarse[MEDIAN_FINE], kernelFine[256];
+        int updated[MEDIAN_FINE];
+        uint16_t* bins;
+        pixel* out;
+
+        //the column of the input under each padded column
+        for (p = 0; p < width; p++)
+        {
+            sources[p] = borderIndex(p - radius, cols, border);
+        }
+
+        //put one row into the column histograms or take it out
+        auto addRow = [&](int y, int delta)
+        {
+            y = borderIndex(y, rows, border);
+            for (p = 0; p < width; p++)
+            {
+                padded[p] = y < 0 || sources[p] < 0 ? 0 : from[y][sources[p]];
+            }
+            for (p = 0; p < width; p++)
+            {
+                int value = padded[p];
+                fine[size_t(p) * 256 + value] = uint16_t(fine[size_t(p) * 256 + value] + delta);
+                coarse[size_t(p) * MEDIAN_FINE + (value >> 4)] =
+                    uint16_t(coarse[size_t(p) * MEDIAN_FINE + (value >> 4)] + delta);
+            }
+        };
+
+        for (i = first; i < last; i++)
+        {
+            //the column histograms hold the rows i - radius to i + radius
+            if (i == first)
+            {
+                for (j = i - radius; j <= i + radius; j++)
+                {
+                    addRow(j, 1);
+                }
+            }
+            else
+            {
+                addRow(i - radius - 1, -1);
+                addRow(i + radius, 1);
+            }
+
+            //the coarse bins of the first square, the fine bins wait
+            memset(kernelCoarse, 0, sizeof(kernelCoarse));
+            for (p = 0; p < side; p++)
+            {
+                addCounts(kernelCoarse, &coarse[size_t(p) * MEDIAN_FINE], true);
+            }
+            for (c = 0; c < MEDIAN_FINE; c++)
+            {
+                updated[c] = -side;
+            }
+
+            out = to[i];
+            for (j = 0; j < cols; j++)
+            {
+                //the square holds the padded columns j to j + 2 radius
+                if (j > 0)
+                {
+                    addCounts(kernelCoarse, &coarse[size_t(j + side - 1) * MEDIAN_FINE], true);
+                    addCounts(kernelCoarse, &coarse[size_t(j - 1) * MEDIAN_FINE], false);
+                }
+
+                //the coarse bin holding the median
+                sum = 0;
+                c = 0;
+                while (sum + kernelCoarse[c] <= half)
+                {
+                    sum += kernelCoarse[c];
+                    c++;
+                }
+
+                //bring its fine bins up to date, from scratch if that is less work
+                bins = &kernelFine[c * MEDIAN_FINE];
+                if (j - updated[c] >= side)
+                {
+                    memset(bins, 0, MEDIAN_FINE * sizeof(uint16_t));
+                    for (p = j; p < j + side; p++)
+                    {
+                        addCounts(bins, &fine[size_t(p) * 256 + c * MEDIAN_FINE], true);
+                    }
+                }
+                else
+                {
+                    for (p = updated[c] + 1; p <= j; p++)
+                    {
+                        addCounts(bins, &fine[size_t(p + side - 1) * 256 + c * MEDIAN_FINE], true);
+                        addCounts(bins, &fine[size_t(p - 1) * 256 + c * MEDIAN_FINE], false);
+                    }
+                }
+                updated[c] = j;
+
+                //the median inside of the coarse bin
+                v = 0;
+                while (sum + bins[v] <= half)
+                {
+                    sum += bins[v];
+                    v++;
+                }
+                out[j] = pixel(c * MEDIAN_FINE + v);
+            }
+        }
+    });
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function gives every pixel the median of the square of
+ * 2 radius + 1 X 2 radius + 1 pixels around it, which takes out specks
+ * and keeps edges sharp. Each array is done on its own. A gray image,
+ * where the three arrays are the same or are one shared array, is
+ * filtered once, so it costs a third of a color image.
+ *
+ * @param[in, out] img - the structure where the data of the image is stored
+ * @param[in] radius - the radius of the square, 1 to MEDIAN_MAX_RADIUS
+ * @param[in] border - how positions outside of the image are handled
+ *
+ * @par Example:
+   @verbatim
+
+   medianFilter(img, 15, BORDER_CLAMP);
+   //the specks of the scan are gone
+
+   @endverbatim
+
+ ***********************************************************************/
+void medianFilter(image& img, int radius, borderMode border)
+{
+    pixel** planes[3] = { img.redGray, img.green, img.blue };
+    pixel** spare = createArrays(img.rows, img.cols);
+    bool gray = true;
+    int i, k;
+
+    //three arrays sharing one, like after --edges, stay shared
+    if (img.green == img.redGray && img.blue == img.redGray)
+    {
+        medianPlane(img.redGray, spare, img.rows, img.cols, radius, border);
+        clearArray(img.redGray, img.rows);
+        clearArray(img.green, img.rows);
+        clearArray(img.blue, img.rows);
+        shareArray(spare, 2);
+        img.redGray = img.green = img.blue = spare;
+        return;
+    }
+
+    for (i = 0; i < img.rows && gray; i++)
+    {
+        gray = memcmp(img.redGray[i], img.green[i], size_t(img.cols)) == 0 &&
+            memcmp(img.redGray[i], img.blue[i], size_t(img.cols)) == 0;
+    }
+
+    for (k = 0; k < 3; k++)
+    {
+        //a gray image shares the filtered red array
+        if (k > 0 && gray)
+        {
+            clearArray(planes[k], img.rows);
+            shareArray(planes[0], 1);
+            planes[k] = planes[0];
+            continue;
+        }
+
+        //the old array can be shared, so it is given up and not reused
+        medianPlane(planes[k], spare, img.rows, img.cols, radius, border);
+        clearArray(planes[k], img.rows);
+        planes[k] = spare;
+        spare = k < 2 && !gray ? createArrays(img.rows, img.cols) : nullptr;
+    }
+
+    img.redGray = planes[0];
+    img.green = planes[1];
+    img.blue = planes[2];
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function reads a median option. The option looks like
+ * --median=RADIUS or --median=RADIUS:BORDER, the border defaults to
+ * clamp.
+ *
+ * @param[in] option - the full option string
+ * @param[out] radius - the radius
+ * @param[out] border - the border mode
+ *
+ * @returns true - if the option is valid
+ *
+ * @par Example:
+   @verbatim
+
+   int radius;
+   borderMode border;
+
+   bool valid = parseMedian("--median=15:mirror", radius, border);
+
+   @endverbatim
+
+ ***********************************************************************/
+bool parseMedian(string option, int& radius, borderMode& border)
+{
+    string value = option.substr(option.find('=') + 1);
+    size_t colon = value.find(':');
+    string number = value.substr(0, colon);
+
+    if (!parseBorder(colon == string::npos ? "" : value.substr(colon + 1), border) ||
+        number == "" || number.find_first_not_of("0123456789") != string::npos)
+    {
+        return false;
+    }
+
+    radius = atoi(number.c_str());
+    return radius >= 1 && radius <= MEDIAN_MAX_RADIUS;
+}
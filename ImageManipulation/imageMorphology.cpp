@@ -0,0 +1,479 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Erode, dilate, open and close with a rectangle, at the same
+ *          cost for any size of the rectangle
+ ***********************************************************************/
+#include "netPBM.h"
+#include <cstring>
+
+/************************************************************************
+ *             Constants
+ ***********************************************************************/
+ /*!
+  * @brief values of two rows compared at a time by pickRows
+  */
+const int MORPH_CHUNK = 32;
+
+/*!
+ * @brief fewest columns in a band of the column pass, the image is only
+ *        cut into bands when there are fewer blocks than threads
+ */
+const int MORPH_BAND_COLS = 256;
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function gives the smaller of two values for an erosion or the
+ * larger for a dilation. erode is a template parameter so the loops that
+ * call it have no test inside.
+ *
+ * @param[in] a - the first value
+ * @param[in] b - the second value
+ *
+ * @returns the smaller or the larger value
+ *
+ * @par Example:
+   @verbatim
+
+   pixel value = pick<true>(10, 20);
+   //value is 10
+
+   @endverbatim
+
+ ***********************************************************************/
+template <bool erode>
+static inline pixel pick(pixel a, pixel b)
+{
+    return erode ? (a < b ? a : b) : (a > b ? a : b);
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function picks value by value between two rows. The rows are
+ * copied through small local arrays MORPH_CHUNK values at a time, the
+ * compiler knows those cannot overlap and does each chunk with vector
+ * instructions. The output can be one of the inputs.
+ *
+ * @param[in] a - the first row
+ * @param[in] b - the second row
+ * @param[out] out - the result row
+ * @param[in] cols - the number of values in the rows
+ *
+ * @par Example:
+   @verbatim
+
+   pickRows<true>(above, below, out, img.cols);
+   //out holds the smaller value of each column
+
+   @endverbatim
+
+ ***********************************************************************/
+template <bool erode>
+static void pickRows(const pixel* a, const pixel* b, pixel* out, int cols)
+{
+    pixel x[MORPH_CHUNK], y[MORPH_CHUNK];
+    int j, k;
+
+    for (j = 0; j + MORPH_CHUNK <= cols; j += MORPH_CHUNK)
+    {
+        memcpy(x, a + j, MORPH_CHUNK);
+        memcpy(y, b + j, MORPH_CHUNK);
+        for (k = 0; k < MORPH_CHUNK; k++)
+        {
+            x[k] = pick<erode>(x[k], y[k]);
+        }
+        memcpy(out + j, x, MORPH_CHUNK);
+    }
+    for (; j < cols; j++)
+    {
+        out[j] = pick<erode>(a[j], b[j]);
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function does the van Herk/Gil-Werman pass along up to
+ * MORPH_CHUNK rows at the same time. The rows are padded with left
+ * values on the left and the rest on the right, a value that never wins,
+ * then cut into blocks of size columns. prefix holds the running minimum
+ * (or maximum) from the start of each block and suffix the running one to
+ * the end of each block. Every window of size values starts in one block
+ * and ends in the next, so its result is one suffix value and one prefix
+ * value, 3 comparisons per pixel for any size. The rows are stored turned
+ * on their side, one column of all of the rows after the other, so every
+ * step is a pickRows of MORPH_CHUNK values done with vector instructions.
+ * The rows are replaced by the result.
+ *
+ * @param[in, out] rows - the first of the rows
+ * @param[in] count - the number of rows, at most MORPH_CHUNK
+ * @param[in] cols - the number of values in a row
+ * @param[in] size - the width of the window
+ * @param[in] left - how many values of the window are left of the pixel
+ * @param[in, out] prefix - a buffer, resized as needed
+ * @param[in, out] suffix - a buffer, resized as needed
+ *
+ * @par Example:
+   @verbatim
+
+   vector<pixel> prefix, suffix;
+   morphRows<true>(img.redGray, MORPH_CHUNK, img.cols, 15, 7, prefix, suffix);
+   //every value of the first rows is the minimum of the 15 around it
+
+   @endverbatim
+
+ ***********************************************************************/
+template <bool erode>
+static void morphRows(pixel** rows, int count, int cols, int size, int left,
+    vector<pixel>& prefix, vector<pixel>& suffix)
+{
+    int i, j, k, start;
+    int length = (cols + size - 1 + size - 1) / size * size;
+    const pixel neutral = erode ? 255 : 0;
+    const pixel* row;
+    pixel* column;
+
+    //turn the rows on their side with the padding around them
+    prefix.resize(size_t(length) * MORPH_CHUNK);
+    suffix.resize(size_t(length) * MORPH_CHUNK);
+    fill(prefix.begin(), prefix.begin() + size_t(left) * MORPH_CHUNK, neutral);
+    fill(prefix.begin() + size_t(left + cols) * MORPH_CHUNK, prefix.end(), neutral);
+    for (i = 0; i < count; i++)
+    {
+        row = rows[i];
+        column = &prefix[size_t(left) * MORPH_CHUNK + i];
+        for (j = 0; j < cols; j++)
+        {
+            column[size_t(j) * MORPH_CHUNK] = row[j];
+        }
+    }
+    copy(prefix.begin(), prefix.end(), suffix.begin());
+
+    for (start = 0; start < length; start += size)
+    {
+        for (k = start + 1; k < start + size; k++)
+        {
+            pickRows<erode>(&prefix[size_t(k) * MORPH_CHUNK],
+                &prefix[size_t(k - 1) * MORPH_CHUNK], &prefix[size_t(k) * MORPH_CHUNK],
+                MORPH_CHUNK);
+        }
+        for (k = start + size - 2; k >= start; k--)
+        {
+            pickRows<erode>(&suffix[size_t(k) * MORPH_CHUNK],
+                &suffix[size_t(k + 1) * MORPH_CHUNK], &suffix[size_t(k) * MORPH_CHUNK],
+                MORPH_CHUNK);
+        }
+    }
+
+    for (j = 0; j < cols; j++)
+    {
+        pickRows<erode>(&suffix[size_t(j) * MORPH_CHUNK],
+            &prefix[size_t(j + size - 1) * MORPH_CHUNK], &suffix[size_t(j) * MORPH_CHUNK],
+            MORPH_CHUNK);
+    }
+
+    //turn the result back into the rows
+    for (i = 0; i < count; i++)
+    {
+        column = &suffix[i];
+        for (j = 0; j < cols; j++)
+        {
+            rows[i][j] = column[size_t(j) * MORPH_CHUNK];
+        }
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function does the van Herk/Gil-Werman pass down the columns. It
+ * works on whole rows, so every step is a pickRows of two rows done with
+ * vector instructions. The padded rows are cut into blocks of size rows
+ * and every task takes one block. It keeps the suffix rows of the block
+ * and the prefix rows of the next block, which is everything the output
+ * rows starting in the block need, so each padded row is picked about
+ * three times for any size. When there are fewer blocks than threads the
+ * columns are also cut into bands so every thread still has work.
+ *
+ * @param[in] from - the input array
+ * @param[out] to - the output array, not the same as from
+ * @param[in] rows - the number of rows
+ * @param[in] cols - the number of columns
+ * @param[in] size - the height of the window
+ * @param[in] top - how many rows of the window are above the pixel
+ *
+ * @par Example:
+   @verbatim
+
+   morphColumns<true>(img.redGray, spare, img.rows, img.cols, 15, 7);
+
+   @endverbatim
+
+ ***********************************************************************/
+template <bool erode>
+static void morphColumns(pixel** from, pixel** to, int rows, int cols, int size, int top)
+{
+    int blocks = (rows + size - 1) / size;
+    int bands = max(1, min((threadCount() + blocks - 1) / blocks,
+        cols / MORPH_BAND_COLS));
+    int width = (cols + bands - 1) / bands;
+
+    parallelFor(blocks * bands, [&](int first, int last)
+    {
+        int i, k, task, start, left, count;
+        const pixel neutral = erode ? 255 : 0;
+        vector<pixel> suffix(size_t(size) * width), prefix(size_t(size) * width);
+        vector<pixel> outside(size_t(width), neutral);
+        pixel* s;
+        pixel* p;
+        const pixel* next;
+        const pixel* row;
+
+        //padded row k is input row k - top, or a row that never wins
+        auto padded = [&](int k) -> const pixel*
+        {
+            return k - top >= 0 && k - top < rows ? from[k - top] + left : outside.data();
+        };
+
+        for (task = first; task < last; task++)
+        {
+            start = task / bands * size;
+            left = task % bands * width;
+            count = min(width, cols - left);
+
+            //suffix rows of this block, from its last row up
+            row = padded(start + size - 1);
+            copy(row, row + count, &suffix[size_t(size - 1) * width]);
+            for (k = size - 2; k >= 0; k--)
+            {
+                s = &suffix[size_t(k) * width];
+                next = s + width;
+                pickRows<erode>(padded(start + k), next, s, count);
+            }
+
+            //prefix rows of the next block, from its first row down
+            row = padded(start + size);
+            copy(row, row + count, &prefix[0]);
+            for (k = 1; k < size - 1; k++)
+            {
+                p = &prefix[size_t(k) * width];
+                next = p - width;
+                pickRows<erode>(padded(start + size + k), next, p, count);
+            }
+
+            //a window starting on the block is the whole block, any other
+            //ends in the next block
+            for (i = start; i < min(start + size, rows); i++)
+            {
+                s = &suffix[size_t(i - start) * width];
+                if (i == start)
+                {
+                    copy(s, s + count, to[i] + left);
+                    continue;
+                }
+                pickRows<erode>(s, &prefix[size_t(i - start - 1) * width], to[i] + left,
+                    count);
+            }
+        }
+    });
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function erodes or dilates the three arrays of the image with a
+ * width X height rectangle centered on each pixel. Erode gives every
+ * pixel the minimum of the rectangle and dilate the maximum, pixels
+ * outside of the image are left out. The rectangle is done as a pass
+ * along the rows and a pass down the columns, both with the van
+ * Herk/Gil-Werman method, so the cost per pixel is the same for any
+ * size. The row pass works in place and the column pass writes into one
+ * spare array that is swapped with each array in turn. For an even size
+ * the pixel is not in the middle of the rectangle, mirrored puts it on
+ * the other side of the middle. The second half of open and close uses
+ * the mirrored rectangle so the two halves undo each other's shift.
+ *
+ * @param[in, out] img - the structure where the data of the image is stored
+ * @param[in] width - the width of the rectangle
+ * @param[in] height - the height of the rectangle
+ * @param[in] mirrored - true for the rectangle turned around the pixel
+ * @param[in, out] spare - an array of the size of the image, it is
+ *                         swapped with the arrays of the image
+ *
+ * @par Example:
+   @verbatim
+
+   pixel** spare = createArrays(img.rows, img.cols);
+   morphPasses<true>(img, 5, 5, false, spare);
+   clearArray(spare, img.rows);
+
+   @endverbatim
+
+ ***********************************************************************/
+template <bool erode>
+static void morphPasses(image& img, int width, int height, bool mirrored, pixel**& spare)
+{
+    pixel** planes[3] = { img.redGray, img.green, img.blue };
+    int k;
+    int left = mirrored ? width - 1 - width / 2 : width / 2;
+    int top = mirrored ? height - 1 - height / 2 : height / 2;
+
+    for (k = 0; k < 3; k++)
+    {
+        if (width > 1)
+        {
+            parallelFor((img.rows + MORPH_CHUNK - 1) / MORPH_CHUNK, [&](int first, int last)
+            {
+                vector<pixel> prefix, suffix;
+                for (int band = first; band < last; band++)
+                {
+                    morphRows<erode>(planes[k] + band * MORPH_CHUNK,
+                        min(MORPH_CHUNK, img.rows - band * MORPH_CHUNK), img.cols, width,
+                        left, prefix, suffix);
+                }
+            });
+        }
+        if (height > 1)
+        {
+            morphColumns<erode>(planes[k], spare, img.rows, img.cols, height, top);
+            swap(planes[k], spare);
+        }
+    }
+
+    img.redGray = planes[0];
+    img.green = planes[1];
+    img.blue = planes[2];
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function runs the passes of a morphology operation with a width
+ * X height rectangle. erode and dilate are one set of passes, open is an
+ * erode then a dilate with the mirrored rectangle and close is a dilate
+ * then an erode with the mirrored rectangle. The two halves of open and
+ * close run one after the other on the same spare array, so no copy of
+ * the image is made between them.
+ *
+ * @param[in, out] img - the structure where the data of the image is stored
+ * @param[in] operation - erode, dilate, open or close
+ * @param[in] width - the width of the rectangle
+ * @param[in] height - the height of the rectangle
+ *
+ * @par Example:
+   @verbatim
+
+   morphImage(img, "open", 9, 3);
+   //specks smaller than 9 X 3 are gone from the image
+
+   @endverbatim
+
+ ***********************************************************************/
+void morphImage(image& img, string operation, int width, int height)
+{
+    pixel** spare = nullptr;
+
+    //the row pass works in place and the arrays are reused as the spare
+    unshareImage(img);
+    if (height > 1)
+    {
+        spare = createArrays(img.rows, img.cols);
+    }
+
+    if (operation == "erode" || operation == "open")
+    {
+        morphPasses<true>(img, width, height, false, spare);
+    }
+    if (operation == "dilate" || operation == "close")
+    {
+        morphPasses<false>(img, width, height, false, spare);
+    }
+    if (operation == "open")
+    {
+        morphPasses<false>(img, width, height, true, spare);
+    }
+    if (operation == "close")
+    {
+        morphPasses<true>(img, width, height, true, spare);
+    }
+
+    clearArray(spare, img.rows);
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function reads a morphology option. The option looks like
+ * --erode=WxH, --dilate=WxH, --open=WxH or --close=WxH, or with one
+ * number N for an N X N square.
+ *
+ * @param[in] option - the full option string
+ * @param[out] operation - erode, dilate, open or close
+ * @param[out] width - the width of the rectangle
+ * @param[out] height - the height of the rectangle
+ *
+ * @returns true - if the option is valid
+ *
+ * @par Example:
+   @verbatim
+
+   string operation;
+   int width, height;
+
+   bool valid = parseMorph("--close=15x3", operation, width, height);
+   //operation is close, width is 15 and height is 3
+
+   @endverbatim
+
+ ***********************************************************************/
+bool parseMorph(string option, string& operation, int& width, int& height)
+{
+    size_t equals = option.find('='), x;
+    string size;
+
+    if (option.compare(0, 2, "--") != 0 || equals == string::npos)
+    {
+        return false;
+    }
+    operation = option.substr(2, equals - 2);
+    if (operation != "erode" && operation != "dilate" && operation != "open" &&
+        operation != "close")
+    {
+        return false;
+    }
+
+    //one number is a square
+    size = option.substr(equals + 1);
+    x = size.find('x');
+    if (x == string::npos)
+    {
+        width = height = atoi(size.c_str());
+        return size.find_first_not_of("0123456789") == string::npos && width > 0;
+    }
+
+    if (x == 0 || x + 1 >= size.size() || size.find('x', x + 1) != string::npos ||
+        size.find_first_not_of("0123456789x") != string::npos)
+    {
+        return false;
+    }
+    width = atoi(size.substr(0, x).c_str());
+    height = atoi(size.substr(x + 1).c_str());
+
+    return width > 0 && height > 0;
+}
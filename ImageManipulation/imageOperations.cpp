@@ -4,6 +4,76 @@
  * @brief  Image operations and supporting functions
  ***********************************************************************/
 #include "netPBM.h"
+#include "pixelOps.h"
+#include <algorithm>
+
+/************************************************************************
+ *             Constants
+ ***********************************************************************/
+ /*!
+  * @brief output rows turned together by rotateInto
+  */
+const int ROTATE_BLOCK = 32;
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function writes the image turned a quarter turn into the arrays of
+ * out, which must hold img.cols X img.rows pixels. The output rows are
+ * done in blocks of ROTATE_BLOCK rows split across threads. Inside a
+ * block each source row is read once from left to right, so the reads
+ * stay in the cache and only ROTATE_BLOCK output rows are written at a
+ * time. Nothing is allocated, so a caller can turn frames into arrays it
+ * keeps.
+ *
+ * @param[in] img - the image to turn
+ * @param[in, out] out - the arrays to write, out.rows and out.cols are set
+ * @param[in] clockwise - true to turn clockwise, false for counter clockwise
+ *
+ * @par Example:
+   @verbatim
+
+   image turned;
+   //turned has img.cols X img.rows arrays
+   rotateInto(img, turned, true);
+
+   @endverbatim
+
+ ***********************************************************************/
+void rotateInto(const image& img, image& out, bool clockwise)
+{
+    int blocks = (img.cols + ROTATE_BLOCK - 1) / ROTATE_BLOCK;
+
+    out.rows = img.cols;
+    out.cols = img.rows;
+
+    parallelFor(blocks, [&](int first, int last)
+    {
+        int b, r, k, top, bottom, source, column;
+
+        for (b = first; b < last; b++)
+        {
+            top = b * ROTATE_BLOCK;
+            bottom = min(top + ROTATE_BLOCK, out.rows);
+
+            //output column k comes from one source row
+            for (k = 0; k < out.cols; k++)
+            {
+                source = clockwise ? img.rows - 1 - k : k;
+                for (r = top; r < bottom; r++)
+                {
+                    column = clockwise ? r : img.cols - 1 - r;
+                    out.redGray[r][k] = img.redGray[source][column];
+                    out.green[r][k] = img.green[source][column];
+                    out.blue[r][k] = img.blue[source][column];
+                }
+            }
+        }
+    });
+}
+
 
 /** *********************************************************************
  * @author Niven Fernandes
@@ -15,14 +85,9 @@
 * Each row will be coppied to a column in the new array. The top rows will
 * will be in the last column. The second to the second last column and so on.
 * It will rotate the 2D dynamically allocated array in the clockwise direction
-* It creates temporary arrays for the three 2D arrays and and assigns the
-* temporary array in such a way that the temporary arrays
-* are rotated clockwise.
- * The function will call the clearArray function to clear the original
- * array. Later it will call the create array to create three arrays
- * with the new dimensions and finally call the copyArray function to copy
- * the temporary array in the old array having the new dimensions.
- * it will clear the temporary array before exiting the function
+* It creates three arrays with the new dimensions and rotateInto fills
+* them. The original arrays are cleared and the new arrays take their
+* place, so the pixels are only moved once.
  *
  * @param[in, out] img - the structure when the data of the image is stored
  *
@@ -44,61 +109,30 @@
    @endverbatim
 
  ***********************************************************************/
-    void rotateImageCW(image & img)
-{
-    int i, j;
-    //declare the temporary 2D array pointers
-    pixel** tempRedGray;
-    pixel** tempGreen;
-    pixel** tempBlue;
-
-    //set teemp rows and columns to the new dimentions
-    int tempRows = img.cols;
-    int tempCols = img.rows;
 
-    //create the three new temporary arrays with the new dimentions
-    tempRedGray = createArrays(tempRows, tempCols);
-    tempGreen = createArrays(tempRows, tempCols);
-    tempBlue = createArrays(tempRows, tempCols);
+void rotateImageCW(image & img)
+{
+    image turned{};
 
+    //the new arrays have the dimensions swapped
+    turned.rows = img.cols;
+    turned.cols = img.rows;
+    turned.redGray = createArrays(turned.rows, turned.cols);
+    turned.green = createArrays(turned.rows, turned.cols);
+    turned.blue = createArrays(turned.rows, turned.cols);
 
-    //go through each row of the 2D array
-    for (i = 0; i < img.rows; i++)
-    {
-        for (j = 0; j < img.cols; j++)
-        {
-            //assign the values from the original array to the temporary such that
-            // the three 2D arrays are rotated clockise
-            tempRedGray[j][img.rows - i - 1] = img.redGray[i][j];
-            tempGreen[j][img.rows - i - 1] = img.green[i][j];
-            tempBlue[j][img.rows - i - 1] = img.blue[i][j];
-        }
-    }
+    rotateInto(img, turned, true);
 
-    //delete all three original arrays
+    //delete all three original arrays and keep the turned ones
     clearArray(img.redGray, img.rows);
     clearArray(img.green, img.rows);
     clearArray(img.blue, img.rows);
+    img.redGray = turned.redGray;
+    img.green = turned.green;
+    img.blue = turned.blue;
 
     //swap the values of img.rows and img.cols
     swap(img.cols, img.rows);
-
-    //create the new arrays with the new dimensions and store it in the 
-    //img.redGray etc.
-    img.redGray = createArrays(img.rows, img.cols);
-    img.green = createArrays(img.rows, img.cols);
-    img.blue = createArrays(img.rows, img.cols);
-
-    //copy the contents of the temp arrays to the new arrays
-    copyArray(img.redGray, tempRedGray, img);
-    copyArray(img.green, tempGreen, img);
-    copyArray(img.blue, tempBlue, img);
-
-    //delete the temp arrays
-    clearArray(tempRedGray, tempRows);
-    clearArray(tempGreen, tempRows);
-    clearArray(tempBlue, tempRows);
-
 }
 
 
@@ -154,15 +188,9 @@ void copyArray(pixel**& array, pixel** array1, image img)
  * have a dimensino of 5 X 10.
  * Each row will be coppied to a column in the new array. The top rows will
  * will be in the first column. The second to the second column.
- *  It creates temporary arrays for the three 2D arrays and and assigns the
- *  temporary array in such a way that the temporary arrays
- * are rotated counter clockwise. If the dimensions of the
- * original array is 10 X 5 the new array wil have a dimensino of 5 X 10.
- * The function will call the clearArray function to clear the original
- * array. Later it will call the create array to create three arrays
- * with the new dimensions and finally call the copyArray function to copy
- * the temporary array in the old array having the new dimensions.
- * it will clear the temporary array before exiting the function
+ * It creates three arrays with the new dimensions and rotateInto fills
+ * them counter clockwise. The original arrays are cleared and the new
+ * arrays take their place, so the pixels are only moved once.
  *
  * @param[in, out] img - the structure where the data of the image is stored
  *
@@ -187,61 +215,27 @@ void copyArray(pixel**& array, pixel** array1, image img)
  ***********************************************************************/
 void rotateImageCCW(image& img)
 {
-    int i, j;
-
-    //declare the temporary 2D array pointers
-    pixel** tempRedGray;
-    pixel** tempGreen;
-    pixel** tempBlue;
+    image turned{};
 
-    //set teemp rows and columns to the new dimentions
-    int tempRows = img.cols;
-    int tempCols = img.rows;
+    //the new arrays have the dimensions swapped
+    turned.rows = img.cols;
+    turned.cols = img.rows;
+    turned.redGray = createArrays(turned.rows, turned.cols);
+    turned.green = createArrays(turned.rows, turned.cols);
+    turned.blue = createArrays(turned.rows, turned.cols);
 
-    //create the three new temporary arrays with the new dimentions
-    tempRedGray = createArrays(tempRows, tempCols);
-    tempGreen = createArrays(tempRows, tempCols);
-    tempBlue = createArrays(tempRows, tempCols);
-
-    //go through each row of the 2D array
-    for (i = 0; i < img.rows; i++)
-    {
-        //go through each colum of the 2D array
-        for (j = 0; j < img.cols; j++)
-        {
-            //assign the values from the original array to the temporary such that
-            // the three 2D arrays are rotated counter clockise
-            tempRedGray[img.cols - 1 - j][i] = img.redGray[i][j];
-            tempGreen[img.cols - 1 - j][i] = img.green[i][j];
-            tempBlue[img.cols - 1 - j][i] = img.blue[i][j];
-        }
-
-    }
+    rotateInto(img, turned, false);
 
-    //delete all three original arrays
+    //delete all three original arrays and keep the turned ones
     clearArray(img.redGray, img.rows);
     clearArray(img.green, img.rows);
     clearArray(img.blue, img.rows);
+    img.redGray = turned.redGray;
+    img.green = turned.green;
+    img.blue = turned.blue;
 
     //swap the values of img.rows and img.cols
     swap(img.cols, img.rows);
-
-    //create the new arrays with the new dimensions and store it in the 
-    //img.redGray etc.
-    img.redGray = createArrays(img.rows, img.cols);
-    img.green = createArrays(img.rows, img.cols);
-    img.blue = createArrays(img.rows, img.cols);
-
-    //copy the contents of the temp arrays to the new arrays
-    copyArray(img.redGray, tempRedGray, img);
-    copyArray(img.green, tempGreen, img);
-    copyArray(img.blue, tempBlue, img);
-
-    //delets the temp arrays
-    clearArray(tempRedGray, tempRows);
-    clearArray(tempGreen, tempRows);
-    clearArray(tempBlue, tempRows);
-
 }
 
 
@@ -249,11 +243,9 @@ void rotateImageCCW(image& img)
  * @author Niven Fernandes
  *
  * @par Description:
- * This function flips the image along the x axis. it uses temporary
- * dyanmically allocated temporary arrays to store the modified data.
- * The original array is cleared out and new arrays are stored in the
- * original pointers, then the modified array is copied back to the
- * new array. The temporary array is cleared before exiting the function
+ * This function flips the image along the x axis. Every row is its own
+ * array, so the row pointers are swapped top to bottom and no pixel is
+ * copied or allocated.
  *
  * @param[in, out] img - the structure where the data of the image is stored
  *
@@ -277,48 +269,16 @@ void rotateImageCCW(image& img)
  ***********************************************************************/
 void flipX(image& img)
 {
-    int i, j;
-    //declare the temporary 2D array pointers
-    pixel** tempRedGray;
-    pixel** tempGreen;
-    pixel** tempBlue;
-    //create the three new temporary arrays with the new dimentions
-    tempRedGray = createArrays(img.rows, img.cols);
-    tempGreen = createArrays(img.rows, img.cols);
-    tempBlue = createArrays(img.rows, img.cols);
+    int i;
 
-    //go through each row of the 2D array
-    for (i = 0; i < img.rows; i++)
+    //the rows are separate arrays so only the row pointers are swapped
+    unshareImage(img);
+    for (i = 0; i < img.rows / 2; i++)
     {
-        //go through each colum of the 2D array
-        for (j = 0; j < img.cols; j++)
-        {
-            //write an algorithm to flip the three 2D array over the x axis
-            tempRedGray[img.rows - 1 - i][j] = img.redGray[i][j];
-            tempGreen[img.rows - 1 - i][j] = img.green[i][j];
-            tempBlue[img.rows - 1 - i][j] = img.blue[i][j];
-        }
+        swap(img.redGray[i], img.redGray[img.rows - 1 - i]);
+        swap(img.green[i], img.green[img.rows - 1 - i]);
+        swap(img.blue[i], img.blue[img.rows - 1 - i]);
     }
-
-    //delete all the original arrays
-    clearArray(img.redGray, img.rows);
-    clearArray(img.green, img.rows);
-    clearArray(img.blue, img.rows);
-
-    //create new 2D arrays and store them in the original pointer
-    img.redGray = createArrays(img.rows, img.cols);
-    img.green = createArrays(img.rows, img.cols);
-    img.blue = createArrays(img.rows, img.cols);
-
-    //copy the contents of the temp arrays to the new arrays
-    copyArray(img.redGray, tempRedGray, img);
-    copyArray(img.green, tempGreen, img);
-    copyArray(img.blue, tempBlue, img);
-
-    //delete all the temp arrays
-    clearArray(tempRedGray, img.rows);
-    clearArray(tempGreen, img.rows);
-    clearArray(tempBlue, img.rows);
 }
 
 
@@ -326,11 +286,8 @@ void flipX(image& img)
  * @author Niven Fernandes
  *
  * @par Description:
- * This function flips the image along the y axis. it uses temporary
- * dyanmically allocated temporary arrays to store the modified data.
- * The original array is cleared out and new arrays are stored in the
- * original pointers, then the modified array is copied back to the
- * new array.  The temporary array is cleared before exiting the function
+ * This function flips the image along the y axis. Every row is reversed
+ * in place, the rows are split across threads and nothing is allocated.
  *
  * @param[in, out] img - the structure where the data of the image is stored
  *
@@ -355,47 +312,19 @@ void flipX(image& img)
  ***********************************************************************/
 void flipY(image& img)
 {
-    int i, j;
-    //declare the temporary 2D array pointers
-    pixel** tempRedGray;
-    pixel** tempGreen;
-    pixel** tempBlue;
-    //create the three new temporary arrays with the new dimentions
-    tempRedGray = createArrays(img.rows, img.cols);
-    tempGreen = createArrays(img.rows, img.cols);
-    tempBlue = createArrays(img.rows, img.cols);
-
-    //go through each row of the 2D array
-    for (i = 0; i < img.rows; i++)
+    //every row is reversed where it is
+    unshareImage(img);
+    parallelFor(img.rows, [&](int first, int last)
     {
-        //go through each column of the 2D array
-        for (j = 0; j < img.cols; j++)
+        int i;
+
+        for (i = first; i < last; i++)
         {
-            //write an algorithm to flip the 2D array over the y axis
-            tempRedGray[i][img.cols - 1 - j] = img.redGray[i][j];
-            tempGreen[i][img.cols - 1 - j] = img.green[i][j];
-            tempBlue[i][img.cols - 1 - j] = img.blue[i][j];
+            reverse(img.redGray[i], img.redGray[i] + img.cols);
+            reverse(img.green[i], img.green[i] + img.cols);
+            reverse(img.blue[i], img.blue[i] + img.cols);
         }
-    }
-    //delete all the original arrays
-    clearArray(img.redGray, img.rows);
-    clearArray(img.green, img.rows);
-    clearArray(img.blue, img.rows);
-
-    //create new 2D arrays and store them in the original pointer
-    img.redGray = createArrays(img.rows, img.cols);
-    img.green = createArrays(img.rows, img.cols);
-    img.blue = createArrays(img.rows, img.cols);
-
-    //copy the contents of the temp arrays to the new arrays
-    copyArray(img.redGray, tempRedGray, img);
-    copyArray(img.green, tempGreen, img);
-    copyArray(img.blue, tempBlue, img);
-
-    //delete all the temp arrays
-    clearArray(tempRedGray, img.rows);
-    clearArray(tempGreen, img.rows);
-    clearArray(tempBlue, img.rows);
+    });
 }
 
 
@@ -405,7 +334,8 @@ void flipY(image& img)
  * @par Description:
  * This function will convert the image into gray scale. It will multiply
  * the contents of each array by certain number and then store the result
- * as a pixel in the redGray array.
+ * as a pixel in the redGray array. The green and blue arrays get the same
+ * value. The work is done by grayOp in one pass split across threads.
  *
  * @param[in, out] img - the structure where the data of the image is stored
  *
@@ -426,29 +356,8 @@ void flipY(image& img)
  ***********************************************************************/
 void grayScale(image& img)
 {
-    int i, j;
-    int redGray;
-    int green;
-    int blue;
-    int value;
-
-    //go through each row
-    for (i = 0; i < img.rows; i++)
-    {
-        //go through each column
-        for (j = 0; j < img.cols; j++)
-        {
-            //store the int data from the array in a temporary variable
-            redGray = int(img.redGray[i][j]);
-            green = int(img.green[i][j]);
-            blue = int(img.blue[i][j]);
-
-            //multiply the contents by specific number to convert it to gray
-            value = int(0.3 * redGray + 0.6 * green + 0.1 * blue);
-            // store the content as pixel in the same index of the array
-            img.redGray[i][j] = pixel(value);
-        }
-    }
+    //the gray weights live in grayOp so chains use the same ones
+    applyPointOps(img, grayOp());
 }
 
 
@@ -459,7 +368,7 @@ void grayScale(image& img)
  * This function will convert the image into sepia. It will multiply
  * the contents of each array by certain number and then store the result
  * as a pixel in the redGray array. if the result is more than 255 it will
- * store 255
+ * store 255. The work is done by sepiaOp in one pass split across threads.
  *
  * @param[in, out] img - the structure where the data of the image is stored
  *
@@ -480,52 +389,6 @@ void grayScale(image& img)
  ***********************************************************************/
 void sepia(image& img)
 {
-    //declare the variables
-    int i, j;
-    int tempRedGray, tempGreen, tempBlue;
-    int redGray;
-    int green;
-    int blue;
-
-    //go through each row
-    for (i = 0; i < img.rows; i++)
-    {
-        //go through each column
-        for (j = 0; j < img.cols; j++)
-        {
-            //store the int data from the index to a temporary variables
-            redGray = int(img.redGray[i][j]);
-            green = int(img.green[i][j]);
-            blue = int(img.blue[i][j]);
-
-            //multiply the data by the numbers, store the sum of tempRedGray
-            tempRedGray = int(0.393 * redGray + 0.769 * green + 0.189 * blue);
-            //if the value is more than 255 then store 255
-            if (tempRedGray > 255)
-            {
-                tempRedGray = 255;
-            }
-            //multiply the data by the numbers, store the sum of tempGreen
-            tempGreen = int(0.349 * redGray + 0.686 * green + 0.168 * blue);
-            //if the value is more than 255 then store 255
-            if (tempGreen > 255)
-            {
-                tempGreen = 255;
-            }
-
-            //multiply the data by the numbers, store the sum of tempBlue
-            tempBlue = int(0.272 * redGray + 0.534 * green + 0.131 * blue);
-            //if the value is more than 255 then store 255
-            if (tempBlue > 255)
-            {
-                tempBlue = 255;
-            }
-
-            //store the data in the same index of the array as pixels
-            img.redGray[i][j] = pixel(tempRedGray);
-            img.green[i][j] = pixel(tempGreen);
-            img.blue[i][j] = pixel(tempBlue);
-
-        }
-    }
+    //the sepia weights live in sepiaOp so chains use the same ones
+    applyPointOps(img, sepiaOp());
 }
@@ -0,0 +1,516 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Reading the image with an option and writing it back out
+ ***********************************************************************/
+#include "netPBM.h"
+#include "pixelOps.h"
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function reads the image from the stream and handles the option.
+ * A thumbnail is shrunk while the file is read and tonal operations are
+ * applied while the file is read, every other option is done after the
+ * image is read. An empty option only reads the image. It is used by
+ * main and by the server so both handle options the same way.
+ *
+ * @param[in, out] fin - the input stream
+ * @param[in] option - the image manupulation option, can be empty
+ * @param[out] img - the structure which will store the data
+ * @param[out] maxPixel - the varaible which will store the msxPixel
+ *
+ * @returns true - if it is able to read all the data
+ *
+ * @par Example:
+   @verbatim
+
+   ifstream fin;
+   image img{};
+   int maxPixel;
+
+   processImage(fin, "--sepia", img, maxPixel);
+   //img holds the sepia version of the file
+
+   @endverbatim
+
+ ***********************************************************************/
+bool processImage(istream& fin, string option, image& img, int& maxPixel)
+{
+    bool read;
+    pixelLut lut;
+
+    //a thumbnail is shrunk while the file is read so the full
+    //size image is never stored
+    if (option.compare(0, 12, "--thumbnail=") == 0)
+    {
+        return readFileThumbnail(fin, img, maxPixel, atoi(option.substr(12).c_str()));
+    }
+
+    //tonal operations are composed into one table and applied
+    //while the file is read
+    if (option.compare(0, 7, "--tone=") == 0)
+    {
+        if (!parseTone(option, lut))
+        {
+            throw invalid_argument("Invalid option: " + option);
+        }
+        return readFile(fin, img, maxPixel, &lut);
+    }
+
+    //read file
+    read = readFile(fin, img, maxPixel);
+
+    //handle options
+    if (option != "")
+    {
+        handleOptions(option, img);
+    }
+
+    return read;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * According to the string passed, this function will call the appropriate
+ * image manupulation function. The strucure is passed by reference.
+ * An unknown option or bad option values throw an invalid_argument.
+ *
+ * @param[in] option - the image manupulation option
+ * @param[in,out] img - the structure that has the data that will be modified
+ *
+ *
+ * @par Example:
+   @verbatim
+
+   image img;
+
+    handleOptions("--sepia" , img);
+    //this function will call the sepia function and the sepia functions
+   // will modify the data of the image to sepia
+
+   @endverbatim
+
+ ***********************************************************************/
+void handleOptions(string option, image& img)
+{
+    int newRows, newCols, size;
+    string filter, value;
+    vector<double> kernel;
+    borderMode border;
+    pixelLut lut;
+    imageStats stats;
+    vector<pointStep> steps;
+    double matrix[6], amount;
+    bool dither, tiled;
+    int x, y;
+
+    //if option is --rotataCW , call rotateImageCW function
+    if (option == "--rotateCW")
+    {
+        rotateImageCW(img);
+    }
+
+    //else if option is --rotataCCW , call rotateImageCCW function
+    else if (option == "--rotateCCW")
+    {
+        rotateImageCCW(img);
+    }
+
+    //else if option is --flipX, call flipX function
+    else if (option == "--flipX")
+    {
+        flipX(img);
+    }
+
+    //else if option is --flipY, call flipY function
+    else if (option == "--flipY")
+    {
+        flipY(img);
+    }
+
+    //else if option is --grayscale call grayscale function
+    else if (option == "--grayscale")
+    {
+        grayScale(img);
+    }
+
+    //else if option is --sepia, call sepia function
+    else if (option == "--sepia")
+    {
+        sepia(img);
+    }
+
+    //else if option is --resize=COLSxROWS[:filter], call resizeImage
+    else if (option.compare(0, 9, "--resize=") == 0)
+    {
+        if (!parseResize(option, newRows, newCols, filter))
+        {
+            throw invalid_argument("Invalid option: " + option);
+        }
+        resizeImage(img, newRows, newCols, filter);
+    }
+
+    //else if option is --tone=OP[,OP...], call applyLut
+    else if (option.compare(0, 7, "--tone=") == 0)
+    {
+        if (!parseTone(option, lut))
+        {
+            throw invalid_argument("Invalid option: " + option);
+        }
+        applyLut(img, lut);
+    }
+
+    //else if option is --autolevels, stretch every array using its histogram
+    else if (option == "--autolevels")
+    {
+        computeStats(img, stats);
+        autoLevelsLut(stats, lut);
+        applyLut(img, lut);
+    }
+
+    //else if option is --equalize, equalize the histogram of every array
+    else if (option == "--equalize")
+    {
+        computeStats(img, stats);
+        equalizeLut(stats, lut);
+        applyLut(img, lut);
+    }
+
+    //else if option is --chain=STEP[+STEP...], call applyChain
+    else if (option.compare(0, 8, "--chain=") == 0)
+    {
+        if (!parseChain(option, steps))
+        {
+            throw invalid_argument("Invalid option: " + option);
+        }
+        applyChain(img, steps);
+    }
+
+    //else if option is --blur=SIGMA[:border], call gaussianBlur
+    else if (option.compare(0, 7, "--blur=") == 0)
+    {
+        value = option.substr(7);
+        if (!parseBorder(value.find(':') == string::npos ? "" :
+            value.substr(value.find(':') + 1), border))
+        {
+            throw invalid_argument("Invalid option: " + option);
+        }
+        gaussianBlur(img, atof(value.c_str()), border);
+    }
+
+    //else if option is --sharpen[=AMOUNT][:border], call sharpen
+    else if (option.compare(0, 9, "--sharpen") == 0)
+    {
+        if (!parseSharpen(option, amount, border))
+        {
+            throw invalid_argument("Invalid option: " + option);
+        }
+        sharpen(img, amount, border);
+    }
+
+    //else if option is --convolve=KERNEL[:border], call convolveImage
+    else if (option.compare(0, 11, "--convolve=") == 0)
+    {
+        if (!parseConvolve(option, kernel, size, border))
+        {
+            throw invalid_argument("Invalid option: " + option);
+        }
+        convolveImage(img, kernel, size, border);
+    }
+
+    //else if option is --rotate=DEG or --affine=a,b,c,d,e,f, call warpImage
+    else if (option.compare(0, 9, "--rotate=") == 0 || option.compare(0, 9, "--affine=") == 0)
+    {
+        if (!parseWarp(option, img.rows, img.cols, matrix, filter, border))
+        {
+            throw invalid_argument("Invalid option: " + option);
+        }
+        warpImage(img, matrix, filter, border);
+    }
+
+    //else if option is --edges[=THRESHOLD][:border], call edgeDetect
+    else if (option.compare(0, 7, "--edges") == 0)
+    {
+        if (!parseEdges(option, size, border))
+        {
+            throw invalid_argument("Invalid option: " + option);
+        }
+        edgeDetect(img, size, border);
+    }
+
+    //else if option is --erode, --dilate, --open or --close, call morphImage
+    else if (option.compare(0, 8, "--erode=") == 0 || option.compare(0, 9, "--dilate=") == 0 ||
+        option.compare(0, 7, "--open=") == 0 || option.compare(0, 8, "--close=") == 0)
+    {
+        if (!parseMorph(option, value, newCols, newRows))
+        {
+            throw invalid_argument("Invalid option: " + option);
+        }
+        morphImage(img, value, newCols, newRows);
+    }
+
+    //else if option is --median=RADIUS[:border], call medianFilter
+    else if (option.compare(0, 9, "--median=") == 0)
+    {
+        if (!parseMedian(option, size, border))
+        {
+            throw invalid_argument("Invalid option: " + option);
+        }
+        medianFilter(img, size, border);
+    }
+
+    //else if option is --quantize=[gray|rgb]N[:flags], call quantizeImage
+    else if (option.compare(0, 11, "--quantize=") == 0)
+    {
+        if (!parseQuantize(option, value, size, dither))
+        {
+            throw invalid_argument("Invalid option: " + option);
+        }
+        quantizeImage(img, value, size, dither);
+    }
+
+    //else if option is --overlay=X,Y:FILE or tile:FILE, call overlayImage
+    else if (option.compare(0, 10, "--overlay=") == 0)
+    {
+        if (!parseOverlay(option, value, x, y, tiled))
+        {
+            throw invalid_argument("Invalid option: " + option);
+        }
+        overlayImage(img, value, x, y, tiled);
+    }
+
+    else
+    {
+        throw invalid_argument("Invalid option: " + option);
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * According to the option string and the output type string passed to this
+ * function, this function will call the approprite function to write the
+ * data to the array. we pass the structure, output stream and the maxPixel
+ * to this function. The --qoi type writes a QOI file, --planar and
+ * --planar420 write raw planes. An option that
+ * leaves levels, like --quantize=gray16, is written with the maxPixel
+ * outputMaxPixel gives.
+ *
+ * @param[in] option - the image manupulation option
+ * @param[in] type - the image output type
+ * @param[in] img - the structure having the data
+ * @param[out] fout - the output stream
+ * @param[in] maxPixel -  the maximum pixel in the file
+ *
+ *
+ * @par Example:
+   @verbatim
+   ofstream fout;
+   image img;
+   int maxPixel=255;
+
+   handleOutput("--sepia", "--binary",img, fout, int maxPixel)
+   //this function will call writeFileP6(fout, img, maxpixel)
+   //to write the data to the file
+
+   @endverbatim
+
+ ***********************************************************************/
+void handleOutput(string option, string type, image img, ostream& fout, int maxPixel)
+{
+    image scaled = img;
+    pixel stretch[256];
+    int i, j, v;
+
+    //an option can leave levels that are written with a smaller maxPixel
+    maxPixel = outputMaxPixel(option, maxPixel);
+
+    //raw planes, a gray option writes just the first one
+    if (type == "--planar" || type == "--planar420")
+    {
+        writePlanar(fout, img, type == "--planar420", isGrayChain(option));
+    }
+
+    //check if option is --grayscale or a chain ending with grayscale,
+    //a QOI file is always color
+    else if (isGrayChain(option) && type != "--qoi")
+    {
+        //if grayscale, call P5 or P2 functions according to the option string
+        if (type == "--binary")
+        {
+            writeGrayP5(fout, img, maxPixel);
+        }
+
+        else if (type == "--ascii")
+        {
+            writeGrayP2(fout, img, maxPixel);
+        }
+    }
+
+
+    //if type is --ascii, call writeP3
+    else if (type == "--ascii")
+    {
+        writeFileP3(fout, img, maxPixel);
+    }
+
+
+    //if type is --ascii, call writeP6
+    else if (type == "--binary")
+    {
+        writeFileP6(fout, img, maxPixel);
+    }
+
+    //if type is --qoi, call writeFileQoi, QOI has no maxPixel so levels
+    //are stretched back to 0 to 255 in new arrays first
+    else if (type == "--qoi" && maxPixel < 255)
+    {
+        for (v = 0; v < 256; v++)
+        {
+            stretch[v] = pixel(min(v, maxPixel) * 255 / maxPixel);
+        }
+        scaled.redGray = scaled.green = scaled.blue = nullptr;
+        try
+        {
+            scaled.redGray = createArrays(img.rows, img.cols);
+            scaled.green = createArrays(img.rows, img.cols);
+            scaled.blue = createArrays(img.rows, img.cols);
+            for (i = 0; i < img.rows; i++)
+            {
+                for (j = 0; j < img.cols; j++)
+                {
+                    scaled.redGray[i][j] = stretch[img.redGray[i][j]];
+                    scaled.green[i][j] = stretch[img.green[i][j]];
+                    scaled.blue[i][j] = stretch[img.blue[i][j]];
+                }
+            }
+            writeFileQoi(fout, scaled);
+        }
+        catch (...)
+        {
+            clearArray(scaled.redGray, scaled.rows);
+            clearArray(scaled.green, scaled.rows);
+            clearArray(scaled.blue, scaled.rows);
+            throw;
+        }
+        clearArray(scaled.redGray, scaled.rows);
+        clearArray(scaled.green, scaled.rows);
+        clearArray(scaled.blue, scaled.rows);
+    }
+
+    else if (type == "--qoi")
+    {
+        writeFileQoi(fout, img);
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function tells if the output type is one the program can write.
+ *
+ * @param[in] type - the image output type
+ *
+ * @returns true - if it is --binary, --ascii, --qoi, --planar or
+ *          --planar420
+ *
+ * @par Example:
+   @verbatim
+
+   if (!isOutputType("--qoi"))
+   {
+       printUsage();
+   }
+
+   @endverbatim
+
+ ***********************************************************************/
+bool isOutputType(string type)
+{
+    return type == "--binary" || type == "--ascii" || type == "--qoi" ||
+        type == "--planar" || type == "--planar420";
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function gives the extension of the output file. A QOI file is
+ * .qoi, raw planes .yuv, a gray netPBM file .pgm and a color netPBM file
+ * .ppm.
+ *
+ * @param[in] option - the image manupulation option
+ * @param[in] type - the image output type
+ *
+ * @returns the extension with its dot
+ *
+ * @par Example:
+   @verbatim
+
+   string name = "sepia" + outputExtension("--sepia", "--binary");
+   //name is sepia.ppm
+
+   @endverbatim
+
+ ***********************************************************************/
+string outputExtension(string option, string type)
+{
+    if (type == "--qoi")
+    {
+        return ".qoi";
+    }
+    if (type == "--planar" || type == "--planar420")
+    {
+        return ".yuv";
+    }
+    return isGrayChain(option) ? ".pgm" : ".ppm";
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function gives the maxPixel an option is written with. A
+ * quantize option with grayN or rgbN leaves the level numbers 0 to N - 1
+ * in the image, so it is written with a maxPixel of N - 1. Every other
+ * option keeps the maxPixel of the input.
+ *
+ * @param[in] option - the image manupulation option
+ * @param[in] maxPixel - the maxPixel of the input
+ *
+ * @returns the maxPixel of the output
+ *
+ * @par Example:
+   @verbatim
+
+   int maxPixel = outputMaxPixel("--quantize=gray16", 255);
+   //maxPixel is 15
+
+   @endverbatim
+
+ ***********************************************************************/
+int outputMaxPixel(string option, int maxPixel)
+{
+    string mode;
+    int levels;
+    bool dither;
+
+    if (option.compare(0, 11, "--quantize=") == 0 && parseQuantize(option, mode, levels, dither) &&
+        (mode == "gray" || mode == "rgb"))
+    {
+        return levels - 1;
+    }
+    return maxPixel;
+}
@@ -0,0 +1,331 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Compositing a watermark with alpha over the image
+ ***********************************************************************/
+#include "pixelOps.h"
+#include <cstring>
+
+/************************************************************************
+ *             Constants
+ ***********************************************************************/
+ /*!
+  * @brief pixels blended at a time, copied to local arrays so the
+  *        compiler can use vector instructions on them
+  */
+const int OVERLAY_CHUNK = 32;
+
+
+/************************************************************************
+ *             Structure
+ ***********************************************************************/
+ /**
+ * @brief A watermark ready to blend, every array has rows X cols values
+ */
+struct watermark
+{
+    /**
+    * @brief holds the number of rows
+    */
+    int rows;
+    /**
+    * @brief holds the number of columns
+    */
+    int cols;
+    /**
+    * @brief the three colors multiplied by the alpha
+    */
+    vector<pixel> color[3];
+    /**
+    * @brief 255 minus the alpha, how much of the image shows through
+    */
+    vector<pixel> inverse;
+};
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function blends a run of premultiplied watermark pixels over one
+ * row of an array. The new value is the watermark color plus the image
+ * value times 255 minus the alpha, over 255. A color can not be larger
+ * than its alpha so the sum never passes 255. The run is done in chunks
+ * of OVERLAY_CHUNK pixels through local arrays so the loop does not have
+ * to worry about the rows overlapping.
+ *
+ * @param[in, out] row - the values of the image under the watermark
+ * @param[in] color - the premultiplied values of the watermark
+ * @param[in] inverse - 255 minus the alpha of the watermark
+ * @param[in] count - the number of pixels
+ *
+ * @par Example:
+   @verbatim
+
+   blendRow(img.redGray[i] + x, mark.color[0].data(), mark.inverse.data(), mark.cols);
+
+   @endverbatim
+
+ ***********************************************************************/
+static void blendRow(pixel* row, const pixel* color, const pixel* inverse, int count)
+{
+    pixel d[OVERLAY_CHUNK], c[OVERLAY_CHUNK], v[OVERLAY_CHUNK];
+    int j, k;
+
+    for (j = 0; j + OVERLAY_CHUNK <= count; j += OVERLAY_CHUNK)
+    {
+        memcpy(d, row + j, OVERLAY_CHUNK);
+        memcpy(c, color + j, OVERLAY_CHUNK);
+        memcpy(v, inverse + j, OVERLAY_CHUNK);
+        for (k = 0; k < OVERLAY_CHUNK; k++)
+        {
+            d[k] = pixel(c[k] + divide255(unsigned(d[k]) * v[k]));
+        }
+        memcpy(row + j, d, OVERLAY_CHUNK);
+    }
+    for (; j < count; j++)
+    {
+        row[j] = pixel(color[j] + divide255(unsigned(row[j]) * inverse[j]));
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function reads a watermark and multiplies its colors by its
+ * alpha once, so blending is a multiply and an add per value. A P7 file
+ * with GRAYSCALE_ALPHA or RGB_ALPHA gives the alpha, any other file the
+ * program reads is opaque. Colors and alpha are scaled from 0 to the
+ * maxPixel of the file up to 0 to 255.
+ *
+ * @param[in] file - the name of the watermark
+ * @param[out] mark - the watermark ready to blend
+ *
+ * @par Example:
+   @verbatim
+
+   watermark mark;
+   loadWatermark("logo.pam", mark);
+
+   @endverbatim
+
+ ***********************************************************************/
+static void loadWatermark(string file, watermark& mark)
+{
+    ifstream fin;
+    image img{};
+    pixel** alpha = nullptr;
+    int maxPixel, i, j, c, v;
+    size_t at;
+    pixel scale[256];
+
+    isBinFileOpen(file, fin);
+    try
+    {
+        readHeader(fin, img, maxPixel);
+        if (img.magicNumber == "P7")
+        {
+            img.redGray = createArrays(img.rows, img.cols);
+            img.green = createArrays(img.rows, img.cols);
+            img.blue = createArrays(img.rows, img.cols);
+            alpha = createArrays(img.rows, img.cols);
+            readFileP7(fin, img, alpha);
+        }
+        else
+        {
+            readFile(fin, img, maxPixel);
+        }
+
+        //a value over the maxPixel counts as the maxPixel
+        for (v = 0; v < 256; v++)
+        {
+            scale[v] = pixel((min(v, maxPixel) * 255 + maxPixel / 2) / maxPixel);
+        }
+
+        mark.rows = img.rows;
+        mark.cols = img.cols;
+        for (c = 0; c < 3; c++)
+        {
+            mark.color[c].resize(size_t(img.rows) * img.cols);
+        }
+        mark.inverse.resize(size_t(img.rows) * img.cols);
+
+        for (i = 0; i < img.rows; i++)
+        {
+            for (j = 0; j < img.cols; j++)
+            {
+                unsigned a = alpha != nullptr ? scale[alpha[i][j]] : 255;
+                at = size_t(i) * img.cols + j;
+                mark.color[0][at] = pixel(divide255(scale[img.redGray[i][j]] * a));
+                mark.color[1][at] = pixel(divide255(scale[img.green[i][j]] * a));
+                mark.color[2][at] = pixel(divide255(scale[img.blue[i][j]] * a));
+                mark.inverse[at] = pixel(255 - a);
+            }
+        }
+    }
+    catch (...)
+    {
+        clearArray(img.redGray, img.rows);
+        clearArray(img.green, img.rows);
+        clearArray(img.blue, img.rows);
+        clearArray(alpha, img.rows);
+        throw;
+    }
+
+    clearArray(img.redGray, img.rows);
+    clearArray(img.green, img.rows);
+    clearArray(img.blue, img.rows);
+    clearArray(alpha, img.rows);
+    fin.close();
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function composites a watermark over the image. Placed at x, y
+ * only the rows and columns it covers are touched, so the time goes
+ * with the size of the watermark and not of the image, and the parts
+ * outside of the image are cut off. Tiled, copies of the watermark
+ * cover the whole image starting at the top left corner, a row of the
+ * image is blended one copy at a time. The rows are split between the
+ * threads. Arrays shared by a gray image get their own copy first,
+ * since the watermark can have color.
+ *
+ * @param[in, out] img - the image
+ * @param[in] file - the name of the watermark, a P7 file for alpha
+ * @param[in] x - the column of the left edge of the watermark
+ * @param[in] y - the row of the top edge of the watermark
+ * @param[in] tiled - true to repeat the watermark over the image
+ *
+ * @par Example:
+   @verbatim
+
+   overlayImage(img, "logo.pam", 20, 20, false);
+   //logo.pam is blended with its top left corner at row 20, column 20
+
+   @endverbatim
+
+ ***********************************************************************/
+void overlayImage(image& img, string file, int x, int y, bool tiled)
+{
+    watermark mark;
+    pixel** planes[3];
+    int first, last, left, right;
+
+    loadWatermark(file, mark);
+
+    //the rows and columns covered
+    first = tiled ? 0 : max(y, 0);
+    last = tiled ? img.rows : min(y + mark.rows, img.rows);
+    left = tiled ? 0 : max(x, 0);
+    right = tiled ? img.cols : min(x + mark.cols, img.cols);
+    if (first >= last || left >= right)
+    {
+        return;
+    }
+
+    unshareImage(img);
+    planes[0] = img.redGray;
+    planes[1] = img.green;
+    planes[2] = img.blue;
+
+    parallelFor(last - first, [&](int start, int end)
+    {
+        int i, j, c, row, count;
+        size_t at;
+
+        for (i = first + start; i < first + end; i++)
+        {
+            row = tiled ? i % mark.rows : i - y;
+            for (j = left; j < right; j += count)
+            {
+                //the part of one copy of the watermark on this row
+                at = size_t(row) * mark.cols + (tiled ? j % mark.cols : j - x);
+                count = tiled ? min(mark.cols - j % mark.cols, right - j) : right - j;
+                for (c = 0; c < 3; c++)
+                {
+                    blendRow(planes[c][i] + j, mark.color[c].data() + at,
+                        mark.inverse.data() + at, count);
+                }
+            }
+        }
+    });
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function reads an overlay option, --overlay=X,Y:FILE to place
+ * the top left corner of the watermark at column X and row Y, or
+ * --overlay=tile:FILE to repeat it over the whole image. X and Y can be
+ * negative to cut off the top or left of the watermark. The file name
+ * is everything after the first colon so it can have colons of its own.
+ *
+ * @param[in] option - the option string
+ * @param[out] file - the name of the watermark
+ * @param[out] x - the column of the left edge
+ * @param[out] y - the row of the top edge
+ * @param[out] tiled - true for tile
+ *
+ * @returns true - if the option is a valid overlay
+ *
+ * @par Example:
+   @verbatim
+
+   string file;
+   int x, y;
+   bool tiled;
+
+   parseOverlay("--overlay=20,-5:logo.pam", file, x, y, tiled);
+   //file is logo.pam, x is 20, y is -5 and tiled is false
+
+   @endverbatim
+
+ ***********************************************************************/
+bool parseOverlay(string option, string& file, int& x, int& y, bool& tiled)
+{
+    string place, second;
+    size_t colon;
+    char* end;
+    long value;
+
+    if (option.compare(0, 10, "--overlay=") != 0)
+    {
+        return false;
+    }
+    colon = option.find(':', 10);
+    if (colon == string::npos || colon + 1 == option.size())
+    {
+        return false;
+    }
+    place = option.substr(10, colon - 10);
+    file = option.substr(colon + 1);
+    x = y = 0;
+    tiled = place == "tile";
+    if (tiled)
+    {
+        return true;
+    }
+
+    //X,Y as whole numbers
+    value = strtol(place.c_str(), &end, 10);
+    if (end == place.c_str() || *end != ',' || value < -(1 << 30) || value > (1 << 30))
+    {
+        return false;
+    }
+    x = int(value);
+    second = end + 1;
+    value = strtol(second.c_str(), &end, 10);
+    if (end == second.c_str() || *end != '\0' || value < -(1 << 30) || value > (1 << 30))
+    {
+        return false;
+    }
+    y = int(value);
+    return true;
+}
@@ -0,0 +1,466 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Hardware counters and times of every stage of a run
+ *
+ * @par Counters:
+ * On Linux each stage is measured with perf_event_open. The cycles,
+ * instructions and branch misses are one group and the L1 data, last
+ * level cache and data TLB read misses are a second group, so the
+ * counters of a group are always counted over the same time and IPC is
+ * a true ratio. A counter the CPU or the system does not allow is left
+ * out, and with none at all only the times are reported.
+ ***********************************************************************/
+#include "netPBM.h"
+#include <chrono>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/************************************************************************
+ *             Constants
+ ***********************************************************************/
+ /*!
+  * @brief the number of counters
+  */
+const int PROFILE_EVENTS = 6;
+
+/*!
+ * @brief the names of the counters in the JSON
+ */
+const char* const PROFILE_NAMES[PROFILE_EVENTS] = { "cycles", "instructions",
+    "branchMisses", "l1dMisses", "llcMisses", "dtlbMisses" };
+
+
+/************************************************************************
+ *             Structure
+ ***********************************************************************/
+ /**
+ * @brief The open counters, -1 for a counter that could not be opened
+ */
+struct profileCounters
+{
+    /**
+    * @brief the file descriptor of each counter
+    */
+    int fd[PROFILE_EVENTS];
+};
+
+/**
+* @brief A raw reading of one counter, the times let a counter that
+*        shared the hardware with others be scaled up
+*/
+struct counterReading
+{
+    /**
+    * @brief the count
+    */
+    unsigned long long value;
+    /**
+    * @brief the time the counter was enabled
+    */
+    unsigned long long enabled;
+    /**
+    * @brief the time the counter was really counting
+    */
+    unsigned long long running;
+};
+
+/**
+* @brief The measurements of one stage
+*/
+struct profileStage
+{
+    /**
+    * @brief the name of the stage
+    */
+    string name;
+    /**
+    * @brief the pixels the stage worked on
+    */
+    long long pixels;
+    /**
+    * @brief the wall clock time
+    */
+    double seconds;
+    /**
+    * @brief true for a counter that was read
+    */
+    bool have[PROFILE_EVENTS];
+    /**
+    * @brief the scaled count of each counter
+    */
+    double count[PROFILE_EVENTS];
+};
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function opens the counters for this process. The counters are
+ * inherited by threads started later, so they have to be opened before
+ * the thread pool of parallelFor starts for its work to be counted. Only
+ * user space is counted so a normal perf_event_paranoid setting allows
+ * it. Without Linux every counter is -1.
+ *
+ * @param[out] counters - the open counters
+ *
+ * @par Example:
+   @verbatim
+
+   profileCounters counters;
+   openCounters(counters);
+
+   @endverbatim
+
+ ***********************************************************************/
+static void openCounters(profileCounters& counters)
+{
+    int e;
+
+    for (e = 0; e < PROFILE_EVENTS; e++)
+    {
+        counters.fd[e] = -1;
+    }
+
+#ifdef __linux__
+    //the type, config and the first counter of the group of each counter
+    const unsigned long long cache = PERF_COUNT_HW_CACHE_OP_READ << 8 |
+        PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+    const unsigned types[PROFILE_EVENTS] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+        PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE };
+    const unsigned long long configs[PROFILE_EVENTS] = { PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_L1D | cache, PERF_COUNT_HW_CACHE_LL | cache,
+        PERF_COUNT_HW_CACHE_DTLB | cache };
+    const int leaders[PROFILE_EVENTS] = { 0, 0, 0, 3, 3, 3 };
+    perf_event_attr attr;
+
+    for (e = 0; e < PROFILE_EVENTS; e++)
+    {
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = types[e];
+        attr.config = configs[e];
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        //a counter whose group has no first counter counts on its own
+        counters.fd[e] = int(syscall(__NR_perf_event_open, &attr, 0, -1,
+            leaders[e] == e ? -1 : counters.fd[leaders[e]], 0));
+    }
+#endif
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function reads every open counter. A counter that can not be
+ * read is marked with a running time of 0.
+ *
+ * @param[in] counters - the open counters
+ * @param[out] readings - the reading of each counter
+ *
+ * @par Example:
+   @verbatim
+
+   counterReading before[PROFILE_EVENTS];
+   readCounters(counters, before);
+
+   @endverbatim
+
+ ***********************************************************************/
+static void readCounters(const profileCounters& counters, counterReading readings[])
+{
+    int e;
+
+    for (e = 0; e < PROFILE_EVENTS; e++)
+    {
+        readings[e].value = readings[e].enabled = readings[e].running = 0;
+#ifdef __linux__
+        if (counters.fd[e] >= 0 &&
+            read(counters.fd[e], &readings[e], sizeof(readings[e])) != ssize_t(sizeof(readings[e])))
+        {
+            readings[e].running = 0;
+        }
+#endif
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function closes the counters.
+ *
+ * @param[in, out] counters - the open counters
+ *
+ * @par Example:
+   @verbatim
+
+   closeCounters(counters);
+
+   @endverbatim
+
+ ***********************************************************************/
+static void closeCounters(profileCounters& counters)
+{
+    int e;
+
+    for (e = 0; e < PROFILE_EVENTS; e++)
+    {
+#ifdef __linux__
+        if (counters.fd[e] >= 0)
+        {
+            close(counters.fd[e]);
+        }
+#endif
+        counters.fd[e] = -1;
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function runs one stage and measures it. The counts are the
+ * difference of the readings before and after, scaled by the enabled
+ * over the running time when the kernel had to take turns with more
+ * counters than the CPU has. A counter that never ran in the stage is
+ * left out.
+ *
+ * @param[in] counters - the open counters
+ * @param[in] name - the name of the stage
+ * @param[in] work - the stage
+ * @param[out] stages - the stage is added to the end
+ *
+ * @par Example:
+   @verbatim
+
+   measureStage(counters, "read", [&]() { readFile(fin, img, maxPixel); }, stages);
+
+   @endverbatim
+
+ ***********************************************************************/
+static void measureStage(const profileCounters& counters, string name,
+    const function<void()>& work, vector<profileStage>& stages)
+{
+    counterReading before[PROFILE_EVENTS], after[PROFILE_EVENTS];
+    profileStage stage;
+    unsigned long long running;
+    int e;
+
+    readCounters(counters, before);
+    auto start = chrono::steady_clock::now();
+    work();
+    auto end = chrono::steady_clock::now();
+    readCounters(counters, after);
+
+    stage.name = name;
+    stage.pixels = 0;
+    stage.seconds = chrono::duration<double>(end - start).count();
+    for (e = 0; e < PROFILE_EVENTS; e++)
+    {
+        running = after[e].running - before[e].running;
+        stage.have[e] = counters.fd[e] >= 0 && after[e].running > 0 && running > 0;
+        stage.count[e] = !stage.have[e] ? 0.0 :
+            double(after[e].value - before[e].value) *
+            double(after[e].enabled - before[e].enabled) / double(running);
+    }
+    stages.push_back(stage);
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function prints the stages as JSON. Every stage has its time and
+ * the counters that were read, with the IPC and every counter divided by
+ * the pixels of the stage. A counter that was not read is null.
+ *
+ * @param[in, out] out - the stream to print to
+ * @param[in] stages - the measured stages
+ * @param[in] counted - true if any counter could be opened
+ *
+ * @par Example:
+   @verbatim
+
+   writeProfileJson(cout, stages, true);
+
+   @endverbatim
+
+ ***********************************************************************/
+static void writeProfileJson(ostream& out, const vector<profileStage>& stages, bool counted)
+{
+    size_t s;
+    int e;
+
+    out << "{\n";
+    out << "  \"counters\": " << (counted ? "true" : "false") << ",\n";
+    out << "  \"stages\": [\n";
+
+    for (s = 0; s < stages.size(); s++)
+    {
+        const profileStage& stage = stages[s];
+        double pixels = double(max(stage.pixels, 1LL));
+
+        out << "    {\n";
+        out << "      \"name\": \"" << stage.name << "\",\n";
+        out << "      \"pixels\": " << stage.pixels << ",\n";
+        out << "      \"seconds\": " << fixed << setprecision(6) << stage.seconds << ",\n";
+        for (e = 0; e < PROFILE_EVENTS; e++)
+        {
+            out << "      \"" << PROFILE_NAMES[e] << "\": ";
+            if (stage.have[e])
+            {
+                out << fixed << setprecision(0) << stage.count[e];
+            }
+            else
+            {
+                out << "null";
+            }
+            out << ",\n";
+        }
+
+        //instructions over cycles
+        out << "      \"ipc\": ";
+        if (stage.have[0] && stage.have[1] && stage.count[0] > 0.0)
+        {
+            out << fixed << setprecision(3) << stage.count[1] / stage.count[0];
+        }
+        else
+        {
+            out << "null";
+        }
+        out << ",\n";
+
+        out << "      \"perPixel\": {\n";
+        for (e = 0; e < PROFILE_EVENTS; e++)
+        {
+            out << "        \"" << PROFILE_NAMES[e] << "\": ";
+            if (stage.have[e])
+            {
+                out << fixed << setprecision(4) << stage.count[e] / pixels;
+            }
+            else
+            {
+                out << "null";
+            }
+            out << (e < PROFILE_EVENTS - 1 ? "," : "") << "\n";
+        }
+        out << "      }\n";
+        out << "    }" << (s + 1 < stages.size() ? "," : "") << "\n";
+    }
+
+    out << "  ]\n";
+    out << "}" << endl;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function does the same work as a normal run, reading the file,
+ * doing the option and writing the output, and measures each of them as
+ * a stage. The whole image is read before the option so every stage is
+ * on its own, the strip pipeline and the cache are not used. A thumbnail
+ * or tone option is done while the file is read, so it is counted in the
+ * read stage. The stages are printed as JSON on standard output. If no
+ * counter can be opened, for a CPU without them, a virtual machine or a
+ * system that does not allow them, only the times are printed.
+ *
+ * @param[in] option - the image manupulation option, empty for none
+ * @param[in] type - the output type
+ * @param[in] input - the path of the input image
+ * @param[in] output - the path of the output image
+ *
+ * @par Example:
+   @verbatim
+
+   runProfile("--rotateCW", "--binary", "image.ppm", "turned.ppm");
+
+   @endverbatim
+
+ ***********************************************************************/
+void runProfile(string option, string type, string input, string output)
+{
+    ifstream fin;
+    ofstream fout;
+    image img{};
+    int maxPixel = 0, e;
+    long long pixels;
+    bool fused, counted = false;
+    profileCounters counters;
+    vector<profileStage> stages;
+
+    fused = option.compare(0, 12, "--thumbnail=") == 0 || option.compare(0, 7, "--tone=") == 0;
+
+    isBinFileOpen(input, fin);
+    isBinOutputOpen(output, fout);
+
+    //before any work so the threads of parallelFor inherit the counters
+    openCounters(counters);
+    for (e = 0; e < PROFILE_EVENTS; e++)
+    {
+        counted = counted || counters.fd[e] >= 0;
+    }
+
+    try
+    {
+        measureStage(counters, fused ? "read " + option : "read", [&]()
+        {
+            if (fused)
+            {
+                processImage(fin, option, img, maxPixel);
+            }
+            else
+            {
+                readFile(fin, img, maxPixel);
+            }
+        }, stages);
+        stages.back().pixels = (long long)img.rows * img.cols;
+
+        //per pixel of the image the option was given
+        if (option != "" && !fused)
+        {
+            pixels = (long long)img.rows * img.cols;
+            measureStage(counters, option, [&]() { handleOptions(option, img); }, stages);
+            stages.back().pixels = pixels;
+        }
+
+        measureStage(counters, "write", [&]()
+        {
+            handleOutput(option, type, img, fout, maxPixel);
+            fout.flush();
+        }, stages);
+        stages.back().pixels = (long long)img.rows * img.cols;
+    }
+    catch (...)
+    {
+        closeCounters(counters);
+        clearArray(img.redGray, img.rows);
+        clearArray(img.green, img.rows);
+        clearArray(img.blue, img.rows);
+        throw;
+    }
+
+    closeCounters(counters);
+    clearArray(img.redGray, img.rows);
+    clearArray(img.green, img.rows);
+    clearArray(img.blue, img.rows);
+
+    writeProfileJson(cout, stages, counted);
+}
@@ -0,0 +1,351 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Every level of a image pyramid written in one pass of the input
+ ***********************************************************************/
+#include "netPBM.h"
+#include <cstring>
+
+/************************************************************************
+ *             Constants
+ ***********************************************************************/
+ /*!
+  * @brief rows of a level kept before they are written to its file
+  */
+const int PYRAMID_STRIP = 16;
+
+/*!
+ * @brief the most levels, a side of 2^31 pixels can not be read
+ */
+const int PYRAMID_MAX_LEVELS = 31;
+
+
+/************************************************************************
+ *             Structure
+ ***********************************************************************/
+ /**
+ * @brief One level of the pyramid, half the size of the level above it
+ */
+struct pyramidLevel
+{
+    /**
+    * @brief holds the number of rows
+    */
+    int rows;
+    /**
+    * @brief holds the number of columns
+    */
+    int cols;
+    /**
+    * @brief a row of the level above waiting for the row under it
+    */
+    vector<pixel> above[3];
+    /**
+    * @brief true if above holds a row
+    */
+    bool waiting;
+    /**
+    * @brief the finished rows not written yet, PYRAMID_STRIP rows long
+    */
+    image strip;
+    /**
+    * @brief the number of rows of strip in use
+    */
+    int filled;
+    /**
+    * @brief the file of the level
+    */
+    ofstream fout;
+};
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function writes the finished rows of a level to its file and
+ * empties the strip.
+ *
+ * @param[in, out] level - the level
+ * @param[in] ascii - true for P3 text, false for P6 bytes
+ *
+ * @par Example:
+   @verbatim
+
+   flushStrip(levels[0], false);
+
+   @endverbatim
+
+ ***********************************************************************/
+static void flushStrip(pyramidLevel& level, bool ascii)
+{
+    image part = level.strip;
+
+    if (level.filled == 0)
+    {
+        return;
+    }
+    part.rows = level.filled;
+    writeRaster(level.fout, part, 3, ascii);
+    level.filled = 0;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function hands a row of the level above to level k. The first
+ * row of a pair is kept, the second one is halved together with it into
+ * a row of level k, which is handed on to level k + 1 the same way. So
+ * one input row can finish a row on every level, and each level only
+ * ever holds one row of the level above and its own strip.
+ *
+ * @param[in, out] levels - the levels of the pyramid
+ * @param[in] k - the level the row is handed to
+ * @param[in] planes - the red, green and blue values of the row
+ * @param[in] cols - the number of columns of the row
+ * @param[in] ascii - true for P3 text, false for P6 bytes
+ *
+ * @par Example:
+   @verbatim
+
+   const pixel* planes[3] = { red, green, blue };
+   addRow(levels, 0, planes, img.cols, false);
+
+   @endverbatim
+
+ ***********************************************************************/
+static void addRow(vector<pyramidLevel>& levels, size_t k, const pixel* const planes[3],
+    int cols, bool ascii)
+{
+    pyramidLevel& level = levels[k];
+    pixel* out[3];
+    int c;
+
+    if (!level.waiting)
+    {
+        for (c = 0; c < 3; c++)
+        {
+            memcpy(level.above[c].data(), planes[c], cols);
+        }
+        level.waiting = true;
+        return;
+    }
+
+    out[0] = level.strip.redGray[level.filled];
+    out[1] = level.strip.green[level.filled];
+    out[2] = level.strip.blue[level.filled];
+    for (c = 0; c < 3; c++)
+    {
+        halveRow(level.above[c].data(), planes[c], out[c], cols);
+    }
+    level.waiting = false;
+    level.filled++;
+
+    if (k + 1 < levels.size())
+    {
+        addRow(levels, k + 1, out, level.cols, ascii);
+    }
+    if (level.filled == PYRAMID_STRIP)
+    {
+        flushStrip(level, ascii);
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function reads a pyramid option, --pyramid for levels until the
+ * image is a single pixel or --pyramid=LEVELS for at most LEVELS levels.
+ *
+ * @param[in] option - the option string
+ * @param[out] levels - the most levels, 0 for no limit
+ *
+ * @returns true - if the option is a valid pyramid
+ *
+ * @par Example:
+   @verbatim
+
+   int levels;
+   parsePyramid("--pyramid=4", levels);
+   //levels is 4
+
+   @endverbatim
+
+ ***********************************************************************/
+bool parsePyramid(string option, int& levels)
+{
+    char* end;
+    long value;
+
+    if (option == "--pyramid")
+    {
+        levels = 0;
+        return true;
+    }
+    if (option.compare(0, 10, "--pyramid=") != 0)
+    {
+        return false;
+    }
+    value = strtol(option.c_str() + 10, &end, 10);
+    if (end == option.c_str() + 10 || *end != '\0' || value < 1 ||
+        value > PYRAMID_MAX_LEVELS)
+    {
+        return false;
+    }
+    levels = int(value);
+    return true;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function writes a image pyramid in one pass over the input. Level
+ * k is the image shrunk k times by halves and is written to
+ * basename_k.ppm, every pixel is the rounded average of a 2 X 2 block of
+ * the level above, and an odd last row or column is averaged with
+ * itself. The input is read a row at a time and every row goes down the
+ * levels as far as it finishes rows, so the full image is never stored.
+ * The memory is a few rows of every level, which is about 2 rows of the
+ * input in all, and the levels are written while the input is read.
+ * Without a limit the levels go on until the image is one pixel.
+ *
+ * @param[in] option - --pyramid or --pyramid=LEVELS
+ * @param[in] type - --binary or --ascii
+ * @param[in] basename - the name of the outputs without the level
+ * @param[in] input - the path of the input image
+ *
+ * @par Example:
+   @verbatim
+
+   runPyramid("--pyramid=3", "--binary", "tiles", "image.ppm");
+   //a 800 X 600 image gives tiles_1.ppm at 400 X 300, tiles_2.ppm at
+   //200 X 150 and tiles_3.ppm at 100 X 75
+
+   @endverbatim
+
+ ***********************************************************************/
+void runPyramid(string option, string type, string basename, string input)
+{
+    ifstream fin;
+    image img{};
+    int maxPixel, limit, count, rows, cols, c;
+    size_t k;
+    bool ascii = type == "--ascii";
+    vector<pixel> planes[3];
+
+    if (!parsePyramid(option, limit) || (type != "--binary" && type != "--ascii"))
+    {
+        throw invalid_argument("Invalid pyramid: " + option + " " + type);
+    }
+
+    isBinFileOpen(input, fin);
+    readHeader(fin, img, maxPixel);
+
+    //halve until a single pixel, or until the limit
+    count = 0;
+    rows = img.rows;
+    cols = img.cols;
+    while ((rows > 1 || cols > 1) && (limit == 0 || count < limit))
+    {
+        rows = (rows + 1) / 2;
+        cols = (cols + 1) / 2;
+        count++;
+    }
+
+    vector<pyramidLevel> levels(count);
+    rows = img.rows;
+    cols = img.cols;
+    try
+    {
+        for (k = 0; k < levels.size(); k++)
+        {
+            //the row waiting is as wide as the level above
+            for (c = 0; c < 3; c++)
+            {
+                levels[k].above[c].resize(cols);
+            }
+            rows = (rows + 1) / 2;
+            cols = (cols + 1) / 2;
+            levels[k].rows = rows;
+            levels[k].cols = cols;
+            levels[k].waiting = false;
+            levels[k].filled = 0;
+            levels[k].strip = img;
+            levels[k].strip.rows = PYRAMID_STRIP;
+            levels[k].strip.cols = cols;
+            levels[k].strip.redGray = createArrays(PYRAMID_STRIP, cols);
+            levels[k].strip.green = createArrays(PYRAMID_STRIP, cols);
+            levels[k].strip.blue = createArrays(PYRAMID_STRIP, cols);
+
+            isBinOutputOpen(basename + "_" + to_string(k + 1) + ".ppm", levels[k].fout);
+            levels[k].strip.rows = rows;
+            writeHeader(levels[k].fout, ascii ? "P3" : "P6", levels[k].strip, maxPixel);
+            levels[k].strip.rows = PYRAMID_STRIP;
+        }
+
+        for (c = 0; c < 3; c++)
+        {
+            planes[c].resize(img.cols);
+        }
+
+        readRows(fin, img.magicNumber, img.rows, img.cols, img.depth,
+            [&](const pixel* row, int)
+        {
+            const pixel* split[3] = { planes[0].data(), planes[1].data(), planes[2].data() };
+            int j;
+
+            for (j = 0; j < img.cols; j++)
+            {
+                planes[0][j] = row[j * 3];
+                planes[1][j] = row[j * 3 + 1];
+                planes[2][j] = row[j * 3 + 2];
+            }
+            if (!levels.empty())
+            {
+                addRow(levels, 0, split, img.cols, ascii);
+            }
+        });
+        //the QOI decoder reads ahead and checks its own data
+        if (!fin && img.magicNumber != "qoif")
+        {
+            throw runtime_error("The image data is cut short");
+        }
+
+        //an odd number of rows leaves a row waiting, it is paired with
+        //itself from the top level down so its row reaches the next level
+        for (k = 0; k < levels.size(); k++)
+        {
+            if (levels[k].waiting)
+            {
+                const pixel* last[3] = { levels[k].above[0].data(),
+                    levels[k].above[1].data(), levels[k].above[2].data() };
+                addRow(levels, k, last, int(levels[k].above[0].size()), ascii);
+            }
+            flushStrip(levels[k], ascii);
+        }
+    }
+    catch (...)
+    {
+        for (k = 0; k < levels.size(); k++)
+        {
+            clearArray(levels[k].strip.redGray, PYRAMID_STRIP);
+            clearArray(levels[k].strip.green, PYRAMID_STRIP);
+            clearArray(levels[k].strip.blue, PYRAMID_STRIP);
+        }
+        throw;
+    }
+
+    for (k = 0; k < levels.size(); k++)
+    {
+        clearArray(levels[k].strip.redGray, PYRAMID_STRIP);
+        clearArray(levels[k].strip.green, PYRAMID_STRIP);
+        clearArray(levels[k].strip.blue, PYRAMID_STRIP);
+        levels[k].fout.close();
+    }
+}
@@ -0,0 +1,664 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Palette quantization with median cut and k-means, and
+ *          Floyd-Steinberg dithering done on many rows at once
+ ***********************************************************************/
+#include "netPBM.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+/************************************************************************
+ *             Constants
+ ***********************************************************************/
+ /*!
+  * @brief the most pixels the palette is built from
+  */
+const int QUANTIZE_SAMPLES = 1 << 16;
+
+/*!
+ * @brief rounds of k-means after median cut
+ */
+const int QUANTIZE_ROUNDS = 8;
+
+/*!
+ * @brief bits of each value used to index the nearest color table
+ */
+const int QUANTIZE_LUT_BITS = 5;
+
+/*!
+ * @brief columns a row of the dither finishes before telling the row
+ *        below
+ */
+const int DITHER_STEP = 32;
+
+
+/************************************************************************
+ *             Structure
+ ***********************************************************************/
+ /**
+ * @brief The levels or palette an image is quantized to and how to find
+ *        the nearest one
+ */
+struct quantizeTable
+{
+    /**
+    * @brief gray, rgb, kmeans or mediancut
+    */
+    string mode;
+    /**
+    * @brief the number of levels of gray or of each of red, green and
+    *        blue, or the number of colors of the palette
+    */
+    int levels;
+    /**
+    * @brief number of values a pixel has, 1 for gray and 3 for color
+    */
+    int channels;
+    /**
+    * @brief true for gray and rgb, where the levels are evenly spaced
+    */
+    bool even;
+    /**
+    * @brief the palette, red, green and blue of each color
+    */
+    vector<int> palette;
+    /**
+    * @brief the nearest color of the palette for each cell of the color
+    *        cube, QUANTIZE_LUT_BITS bits of each value
+    */
+    vector<unsigned char> lut;
+
+    /**
+    * @brief finds the level or color nearest to value. stored gets what
+    *        is put in the image, a level for gray and rgb, and shown the
+    *        0 to 255 values it stands for
+    */
+    inline void pick(const int* value, int* stored, int* shown) const
+    {
+        int c, index;
+
+        if (even)
+        {
+            for (c = 0; c < channels; c++)
+            {
+                stored[c] = (value[c] * (levels - 1) + 127) / 255;
+                shown[c] = stored[c] * 255 / (levels - 1);
+            }
+            return;
+        }
+
+        index = lut[((value[0] >> (8 - QUANTIZE_LUT_BITS)) << (2 * QUANTIZE_LUT_BITS)) |
+            ((value[1] >> (8 - QUANTIZE_LUT_BITS)) << QUANTIZE_LUT_BITS) |
+            (value[2] >> (8 - QUANTIZE_LUT_BITS))];
+        for (c = 0; c < 3; c++)
+        {
+            stored[c] = shown[c] = palette[index * 3 + c];
+        }
+    }
+};
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function builds a palette with median cut. The box of samples
+ * with the widest range in red, green or blue is split at its median in
+ * that value, again and again until there are colors boxes or no box can
+ * be split. Each color of the palette is the average of its box.
+ *
+ * @param[in, out] samples - red, green and blue of each sample, reordered
+ * @param[in] colors - the most colors of the palette
+ * @param[out] palette - red, green and blue of each color
+ *
+ * @par Example:
+   @verbatim
+
+   vector<int> palette;
+   medianCut(samples, 16, palette);
+
+   @endverbatim
+
+ ***********************************************************************/
+static void medianCut(vector<pixel>& samples, int colors, vector<int>& palette)
+{
+    vector<pair<size_t, size_t>> boxes(1, make_pair(size_t(0), samples.size() / 3));
+    size_t b, k, best, first, last, middle;
+    int c, channel = 0, widest, range, low[3], high[3];
+    long long sum[3];
+    vector<size_t> order;
+    vector<pixel> sorted;
+
+    while (int(boxes.size()) < colors)
+    {
+        //the box with the widest range
+        widest = 0;
+        best = 0;
+        for (b = 0; b < boxes.size(); b++)
+        {
+            fill(low, low + 3, 255);
+            fill(high, high + 3, 0);
+            for (k = boxes[b].first; k < boxes[b].second; k++)
+            {
+                for (c = 0; c < 3; c++)
+                {
+                    low[c] = min(low[c], int(samples[k * 3 + c]));
+                    high[c] = max(high[c], int(samples[k * 3 + c]));
+                }
+            }
+            for (c = 0; c < 3; c++)
+            {
+                range = high[c] - low[c];
+                if (range > widest)
+                {
+                    widest = range;
+                    best = b;
+                    channel = c;
+                }
+            }
+        }
+        if (widest == 0)
+        {
+            break;
+        }
+
+        //sort the box by that value and split it in half
+        first = boxes[best].first;
+        last = boxes[best].second;
+        order.resize(last - first);
+        for (k = 0; k < order.size(); k++)
+        {
+            order[k] = first + k;
+        }
+        middle = order.size() / 2;
+        nth_element(order.begin(), order.begin() + middle, order.end(), [&](size_t a, size_t z)
+        {
+            return samples[a * 3 + channel] < samples[z * 3 + channel];
+        });
+        sorted.resize(order.size() * 3);
+        for (k = 0; k < order.size(); k++)
+        {
+            copy(&samples[order[k] * 3], &samples[order[k] * 3] + 3, &sorted[k * 3]);
+        }
+        copy(sorted.begin(), sorted.end(), samples.begin() + first * 3);
+
+        boxes[best].second = first + middle;
+        boxes.push_back(make_pair(first + middle, last));
+    }
+
+    palette.clear();
+    for (b = 0; b < boxes.size(); b++)
+    {
+        fill(sum, sum + 3, 0);
+        for (k = boxes[b].first; k < boxes[b].second; k++)
+        {
+            for (c = 0; c < 3; c++)
+            {
+                sum[c] += samples[k * 3 + c];
+            }
+        }
+        for (c = 0; c < 3; c++)
+        {
+            palette.push_back(int((sum[c] + (boxes[b].second - boxes[b].first) / 2) /
+                max<size_t>(boxes[b].second - boxes[b].first, 1)));
+        }
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function gives the index of the color of the palette nearest to
+ * a color, by the sum of the squared differences.
+ *
+ * @param[in] palette - red, green and blue of each color
+ * @param[in] red - the red value
+ * @param[in] green - the green value
+ * @param[in] blue - the blue value
+ *
+ * @returns the index of the nearest color
+ *
+ * @par Example:
+   @verbatim
+
+   int index = nearestColor(palette, 200, 30, 30);
+
+   @endverbatim
+
+ ***********************************************************************/
+static int nearestColor(const vector<int>& palette, int red, int green, int blue)
+{
+    int k, dr, dg, db, distance, best = 0, bestDistance = 1 << 30;
+
+    for (k = 0; k < int(palette.size()) / 3; k++)
+    {
+        dr = red - palette[k * 3];
+        dg = green - palette[k * 3 + 1];
+        db = blue - palette[k * 3 + 2];
+        distance = dr * dr + dg * dg + db * db;
+        if (distance < bestDistance)
+        {
+            bestDistance = distance;
+            best = k;
+        }
+    }
+    return best;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function improves a palette with rounds of k-means. Every sample
+ * goes to its nearest color and every color moves to the average of its
+ * samples. The samples are split across threads, each thread adds up
+ * its own sums and they are joined under a lock. A color with no samples
+ * stays where it is.
+ *
+ * @param[in] samples - red, green and blue of each sample
+ * @param[in, out] palette - red, green and blue of each color
+ *
+ * @par Example:
+   @verbatim
+
+   medianCut(samples, 16, palette);
+   kMeans(samples, palette);
+
+   @endverbatim
+
+ ***********************************************************************/
+static void kMeans(const vector<pixel>& samples, vector<int>& palette)
+{
+    int round, k, c, colors = int(palette.size()) / 3;
+    int count = int(samples.size() / 3);
+    vector<long long> sums;
+    vector<long long> members;
+    mutex lock;
+
+    for (round = 0; round < QUANTIZE_ROUNDS; round++)
+    {
+        sums.assign(palette.size(), 0);
+        members.assign(size_t(colors), 0);
+
+        parallelFor(count, [&](int first, int last)
+        {
+            vector<long long> partSums(palette.size(), 0), partMembers(size_t(colors), 0);
+            int i, index, value;
+
+            for (i = first; i < last; i++)
+            {
+                index = nearestColor(palette, samples[i * 3], samples[i * 3 + 1],
+                    samples[i * 3 + 2]);
+                for (value = 0; value < 3; value++)
+                {
+                    partSums[index * 3 + value] += samples[i * 3 + value];
+                }
+                partMembers[index]++;
+            }
+
+            lock_guard<mutex> guard(lock);
+            for (i = 0; i < int(palette.size()); i++)
+            {
+                sums[i] += partSums[i];
+            }
+            for (i = 0; i < colors; i++)
+            {
+                members[i] += partMembers[i];
+            }
+        });
+
+        for (k = 0; k < colors; k++)
+        {
+            for (c = 0; c < 3 && members[k] > 0; c++)
+            {
+                palette[k * 3 + c] = int((sums[k * 3 + c] + members[k] / 2) / members[k]);
+            }
+        }
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function builds the palette of the image. Up to QUANTIZE_SAMPLES
+ * pixels spread evenly over the image are taken, median cut makes the
+ * first palette and for kmeans rounds of k-means improve it. Then the
+ * nearest color of the palette is found for the middle of every cell of
+ * the color cube, split across threads, so a pixel finds its color with
+ * one look up.
+ *
+ * @param[in] img - the image
+ * @param[in, out] table - the mode and levels, gets the palette and table
+ *
+ * @par Example:
+   @verbatim
+
+   quantizeTable table;
+   table.mode = "kmeans";
+   table.levels = 16;
+   table.channels = 3;
+   table.even = false;
+   buildPalette(img, table);
+
+   @endverbatim
+
+ ***********************************************************************/
+static void buildPalette(const image& img, quantizeTable& table)
+{
+    long long total = (long long)img.rows * img.cols, at, step;
+    int i, j, cells = 1 << QUANTIZE_LUT_BITS;
+    vector<pixel> samples;
+
+    step = max(1LL, (total + QUANTIZE_SAMPLES - 1) / QUANTIZE_SAMPLES);
+    for (at = 0; at < total; at += step)
+    {
+        i = int(at / img.cols);
+        j = int(at % img.cols);
+        samples.push_back(img.redGray[i][j]);
+        samples.push_back(img.green[i][j]);
+        samples.push_back(img.blue[i][j]);
+    }
+
+    medianCut(samples, table.levels, table.palette);
+    if (table.mode == "kmeans")
+    {
+        kMeans(samples, table.palette);
+    }
+
+    table.lut.resize(size_t(cells) * cells * cells);
+    parallelFor(cells * cells, [&](int first, int last)
+    {
+        int k, b, half = 1 << (7 - QUANTIZE_LUT_BITS);
+        for (k = first; k < last; k++)
+        {
+            for (b = 0; b < cells; b++)
+            {
+                table.lut[size_t(k) * cells + b] = (unsigned char)nearestColor(table.palette,
+                    ((k / cells) << (8 - QUANTIZE_LUT_BITS)) + half,
+                    ((k % cells) << (8 - QUANTIZE_LUT_BITS)) + half,
+                    (b << (8 - QUANTIZE_LUT_BITS)) + half);
+            }
+        }
+    });
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function quantizes one row, with Floyd-Steinberg dithering when
+ * the error rows are given. The error of a pixel goes 7/16 to the pixel
+ * on its right, and 3/16, 5/16 and 1/16 to the three pixels below it.
+ * The errors are kept 16 times larger so they stay whole numbers. The
+ * image gets the stored values, the same value in the three arrays for
+ * gray.
+ *
+ * @param[in, out] img - the image
+ * @param[in] table - the levels or palette
+ * @param[in] i - the row
+ * @param[in] first - the first column
+ * @param[in] last - one past the last column
+ * @param[in, out] carry - the error going right, 16 times larger
+ * @param[in] incoming - the error from the row above for each column,
+ *                       starting one column to the left, or nullptr
+ * @param[in, out] outgoing - the error for the row below, the same way
+ *
+ * @par Example:
+   @verbatim
+
+   int carry[3] = { 0, 0, 0 };
+   quantizeRow(img, table, 0, 0, img.cols, carry, nullptr, nullptr);
+
+   @endverbatim
+
+ ***********************************************************************/
+static void quantizeRow(image& img, const quantizeTable& table, int i, int first, int last,
+    int* carry, const int* incoming, int* outgoing)
+{
+    int j, c, error, channels = table.channels;
+    int value[3], stored[3], shown[3];
+    pixel* red = img.redGray[i];
+    pixel* green = img.green[i];
+    pixel* blue = img.blue[i];
+
+    for (j = first; j < last; j++)
+    {
+        if (channels == 1)
+        {
+            value[0] = int(0.3 * red[j] + 0.6 * green[j] + 0.1 * blue[j]);
+        }
+        else
+        {
+            value[0] = red[j];
+            value[1] = green[j];
+            value[2] = blue[j];
+        }
+
+        if (incoming != nullptr)
+        {
+            for (c = 0; c < channels; c++)
+            {
+                value[c] += (incoming[(j + 1) * channels + c] + carry[c]) / 16;
+                value[c] = value[c] < 0 ? 0 : (value[c] > 255 ? 255 : value[c]);
+            }
+        }
+
+        table.pick(value, stored, shown);
+
+        if (incoming != nullptr)
+        {
+            for (c = 0; c < channels; c++)
+            {
+                error = value[c] - shown[c];
+                carry[c] = error * 7;
+                outgoing[j * channels + c] += error * 3;
+                outgoing[(j + 1) * channels + c] += error * 5;
+                outgoing[(j + 2) * channels + c] += error;
+            }
+        }
+
+        red[j] = pixel(stored[0]);
+        green[j] = pixel(stored[channels == 1 ? 0 : 1]);
+        blue[j] = pixel(stored[channels == 1 ? 0 : 2]);
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function quantizes the image to a few levels or colors. gray
+ * gives levels of gray, rgb gives levels of each of red, green and blue,
+ * and the image holds the level numbers so it is written with a maxPixel
+ * of levels - 1. kmeans and mediancut build a palette of the colors of
+ * the image and the image holds the colors.
+ *
+ * Floyd-Steinberg dithering needs the pixel on the left and the three
+ * pixels above to be done first, so the rows run as a wavefront. Every
+ * thread takes the next row that is free and follows the row above it,
+ * two columns behind. The rows are handed out in order so a row only
+ * waits for rows that are being worked on, and the errors live in a ring
+ * of rows, one more than twice the threads, instead of a whole array.
+ * Without dithering every row is done on its own.
+ *
+ * @param[in, out] img - the structure where the data of the image is stored
+ * @param[in] mode - gray, rgb, kmeans or mediancut
+ * @param[in] levels - the number of levels or colors, 2 to 256
+ * @param[in] dither - true for Floyd-Steinberg dithering
+ *
+ * @par Example:
+   @verbatim
+
+   quantizeImage(img, "gray", 16, true);
+   //img holds 16 levels of gray for an e-ink screen
+
+   @endverbatim
+
+ ***********************************************************************/
+void quantizeImage(image& img, string mode, int levels, bool dither)
+{
+    quantizeTable table;
+    int ring, channels;
+    vector<int> errors;
+    vector<atomic<int>> progress;
+    atomic<int> next(0);
+
+    table.mode = mode;
+    table.levels = levels;
+    table.channels = channels = mode == "gray" ? 1 : 3;
+    table.even = mode == "gray" || mode == "rgb";
+    if (mode == "kmeans" || mode == "mediancut")
+    {
+        buildPalette(img, table);
+    }
+
+    //every pixel is changed where it is
+    unshareImage(img);
+
+    if (!dither)
+    {
+        parallelFor(img.rows, [&](int first, int last)
+        {
+            int carry[3] = { 0, 0, 0 };
+            for (int i = first; i < last; i++)
+            {
+                quantizeRow(img, table, i, 0, img.cols, carry, nullptr, nullptr);
+            }
+        });
+        return;
+    }
+
+    //the error rows, each with a column of room on both sides
+    ring = 2 * threadCount() + 1;
+    errors.assign(size_t(ring) * (img.cols + 2) * channels, 0);
+    progress = vector<atomic<int>>(size_t(img.rows));
+    for (atomic<int>& done : progress)
+    {
+        done.store(0);
+    }
+
+    parallelFor(threadCount(), [&](int, int)
+    {
+        int i, j, end, need;
+        int carry[3];
+        size_t width = size_t(img.cols + 2) * channels;
+
+        //the next free row, rows are handed out in order
+        while ((i = next++) < img.rows)
+        {
+            int* incoming = &errors[size_t(i % ring) * width];
+            int* outgoing = &errors[size_t((i + 1) % ring) * width];
+
+            //the ring row for the row below was last used ring rows ago
+            if (i + 1 >= ring)
+            {
+                while (progress[i + 1 - ring].load(memory_order_acquire) < img.cols)
+                {
+                    this_thread::yield();
+                }
+            }
+            fill(outgoing, outgoing + width, 0);
+            fill(carry, carry + 3, 0);
+
+            for (j = 0; j < img.cols; j = end)
+            {
+                end = min(j + DITHER_STEP, img.cols);
+
+                //the row above has given its error to these columns
+                need = min(end + 1, img.cols);
+                while (i > 0 && progress[i - 1].load(memory_order_acquire) < need)
+                {
+                    this_thread::yield();
+                }
+
+                quantizeRow(img, table, i, j, end, carry, incoming, outgoing);
+                progress[i].store(end, memory_order_release);
+            }
+        }
+    });
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function reads a quantize option. The option looks like
+ * --quantize=N, --quantize=grayN or --quantize=rgbN. N alone is a palette
+ * of N colors built with kmeans, or with mediancut when :mediancut comes
+ * after it. grayN is N levels of gray and rgbN N levels of each of red,
+ * green and blue. :nodither at the end turns dithering off.
+ *
+ * @param[in] option - the full option string
+ * @param[out] mode - gray, rgb, kmeans or mediancut
+ * @param[out] levels - the number of levels or colors
+ * @param[out] dither - false when :nodither is given
+ *
+ * @returns true - if the option is valid
+ *
+ * @par Example:
+   @verbatim
+
+   string mode;
+   int levels;
+   bool dither;
+
+   bool valid = parseQuantize("--quantize=gray16", mode, levels, dither);
+   //mode is gray, levels is 16 and dither is true
+
+   @endverbatim
+
+ ***********************************************************************/
+bool parseQuantize(string option, string& mode, int& levels, bool& dither)
+{
+    string value = option.substr(option.find('=') + 1);
+    string number, flag;
+    size_t colon = value.find(':');
+
+    number = value.substr(0, colon);
+    value = colon == string::npos ? "" : value.substr(colon + 1);
+    dither = true;
+    mode = "kmeans";
+
+    if (number.compare(0, 4, "gray") == 0 || number.compare(0, 3, "rgb") == 0)
+    {
+        mode = number[0] == 'g' ? "gray" : "rgb";
+        number = number.substr(mode.size());
+    }
+
+    //the flags after the number
+    while (value != "")
+    {
+        colon = value.find(':');
+        flag = value.substr(0, colon);
+        value = colon == string::npos ? "" : value.substr(colon + 1);
+        if (flag == "nodither")
+        {
+            dither = false;
+        }
+        else if ((flag == "kmeans" || flag == "mediancut") && mode != "gray" && mode != "rgb")
+        {
+            mode = flag;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    if (number == "" || number.find_first_not_of("0123456789") != string::npos)
+    {
+        return false;
+    }
+    levels = atoi(number.c_str());
+    return levels >= 2 && levels <= 256;
+}
@@ -0,0 +1,436 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Resize operation with box, bilinear and lanczos filters
+ ***********************************************************************/
+#include "netPBM.h"
+#include <cmath>
+
+/************************************************************************
+ *             Constants
+ ***********************************************************************/
+ /*!
+  * @brief number of fraction bits in the fixed point filter weights
+  */
+const int WEIGHT_BITS = 14;
+
+/*!
+ * @brief value of a weight of 1.0 in fixed point
+ */
+const int WEIGHT_ONE = 1 << WEIGHT_BITS;
+
+/*!
+ * @brief value of pi for the lanczos filter
+ */
+const double PI = 3.14159265358979323846;
+
+
+/************************************************************************
+ *             Structure
+ ***********************************************************************/
+ /**
+ * @brief Holds the filter taps for every output position along one axis
+ */
+struct resizeWeights
+{
+    /**
+    * @brief the first input position used by each output position
+    */
+    vector<int> start;
+    /**
+    * @brief the number of input positions used by each output position
+    */
+    vector<int> count;
+    /**
+    * @brief the fixed point weights, taps entries for each output position
+    */
+    vector<int> weights;
+    /**
+    * @brief the largest number of taps of any output position
+    */
+    int taps;
+};
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function returns the value of the named filter at distance x from
+ * the center of the filter and the distance at which the filter becomes
+ * zero. Box averages the area, bilinear is a triangle and lanczos is a
+ * windowed sinc using three lobes.
+ *
+ * @param[in] filter - the name of the filter, box, bilinear or lanczos
+ * @param[in] x - the distance from the center
+ * @param[out] support - the distance after which the filter is zero
+ *
+ * @returns the weight of the filter at x
+ *
+ * @par Example:
+   @verbatim
+
+   double support;
+   double w = filterValue("bilinear", 0.5, support);
+   //w is 0.5 and support is 1
+
+   @endverbatim
+
+ ***********************************************************************/
+static double filterValue(const string& filter, double x, double& support)
+{
+    x = fabs(x);
+
+    if (filter == "box")
+    {
+        support = 0.5;
+        return x <= 0.5 ? 1.0 : 0.0;
+    }
+
+    if (filter == "bilinear")
+    {
+        support = 1.0;
+        return x < 1.0 ? 1.0 - x : 0.0;
+    }
+
+    //lanczos with 3 lobes
+    support = 3.0;
+    if (x < 1e-8)
+    {
+        return 1.0;
+    }
+    if (x >= 3.0)
+    {
+        return 0.0;
+    }
+    return 3.0 * sin(PI * x) * sin(PI * x / 3.0) / (PI * PI * x * x);
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function works out which input positions and weights make up
+ * every output position along one axis. When shrinking, the filter is
+ * stretched by the scale so every input pixel adds to the output. The
+ * weights are normalized and turned into fixed point numbers that add up
+ * to exactly WEIGHT_ONE so a flat image stays flat.
+ *
+ * @param[in] inSize - the number of input pixels along the axis
+ * @param[in] outSize - the number of output pixels along the axis
+ * @param[in] filter - the name of the filter
+ *
+ * @returns the taps of every output position
+ *
+ * @par Example:
+   @verbatim
+
+   resizeWeights w = computeWeights(640, 320, "box");
+   //every output column uses two input columns with half weight each
+
+   @endverbatim
+
+ ***********************************************************************/
+static resizeWeights computeWeights(int inSize, int outSize, const string& filter)
+{
+    int i, k, first, last, total, largest;
+    double scale = double(inSize) / outSize;
+    double stretch = max(scale, 1.0);
+    double support, center, sum;
+    vector<double> values;
+    resizeWeights w;
+
+    //ask the filter how wide it is
+    filterValue(filter, 0.0, support);
+    support *= stretch;
+
+    w.taps = int(ceil(support)) * 2 + 1;
+    w.start.resize(outSize);
+    w.count.resize(outSize);
+    w.weights.assign(size_t(outSize) * w.taps, 0);
+    values.resize(w.taps);
+
+    for (i = 0; i < outSize; i++)
+    {
+        //center of the output pixel in input coordinates
+        center = (i + 0.5) * scale;
+        first = max(int(floor(center - support)), 0);
+        last = min(int(ceil(center + support)), inSize);
+        if (last - first > w.taps)
+        {
+            last = first + w.taps;
+        }
+
+        //weight of every input pixel the filter covers
+        sum = 0.0;
+        for (k = first; k < last; k++)
+        {
+            values[k - first] = filterValue(filter, (k + 0.5 - center) / stretch, support);
+            sum += values[k - first];
+        }
+
+        //nothing covered, fall back to the nearest pixel
+        if (sum <= 0.0)
+        {
+            first = min(max(int(center), 0), inSize - 1);
+            last = first + 1;
+            values[0] = 1.0;
+            sum = 1.0;
+        }
+
+        //convert to fixed point, the largest weight takes the rounding error
+        total = 0;
+        largest = 0;
+        for (k = 0; k < last - first; k++)
+        {
+            w.weights[size_t(i) * w.taps + k] = int(lround(values[k] / sum * WEIGHT_ONE));
+            total += w.weights[size_t(i) * w.taps + k];
+            if (w.weights[size_t(i) * w.taps + k] > w.weights[size_t(i) * w.taps + largest])
+            {
+                largest = k;
+            }
+        }
+        w.weights[size_t(i) * w.taps + largest] += WEIGHT_ONE - total;
+
+        w.start[i] = first;
+        w.count[i] = last - first;
+    }
+
+    return w;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function rounds a fixed point sum back to a pixel and keeps it
+ * between 0 and 255. Lanczos has negative lobes so the sum can go
+ * outside of that range.
+ *
+ * @param[in] sum - the fixed point sum
+ *
+ * @returns the sum as a pixel
+ *
+ * @par Example:
+   @verbatim
+
+   pixel p = clampWeighted(128 << WEIGHT_BITS);
+   //p is 128
+
+   @endverbatim
+
+ ***********************************************************************/
+static inline pixel clampWeighted(int sum)
+{
+    sum = (sum + WEIGHT_ONE / 2) >> WEIGHT_BITS;
+    return pixel(sum < 0 ? 0 : (sum > 255 ? 255 : sum));
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function resizes one 2D array. The filter is separable so it is
+ * done as two passes. The horizontal pass filters every row into a
+ * temporary array with the new number of columns. The vertical pass
+ * then adds whole rows of the temporary array into a row of sums, which
+ * walks memory in order and lets the compiler vectorize the inner loop.
+ * Both passes split their rows across threads.
+ *
+ * @param[in] array - the array to resize
+ * @param[in] rows - the rows of the array
+ * @param[in] wRows - the taps along the rows
+ * @param[in] wCols - the taps along the columns
+ *
+ * @returns a new array with wRows.start.size() rows and
+ *          wCols.start.size() columns
+ *
+ * @par Example:
+   @verbatim
+
+   pixel** small = resizePlane(img.redGray, img.rows, wRows, wCols);
+
+   @endverbatim
+
+ ***********************************************************************/
+static pixel** resizePlane(pixel** array, int rows,
+    const resizeWeights& wRows, const resizeWeights& wCols)
+{
+    int newRows = int(wRows.start.size());
+    int newCols = int(wCols.start.size());
+    pixel** temp = createArrays(rows, newCols);
+    pixel** result = createArrays(newRows, newCols);
+
+    //horizontal pass, each thread filters its own rows
+    parallelFor(rows, [&](int first, int last)
+    {
+        int i, j, k, sum;
+        const int* w;
+        const pixel* in;
+
+        for (i = first; i < last; i++)
+        {
+            for (j = 0; j < newCols; j++)
+            {
+                w = &wCols.weights[size_t(j) * wCols.taps];
+                in = array[i] + wCols.start[j];
+                sum = 0;
+                for (k = 0; k < wCols.count[j]; k++)
+                {
+                    sum += w[k] * in[k];
+                }
+                temp[i][j] = clampWeighted(sum);
+            }
+        }
+    });
+
+    //vertical pass, each output row adds up whole rows of the temp array
+    parallelFor(newRows, [&](int first, int last)
+    {
+        int i, j, k, w;
+        const pixel* in;
+        vector<int> sums(newCols);
+
+        for (i = first; i < last; i++)
+        {
+            fill(sums.begin(), sums.end(), 0);
+            for (k = 0; k < wRows.count[i]; k++)
+            {
+                w = wRows.weights[size_t(i) * wRows.taps + k];
+                in = temp[wRows.start[i] + k];
+                for (j = 0; j < newCols; j++)
+                {
+                    sums[j] += w * in[j];
+                }
+            }
+            for (j = 0; j < newCols; j++)
+            {
+                result[i][j] = clampWeighted(sums[j]);
+            }
+        }
+    });
+
+    clearArray(temp, rows);
+    return result;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function resizes the image to the given size using the given
+ * filter. The filter can be box, bilinear or lanczos. The taps are
+ * worked out once for the rows and once for the columns and are shared
+ * by all three arrays. The original arrays are cleared and replaced by
+ * the resized ones.
+ *
+ * @param[in, out] img - the structure where the data of the image is stored
+ * @param[in] newRows - the number of rows wanted
+ * @param[in] newCols - the number of columns wanted
+ * @param[in] filter - box, bilinear or lanczos
+ *
+ * @par Example:
+   @verbatim
+
+   image img;
+   //consider img is a 640 X 480 image
+
+   resizeImage(img, 240, 320, "lanczos");
+   //img is now a 320 X 240 image
+
+   @endverbatim
+
+ ***********************************************************************/
+void resizeImage(image& img, int newRows, int newCols, string filter)
+{
+    pixel** tempRedGray;
+    pixel** tempGreen;
+    pixel** tempBlue;
+    resizeWeights wRows, wCols;
+
+    //check the size and the filter name
+    if (newRows < 1 || newCols < 1 ||
+        (filter != "box" && filter != "bilinear" && filter != "lanczos"))
+    {
+        throw invalid_argument("Invalid option values");
+    }
+
+    //the taps are the same for every array
+    wRows = computeWeights(img.rows, newRows, filter);
+    wCols = computeWeights(img.cols, newCols, filter);
+
+    tempRedGray = resizePlane(img.redGray, img.rows, wRows, wCols);
+    tempGreen = resizePlane(img.green, img.rows, wRows, wCols);
+    tempBlue = resizePlane(img.blue, img.rows, wRows, wCols);
+
+    //delete all three original arrays
+    clearArray(img.redGray, img.rows);
+    clearArray(img.green, img.rows);
+    clearArray(img.blue, img.rows);
+
+    //the resized arrays become the image
+    img.redGray = tempRedGray;
+    img.green = tempGreen;
+    img.blue = tempBlue;
+    img.rows = newRows;
+    img.cols = newCols;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function reads the size and the filter out of a resize option.
+ * The option looks like --resize=320x240 or --resize=320x240:lanczos,
+ * the columns come first like in the file header. When no filter is
+ * given the box filter is used.
+ *
+ * @param[in] option - the full option string
+ * @param[out] newRows - the number of rows wanted
+ * @param[out] newCols - the number of columns wanted
+ * @param[out] filter - the name of the filter
+ *
+ * @returns true - if the option could be read
+ *
+ * @par Example:
+   @verbatim
+
+   int rows, cols;
+   string filter;
+   parseResize("--resize=320x240:bilinear", rows, cols, filter);
+   //rows is 240, cols is 320, filter is bilinear
+
+   @endverbatim
+
+ ***********************************************************************/
+bool parseResize(string option, int& newRows, int& newCols, string& filter)
+{
+    size_t x, colon;
+    string size = option.substr(option.find('=') + 1);
+
+    //split off the filter name
+    colon = size.find(':');
+    filter = "box";
+    if (colon != string::npos)
+    {
+        filter = size.substr(colon + 1);
+        size = size.substr(0, colon);
+    }
+
+    //split the columns from the rows
+    x = size.find('x');
+    if (x == string::npos || x == 0 || x + 1 >= size.size())
+    {
+        return false;
+    }
+
+    newCols = atoi(size.substr(0, x).c_str());
+    newRows = atoi(size.substr(x + 1).c_str());
+
+    return newRows > 0 && newCols > 0;
+}
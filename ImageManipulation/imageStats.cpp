@@ -0,0 +1,440 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Histogram, statistics, auto levels and equalize operations
+ ***********************************************************************/
+#include "netPBM.h"
+#include <mutex>
+
+/************************************************************************
+ *             Constants
+ ***********************************************************************/
+ /*!
+  * @brief number of sub histograms each thread counts into, so pixels
+  *        next to each other with the same value do not wait on each
+  *        other's increment
+  */
+const int SUB_HISTOGRAMS = 4;
+
+/*!
+ * @brief percent of the pixels clipped at each end by auto levels
+ */
+const double AUTO_LEVELS_CLIP = 0.5;
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function sets every count of the histograms to zero.
+ *
+ * @param[out] stats - the statistics to clear
+ *
+ * @par Example:
+   @verbatim
+
+   imageStats stats;
+   clearStats(stats);
+
+   @endverbatim
+
+ ***********************************************************************/
+void clearStats(imageStats& stats)
+{
+    int c, v;
+
+    for (c = 0; c < 3; c++)
+    {
+        for (v = 0; v < 256; v++)
+        {
+            stats.histogram[c][v] = 0;
+        }
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function adds one interleaved row of pixels to the histograms.
+ * The readers call it on the row they just read so the statistics come
+ * from the read pass without going over the image again.
+ *
+ * @param[in, out] stats - the statistics to add to
+ * @param[in] row - the interleaved row, three values per pixel
+ * @param[in] cols - the number of pixels in the row
+ *
+ * @par Example:
+   @verbatim
+
+   imageStats stats;
+   pixel row[6] = { 1, 2, 3, 1, 2, 3 };
+   clearStats(stats);
+   addRowStats(stats, row, 2);
+   //stats.histogram[0][1] is 2
+
+   @endverbatim
+
+ ***********************************************************************/
+void addRowStats(imageStats& stats, const pixel* row, int cols)
+{
+    int j;
+
+    for (j = 0; j < cols; j++)
+    {
+        stats.histogram[0][row[j * 3]]++;
+        stats.histogram[1][row[j * 3 + 1]]++;
+        stats.histogram[2][row[j * 3 + 2]]++;
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function counts the histograms of all three arrays. The rows are
+ * split across threads and every thread counts into its own histograms,
+ * so there is no sharing while counting. Each thread also keeps
+ * SUB_HISTOGRAMS copies and sends neighboring pixels to different copies,
+ * which stops a run of the same value from waiting on one counter. The
+ * copies are added up and then added to the result under a lock.
+ *
+ * @param[in] img - the structure where the data of the image is stored
+ * @param[out] stats - the statistics of the image
+ *
+ * @par Example:
+   @verbatim
+
+   image img;
+   imageStats stats;
+
+   computeStats(img, stats);
+   //stats.histogram holds the counts of every value in every array
+
+   @endverbatim
+
+ ***********************************************************************/
+void computeStats(image img, imageStats& stats)
+{
+    mutex lock;
+    pixel** planes[3] = { img.redGray, img.green, img.blue };
+
+    clearStats(stats);
+
+    parallelFor(img.rows, [&](int first, int last)
+    {
+        int c, i, j, k, v;
+        const pixel* row;
+        vector<unsigned int> local(SUB_HISTOGRAMS * 256);
+        unsigned int* sub[SUB_HISTOGRAMS];
+
+        for (k = 0; k < SUB_HISTOGRAMS; k++)
+        {
+            sub[k] = &local[k * 256];
+        }
+
+        for (c = 0; c < 3; c++)
+        {
+            fill(local.begin(), local.end(), 0);
+            for (i = first; i < last; i++)
+            {
+                row = planes[c][i];
+
+                //four pixels at a time, each into its own copy
+                for (j = 0; j + 3 < img.cols; j += 4)
+                {
+                    sub[0][row[j]]++;
+                    sub[1][row[j + 1]]++;
+                    sub[2][row[j + 2]]++;
+                    sub[3][row[j + 3]]++;
+                }
+                for (; j < img.cols; j++)
+                {
+                    sub[0][row[j]]++;
+                }
+            }
+
+            //add this thread's counts into the result
+            lock.lock();
+            for (v = 0; v < 256; v++)
+            {
+                for (k = 0; k < SUB_HISTOGRAMS; k++)
+                {
+                    stats.histogram[c][v] += sub[k][v];
+                }
+            }
+            lock.unlock();
+        }
+    });
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function returns the smallest value of an array such that at
+ * least percent of the pixels are at or below it.
+ *
+ * @param[in] stats - the statistics of the image
+ * @param[in] channel - 0, 1 or 2
+ * @param[in] percent - between 0 and 100
+ *
+ * @returns the value at the percentile
+ *
+ * @par Example:
+   @verbatim
+
+   imageStats stats;
+   computeStats(img, stats);
+   int median = statsPercentile(stats, 0, 50.0);
+
+   @endverbatim
+
+ ***********************************************************************/
+int statsPercentile(const imageStats& stats, int channel, double percent)
+{
+    int v;
+    unsigned long long total = 0, count = 0;
+    double wanted;
+
+    for (v = 0; v < 256; v++)
+    {
+        total += stats.histogram[channel][v];
+    }
+
+    wanted = total * percent / 100.0;
+    for (v = 0; v < 255; v++)
+    {
+        count += stats.histogram[channel][v];
+        if (count > 0 && count >= wanted)
+        {
+            return v;
+        }
+    }
+    return 255;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function writes the statistics as JSON. For every array it
+ * writes the min, max, mean, the 1st, 50th and 99th percentile and the
+ * full 256 entry histogram. The min, max and mean all come from the
+ * histogram so they do not need another pass over the image.
+ *
+ * @param[out] out - the stream the JSON is written to
+ * @param[in] stats - the statistics of the image
+ * @param[in] rows - the rows of the image
+ * @param[in] cols - the columns of the image
+ *
+ * @par Example:
+   @verbatim
+
+   imageStats stats;
+   computeStats(img, stats);
+   writeStatsJson(cout, stats, img.rows, img.cols);
+   //{ "rows": 480, "cols": 640, "channels": [ ... ] }
+
+   @endverbatim
+
+ ***********************************************************************/
+void writeStatsJson(ostream& out, const imageStats& stats, int rows, int cols)
+{
+    int c, v, low, high;
+    unsigned long long total;
+    double sum;
+    const char* names[3] = { "red", "green", "blue" };
+
+    out << "{\n";
+    out << "  \"rows\": " << rows << ",\n";
+    out << "  \"cols\": " << cols << ",\n";
+    out << "  \"channels\": [\n";
+
+    for (c = 0; c < 3; c++)
+    {
+        //min, max and mean from the histogram
+        low = 255;
+        high = 0;
+        total = 0;
+        sum = 0.0;
+        for (v = 0; v < 256; v++)
+        {
+            if (stats.histogram[c][v] > 0)
+            {
+                low = min(low, v);
+                high = max(high, v);
+            }
+            total += stats.histogram[c][v];
+            sum += double(v) * stats.histogram[c][v];
+        }
+
+        out << "    {\n";
+        out << "      \"name\": \"" << names[c] << "\",\n";
+        out << "      \"min\": " << (total > 0 ? low : 0) << ",\n";
+        out << "      \"max\": " << high << ",\n";
+        out << "      \"mean\": " << fixed << setprecision(3)
+            << (total > 0 ? sum / total : 0.0) << ",\n";
+        out << "      \"p1\": " << statsPercentile(stats, c, 1.0) << ",\n";
+        out << "      \"p50\": " << statsPercentile(stats, c, 50.0) << ",\n";
+        out << "      \"p99\": " << statsPercentile(stats, c, 99.0) << ",\n";
+        out << "      \"histogram\": [";
+        for (v = 0; v < 256; v++)
+        {
+            out << (v == 0 ? "" : ",") << stats.histogram[c][v];
+        }
+        out << "]\n";
+        out << "    }" << (c < 2 ? "," : "") << "\n";
+    }
+
+    out << "  ]\n";
+    out << "}" << endl;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function turns the histograms into a look up table that
+ * stretches every array so that AUTO_LEVELS_CLIP percent of the pixels
+ * at each end become 0 and 255.
+ *
+ * @param[in] stats - the statistics of the image
+ * @param[out] lut - the look up table
+ *
+ * @par Example:
+   @verbatim
+
+   imageStats stats;
+   pixelLut lut;
+   computeStats(img, stats);
+   autoLevelsLut(stats, lut);
+   applyLut(img, lut);
+
+   @endverbatim
+
+ ***********************************************************************/
+void autoLevelsLut(const imageStats& stats, pixelLut& lut)
+{
+    int c, low, high;
+    pixel map[256];
+
+    lutIdentity(lut);
+    for (c = 0; c < 3; c++)
+    {
+        low = statsPercentile(stats, c, AUTO_LEVELS_CLIP);
+        high = statsPercentile(stats, c, 100.0 - AUTO_LEVELS_CLIP);
+
+        //a flat array is left alone
+        if (high > low)
+        {
+            toneMap("levels", to_string(low) + "-" + to_string(high), map);
+            lutCompose(lut, map, c);
+        }
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function turns the histograms into a look up table that
+ * equalizes every array. Each value is mapped to where it falls in the
+ * running total of the histogram so the values end up spread evenly
+ * between 0 and 255.
+ *
+ * @param[in] stats - the statistics of the image
+ * @param[out] lut - the look up table
+ *
+ * @par Example:
+   @verbatim
+
+   imageStats stats;
+   pixelLut lut;
+   computeStats(img, stats);
+   equalizeLut(stats, lut);
+   applyLut(img, lut);
+
+   @endverbatim
+
+ ***********************************************************************/
+void equalizeLut(const imageStats& stats, pixelLut& lut)
+{
+    int c, v;
+    unsigned long long total, running, first;
+
+    for (c = 0; c < 3; c++)
+    {
+        total = 0;
+        for (v = 0; v < 256; v++)
+        {
+            total += stats.histogram[c][v];
+        }
+
+        //count of the smallest value, it maps to 0
+        first = 0;
+        for (v = 0; v < 256 && first == 0; v++)
+        {
+            first = stats.histogram[c][v];
+        }
+
+        running = 0;
+        for (v = 0; v < 256; v++)
+        {
+            running += stats.histogram[c][v];
+            if (total == first || running <= first)
+            {
+                lut.table[c][v] = total == first ? pixel(v) : 0;
+            }
+            else
+            {
+                lut.table[c][v] = pixel(((running - first) * 255 + (total - first) / 2)
+                    / (total - first));
+            }
+        }
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function opens the file, reads it while counting the histograms
+ * and writes the statistics as JSON to the standard output.
+ *
+ * @param[in] file - the name of the image file
+ *
+ * @par Example:
+   @verbatim
+
+   printStats("image.ppm");
+   //the JSON statistics of image.ppm are printed
+
+   @endverbatim
+
+ ***********************************************************************/
+void printStats(string file)
+{
+    ifstream fin;
+    image img{};
+    int maxPixel;
+    imageStats stats;
+
+    isBinFileOpen(file, fin);
+
+    //the histograms are counted while the rows are read
+    readFile(fin, img, maxPixel, nullptr, &stats);
+    writeStatsJson(cout, stats, img.rows, img.cols);
+
+    clearArray(img.redGray, img.rows);
+    clearArray(img.green, img.rows);
+    clearArray(img.blue, img.rows);
+    fin.close();
+}
@@ -0,0 +1,271 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Streams of P5 and P6 frames from standard input to standard
+ *          output
+ ***********************************************************************/
+#include "pipeline.h"
+#include <iostream>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function tells if the arrays of an image can hold rows X cols
+ * pixels.
+ *
+ * @param[in] img - the arrays
+ * @param[in] allocRows - the rows allocated in the arrays
+ * @param[in] allocCols - the columns allocated in the arrays
+ * @param[in] rows - the rows needed
+ * @param[in] cols - the columns needed
+ *
+ * @returns true - if the arrays are large enough
+ *
+ * @par Example:
+   @verbatim
+
+   if (fits(slot.spare, slot.spareRows, slot.spareCols, 1080, 1920))
+   {
+       //the spare arrays can hold a 1080p frame
+   }
+
+   @endverbatim
+
+ ***********************************************************************/
+static bool fits(const image& img, int allocRows, int allocCols, int rows, int cols)
+{
+    return img.redGray != nullptr && img.green != nullptr && img.blue != nullptr &&
+        rows <= allocRows && cols <= allocCols;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function swaps the arrays of a slot with its spare arrays,
+ * together with the sizes they were allocated with.
+ *
+ * @param[in, out] slot - the slot
+ *
+ * @par Example:
+   @verbatim
+
+   rotateInto(slot.img, slot.spare, true);
+   swapSpare(slot);
+   //slot.img is the turned frame
+
+   @endverbatim
+
+ ***********************************************************************/
+static void swapSpare(pipelineSlot& slot)
+{
+    swap(slot.img, slot.spare);
+    swap(slot.allocRows, slot.spareRows);
+    swap(slot.allocCols, slot.spareCols);
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function runs the option on one frame. A rotation turns the frame
+ * into the spare arrays of the slot and swaps them in, so after the first
+ * frame a rotation allocates no arrays. Every other option runs where the
+ * frame is, and an option that puts new arrays in the frame, like a
+ * resize, has its new size recorded so the arrays are reused correctly.
+ *
+ * @param[in, out] slot - the slot holding the frame
+ * @param[in] option - the image manupulation option, can be empty
+ *
+ * @par Example:
+   @verbatim
+
+   streamFrame(slot, "--rotateCW");
+
+   @endverbatim
+
+ ***********************************************************************/
+static void streamFrame(pipelineSlot& slot, string option)
+{
+    pixel** before = slot.img.redGray;
+    int rows = slot.img.cols, cols = slot.img.rows;
+
+    if (option == "--rotateCW" || option == "--rotateCCW")
+    {
+        if (!fits(slot.spare, slot.spareRows, slot.spareCols, rows, cols))
+        {
+            clearArray(slot.spare.redGray, max(slot.spare.rows, slot.spareRows));
+            clearArray(slot.spare.green, max(slot.spare.rows, slot.spareRows));
+            clearArray(slot.spare.blue, max(slot.spare.rows, slot.spareRows));
+            slot.spare.rows = slot.spare.cols = 0;
+            slot.spareRows = rows;
+            slot.spareCols = cols;
+            slot.spare.redGray = createArrays(rows, cols);
+            slot.spare.green = createArrays(rows, cols);
+            slot.spare.blue = createArrays(rows, cols);
+        }
+        rotateInto(slot.img, slot.spare, option == "--rotateCW");
+        slot.spare.magicNumber = slot.img.magicNumber;
+        slot.spare.comment = slot.img.comment;
+        swapSpare(slot);
+        return;
+    }
+
+    if (option != "")
+    {
+        handleOptions(option, slot.img);
+    }
+    if (slot.img.redGray != before)
+    {
+        slot.allocRows = slot.img.rows;
+        slot.allocCols = slot.img.cols;
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function reads P5 or P6 frames one after the other from standard
+ * input, like the image2pipe output of a video decoder, runs the option
+ * on every frame and writes the frames to standard output in the same
+ * order. Reading, computing and writing overlap in the pipeline, and
+ * with more than one frame worker several frames are computed at the
+ * same time while the output stays in order. The frame arrays stay with
+ * their slot, so frames of the same size are read into arrays allocated
+ * for the first ones, and the reader and writer threads keep their row
+ * buffers. With an option that works in place and a P5 or P6 output a
+ * frame allocates no pixel memory, only the small header strings, while
+ * an ascii or QOI output still allocates its text or code buffers. A
+ * frame that cannot be read ends the stream, and errors go to standard
+ * error so they never mix with the frames.
+ *
+ * @param[in] option - the image manupulation option, - for none
+ * @param[in] type - --binary, --ascii or --qoi
+ * @param[in] frames - the number of frames computed at the same time
+ *
+ * @par Example:
+   @verbatim
+
+   //ffmpeg -i in.mp4 -f image2pipe -vcodec ppm - | prog --stream --sepia --binary 4
+   runStream("--sepia", "--binary", 4);
+
+   @endverbatim
+
+ ***********************************************************************/
+void runStream(string option, string type, int frames)
+{
+    image probe{};
+    bool ended = false;
+
+    if (!isOutputType(type))
+    {
+        throw invalid_argument("Invalid output type: " + type);
+    }
+    if (option == "-")
+    {
+        option = "";
+    }
+
+    //a bad option throws here on a one pixel frame, before anything is read
+    if (option != "")
+    {
+        probe.rows = probe.cols = 1;
+        probe.redGray = createArrays(1, 1);
+        probe.green = createArrays(1, 1);
+        probe.blue = createArrays(1, 1);
+        probe.redGray[0][0] = probe.green[0][0] = probe.blue[0][0] = 0;
+        try
+        {
+            handleOptions(option, probe);
+        }
+        catch (...)
+        {
+            clearArray(probe.redGray, probe.rows);
+            clearArray(probe.green, probe.rows);
+            clearArray(probe.blue, probe.rows);
+            throw;
+        }
+        clearArray(probe.redGray, probe.rows);
+        clearArray(probe.green, probe.rows);
+        clearArray(probe.blue, probe.rows);
+    }
+
+    //the frames are bytes, not text
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+
+    frames = max(frames, 1);
+    runPipeline(frames + 2, frames, [&](pipelineSlot& slot)
+    {
+        image header{};
+
+        //the stream ends at the end of the input or after a bad frame
+        if (ended || (cin >> ws).peek() == EOF)
+        {
+            return false;
+        }
+
+        slot.input = "frame " + to_string(slot.index);
+        try
+        {
+            readHeader(cin, header, slot.maxPixel, false);
+            if (header.magicNumber != "P5" && header.magicNumber != "P6")
+            {
+                throw runtime_error("Only P5 and P6 frames can be streamed");
+            }
+
+            //a frame of the same size reuses the arrays of the slot
+            if (!fits(slot.img, slot.allocRows, slot.allocCols, header.rows, header.cols) &&
+                fits(slot.spare, slot.spareRows, slot.spareCols, header.rows, header.cols))
+            {
+                swapSpare(slot);
+            }
+            reserveSlot(slot, header.rows, header.cols);
+            slot.img.magicNumber = header.magicNumber;
+            slot.img.comment = header.comment;
+
+            if (header.magicNumber == "P6")
+            {
+                readFileP6(cin, slot.img);
+            }
+            else
+            {
+                readFileP5(cin, slot.img);
+            }
+            if (!cin)
+            {
+                throw runtime_error("The frame is cut short");
+            }
+        }
+        catch (...)
+        {
+            ended = true;
+            throw;
+        }
+        return true;
+    },
+    [&](pipelineSlot& slot)
+    {
+        streamFrame(slot, option);
+    },
+    [&](pipelineSlot& slot)
+    {
+        handleOutput(option, type, slot.img, cout, slot.maxPixel);
+        cout.flush();
+    }, cerr);
+}
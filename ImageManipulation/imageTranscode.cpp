@@ -0,0 +1,319 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Converting between netPBM encodings without reading the image
+ *          into arrays
+ ***********************************************************************/
+#include "netPBM.h"
+#include "pixelOps.h"
+
+/************************************************************************
+ *             Constants
+ ***********************************************************************/
+ /*!
+  * @brief pixels converted at a time, the memory used does not depend on
+  *        the size of the image
+  */
+const int TRANSCODE_PIXELS = 1 << 16;
+
+/*!
+ * @brief bytes of an ascii file read from the stream at a time
+ */
+const int TRANSCODE_READ_BYTES = 1 << 16;
+
+
+/************************************************************************
+ *             Structure
+ ***********************************************************************/
+ /**
+ * @brief Reads the numbers of an ascii raster one after the other
+ *        through a buffer of fixed size, a number can be cut by the end
+ *        of the buffer
+ */
+struct asciiReader
+{
+    /**
+    * @brief text read from the stream and not parsed yet
+    */
+    vector<char> buffer;
+    /**
+    * @brief the next character of buffer to parse
+    */
+    size_t at;
+    /**
+    * @brief the number of characters in buffer
+    */
+    size_t size;
+
+    /**
+    * @brief starts with an empty buffer
+    */
+    asciiReader() : buffer(TRANSCODE_READ_BYTES), at(0), size(0)
+    {
+    }
+
+    /**
+    * @brief fills the buffer when it is empty, false at the end of the
+    *        stream
+    */
+    bool fill(istream& fin)
+    {
+        if (at < size)
+        {
+            return true;
+        }
+        fin.read(buffer.data(), buffer.size());
+        size = size_t(fin.gcount());
+        at = 0;
+        return size > 0;
+    }
+
+    /**
+    * @brief reads count numbers into values, a character that is not a
+    *        digit or a value over maxPixel is an error
+    */
+    void read(istream& fin, pixel* values, size_t count, int maxPixel)
+    {
+        size_t k;
+        int value;
+        char c;
+
+        for (k = 0; k < count; k++)
+        {
+            //skip to the next number
+            while (true)
+            {
+                if (!fill(fin))
+                {
+                    throw runtime_error("The image data is cut short");
+                }
+                if (!isSeparator(buffer[at]))
+                {
+                    break;
+                }
+                at++;
+            }
+
+            //the digits can go on into the next buffer, stop adding digits
+            //once the value is too large
+            value = 0;
+            while (fill(fin))
+            {
+                c = buffer[at];
+                if (isSeparator(c))
+                {
+                    break;
+                }
+                if (c < '0' || c > '9')
+                {
+                    throw runtime_error("The image data has a character that is not a digit");
+                }
+                if (value <= maxPixel)
+                {
+                    value = value * 10 + (c - '0');
+                }
+                at++;
+            }
+            if (value > maxPixel)
+            {
+                throw runtime_error("The image data has a value over the maxPixel");
+            }
+            values[k] = pixel(value);
+        }
+    }
+};
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function writes values as ascii numbers, one number per line,
+ * the same text writeAsciiRaster writes. Every thread formats its own
+ * block of the values into its own buffer, then the buffers are written
+ * in order.
+ *
+ * @param[out] fout - the output stream
+ * @param[in] values - the values
+ * @param[in] count - the number of values
+ * @param[in, out] buffers - one text buffer per thread, kept between calls
+ *
+ * @par Example:
+   @verbatim
+
+   vector<string> buffers(threadCount());
+   writeAsciiValues(fout, row.data(), row.size(), buffers);
+
+   @endverbatim
+
+ ***********************************************************************/
+static void writeAsciiValues(ostream& fout, const pixel* values, size_t count,
+    vector<string>& buffers)
+{
+    int b, blocks = int(buffers.size());
+
+    parallelFor(blocks, [&](int first, int last)
+    {
+        int k;
+        size_t i, from, to;
+
+        for (k = first; k < last; k++)
+        {
+            from = count * k / blocks;
+            to = count * (k + 1) / blocks;
+            buffers[k].clear();
+            for (i = from; i < to; i++)
+            {
+                buffers[k] += asciiNumber(values[i]);
+            }
+        }
+    });
+
+    for (b = 0; b < blocks; b++)
+    {
+        fout.write(buffers[b].data(), buffers[b].size());
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function converts an image straight from its input encoding to
+ * its output encoding when there is no option or the option is
+ * --grayscale. P2, P3, P5 and P6 files can be written as P3 or P6, or as
+ * P2 or P5 for --grayscale. The raster is handled TRANSCODE_PIXELS pixels
+ * at a time as interleaved values, so the image is never stored in arrays
+ * and the memory used is the same for any size. The values come out the
+ * same as reading into arrays and writing them back: a gray input is
+ * spread to three values and --grayscale uses the weights of grayOp. Any
+ * other option, output type or input returns false with the stream back
+ * at the start so the caller can handle it the usual way.
+ *
+ * @param[in, out] fin - the input stream
+ * @param[out] fout - the output stream
+ * @param[in] option - the image manupulation option, can be empty
+ * @param[in] type - --binary or --ascii
+ *
+ * @returns true - if the image was converted
+ *
+ * @par Example:
+   @verbatim
+
+   if (!transcodeImage(fin, fout, "", "--ascii"))
+   {
+       //read the whole image
+   }
+
+   @endverbatim
+
+ ***********************************************************************/
+bool transcodeImage(istream& fin, ostream& fout, string option, string type)
+{
+    image header{};
+    int maxPixel, v, r, g, b;
+    int inSamples, outSamples;
+    long long left;
+    size_t i, count;
+    bool gray = option == "--grayscale", ascii = type == "--ascii";
+    bool asciiIn;
+    vector<pixel> in, out;
+    const pixel* result;
+    vector<string> buffers(threadCount());
+    pixel spread[256];
+    grayOp toGray;
+    asciiReader reader;
+
+    if ((option != "" && !gray) || (type != "--binary" && type != "--ascii"))
+    {
+        return false;
+    }
+
+    readHeader(fin, header, maxPixel);
+    if (header.magicNumber == "qoif" || header.magicNumber == "P7")
+    {
+        fin.clear();
+        fin.seekg(0, ios::beg);
+        return false;
+    }
+
+    asciiIn = header.magicNumber == "P2" || header.magicNumber == "P3";
+    inSamples = header.magicNumber == "P2" || header.magicNumber == "P5" ? 1 : 3;
+    outSamples = gray ? 1 : 3;
+    in.resize(size_t(TRANSCODE_PIXELS) * inSamples);
+    out.resize(size_t(TRANSCODE_PIXELS) * outSamples);
+
+    //a gray value through grayOp is the same for every pixel with that value
+    for (v = 0; v < 256; v++)
+    {
+        r = g = b = v;
+        toGray(r, g, b);
+        spread[v] = pixel(r);
+    }
+
+    writeHeader(fout, gray ? (ascii ? "P2" : "P5") : (ascii ? "P3" : "P6"), header, maxPixel);
+
+    for (left = (long long)header.rows * header.cols; left > 0; left -= count)
+    {
+        count = size_t(min<long long>(left, TRANSCODE_PIXELS));
+
+        //read the next pixels as interleaved values
+        if (asciiIn)
+        {
+            reader.read(fin, in.data(), count * inSamples, maxPixel);
+        }
+        else if (!fin.read((char*)in.data(), count * inSamples))
+        {
+            throw runtime_error("The image data is cut short");
+        }
+
+        //color to color is only a change of encoding
+        result = in.data();
+
+        //color to gray
+        if (inSamples == 3 && gray)
+        {
+            for (i = 0; i < count; i++)
+            {
+                r = in[i * 3];
+                g = in[i * 3 + 1];
+                b = in[i * 3 + 2];
+                toGray(r, g, b);
+                out[i] = pixel(r);
+            }
+            result = out.data();
+        }
+
+        //gray to gray
+        else if (inSamples == 1 && gray)
+        {
+            for (i = 0; i < count; i++)
+            {
+                out[i] = spread[in[i]];
+            }
+            result = out.data();
+        }
+
+        //gray to three equal values
+        else if (inSamples == 1)
+        {
+            for (i = 0; i < count; i++)
+            {
+                out[i * 3] = out[i * 3 + 1] = out[i * 3 + 2] = in[i];
+            }
+            result = out.data();
+        }
+
+        if (ascii)
+        {
+            writeAsciiValues(fout, result, count * outSamples, buffers);
+        }
+        else
+        {
+            fout.write((const char*)result, count * outSamples);
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,323 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Affine warp, rotation by any angle, with nearest and bilinear
+ *          sampling
+ ***********************************************************************/
+#include "netPBM.h"
+#include <cmath>
+
+/************************************************************************
+ *             Constants
+ ***********************************************************************/
+ /*!
+  * @brief number of fraction bits in the fixed point source positions
+  */
+const int WARP_BITS = 16;
+
+/*!
+ * @brief rows and columns of a tile of the output done by one thread
+ */
+const int WARP_TILE = 64;
+
+/*!
+ * @brief value of pi for the rotation
+ */
+const double WARP_PI = 3.14159265358979323846;
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function reads the warp options. --rotate=DEG turns the image by
+ * DEG degrees clockwise around its center, --affine=a,b,c,d,e,f moves
+ * every pixel x, y of the input to a x + b y + c, d x + e y + f of the
+ * output. Both can end with a filter, nearest or bilinear, and a border
+ * mode, clamp, mirror, wrap or zero, for the parts of the output that
+ * come from outside of the input. The default is bilinear with a zero
+ * border. The matrix is the forward matrix in the order a to f.
+ *
+ * @param[in] option - the warp option
+ * @param[in] rows - the rows of the image
+ * @param[in] cols - the columns of the image
+ * @param[out] matrix - the six numbers of the forward matrix
+ * @param[out] filter - nearest or bilinear
+ * @param[out] border - how positions outside of the input are handled
+ *
+ * @returns true - if the option is valid
+ *
+ * @par Example:
+   @verbatim
+
+   double matrix[6];
+   string filter;
+   borderMode border;
+
+   bool valid = parseWarp("--rotate=1.5:bilinear:clamp", 7016, 4960, matrix,
+       filter, border);
+
+   @endverbatim
+
+ ***********************************************************************/
+bool parseWarp(string option, int rows, int cols, double matrix[6], string& filter,
+    borderMode& border)
+{
+    size_t colon, comma, k;
+    double angle, cx, cy;
+    char* end;
+    string text = option.substr(option.find('=') + 1);
+    string rest, number;
+
+    //split off the filter and the border mode
+    colon = text.find(':');
+    filter = "bilinear";
+    border = BORDER_ZERO;
+    if (colon != string::npos)
+    {
+        rest = text.substr(colon + 1);
+        text = text.substr(0, colon);
+        colon = rest.find(':');
+        if (rest.substr(0, colon) != "")
+        {
+            filter = rest.substr(0, colon);
+        }
+        if (colon != string::npos && !parseBorder(rest.substr(colon + 1), border))
+        {
+            return false;
+        }
+    }
+    if (filter != "nearest" && filter != "bilinear")
+    {
+        return false;
+    }
+
+    if (option.compare(0, 9, "--rotate=") == 0)
+    {
+        angle = strtod(text.c_str(), &end);
+        if (text == "" || *end != '\0')
+        {
+            return false;
+        }
+
+        //turn around the center of the middle pixel
+        angle = angle * WARP_PI / 180.0;
+        cx = (cols - 1) / 2.0;
+        cy = (rows - 1) / 2.0;
+        matrix[0] = cos(angle);
+        matrix[1] = -sin(angle);
+        matrix[2] = cx - matrix[0] * cx - matrix[1] * cy;
+        matrix[3] = sin(angle);
+        matrix[4] = cos(angle);
+        matrix[5] = cy - matrix[3] * cx - matrix[4] * cy;
+        return true;
+    }
+
+    //six numbers split by commas
+    for (k = 0; k < 6; k++)
+    {
+        comma = text.find(',');
+        if ((comma == string::npos) != (k == 5))
+        {
+            return false;
+        }
+        number = text.substr(0, comma);
+        matrix[k] = strtod(number.c_str(), &end);
+        if (number == "" || *end != '\0')
+        {
+            return false;
+        }
+        text = comma == string::npos ? "" : text.substr(comma + 1);
+    }
+    return true;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function finds a value of the input for the warp when the
+ * position or one of its neighbours is outside of the image. The border
+ * mode maps the position back in, a zero border gives 0.
+ *
+ * @param[in] plane - the input array
+ * @param[in] img - the input image, for its size
+ * @param[in] i - the row, can be outside of the image
+ * @param[in] j - the column, can be outside of the image
+ * @param[in] border - how positions outside of the input are handled
+ *
+ * @returns the value at i, j
+ *
+ * @par Example:
+   @verbatim
+
+   int value = edgeValue(img.redGray, img, -1, 10, BORDER_CLAMP);
+   //value is img.redGray[0][10]
+
+   @endverbatim
+
+ ***********************************************************************/
+static inline int edgeValue(pixel** plane, const image& img, int i, int j, borderMode border)
+{
+    i = borderIndex(i, img.rows, border);
+    j = borderIndex(j, img.cols, border);
+    return i < 0 || j < 0 ? 0 : plane[i][j];
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function does an affine warp of the image. The forward matrix is
+ * inverted so every output pixel knows where it comes from in the input.
+ * The output is done in tiles of WARP_TILE X WARP_TILE pixels split
+ * across threads, so the input rows a tile reads stay in the cache even
+ * when the angle makes the reads cross many rows. Along a row of a tile
+ * the source position is stepped in fixed point with WARP_BITS fraction
+ * bits, one add per pixel, and a position whose neighbours are all
+ * inside of the image is read without any checks. Bilinear weights use
+ * the top 8 fraction bits. The output has the size of the input.
+ *
+ * @param[in, out] img - the structure where the data of the image is stored
+ * @param[in] matrix - the forward matrix a, b, c, d, e, f
+ * @param[in] filter - nearest or bilinear
+ * @param[in] border - how positions outside of the input are handled
+ *
+ * @par Example:
+   @verbatim
+
+   double matrix[6] = { 1, 0.1, 0, 0, 1, 0 };
+   warpImage(img, matrix, "bilinear", BORDER_ZERO);
+   //img is sheared to the right
+
+   @endverbatim
+
+ ***********************************************************************/
+void warpImage(image& img, const double matrix[6], string filter, borderMode border)
+{
+    double det = matrix[0] * matrix[4] - matrix[1] * matrix[3];
+    double inverse[6];
+    int tilesAcross = (img.cols + WARP_TILE - 1) / WARP_TILE;
+    int tilesDown = (img.rows + WARP_TILE - 1) / WARP_TILE;
+    bool nearest = filter == "nearest";
+    image out{};
+
+    if (fabs(det) < 1e-12)
+    {
+        throw invalid_argument("The warp matrix cannot be inverted");
+    }
+
+    //the inverse maps an output position to its input position
+    inverse[0] = matrix[4] / det;
+    inverse[1] = -matrix[1] / det;
+    inverse[3] = -matrix[3] / det;
+    inverse[4] = matrix[0] / det;
+    inverse[2] = -(inverse[0] * matrix[2] + inverse[1] * matrix[5]);
+    inverse[5] = -(inverse[3] * matrix[2] + inverse[4] * matrix[5]);
+
+    out.rows = img.rows;
+    out.cols = img.cols;
+    out.redGray = createArrays(img.rows, img.cols);
+    try
+    {
+        out.green = createArrays(img.rows, img.cols);
+        out.blue = createArrays(img.rows, img.cols);
+    }
+    catch (bad_alloc&)
+    {
+        clearArray(out.redGray, out.rows);
+        clearArray(out.green, out.rows);
+        throw;
+    }
+
+    parallelFor(tilesAcross * tilesDown, [&](int first, int last)
+    {
+        const double one = double(1 << WARP_BITS);
+        const long long half = nearest ? 1LL << (WARP_BITS - 1) : 0;
+        const int rows = img.rows, cols = img.cols;
+        int t, i, j, n, k, top, left, right, bottom, width, fu, fv;
+        long long u, v, du, dv;
+        int col[WARP_TILE], row[WARP_TILE], weight[WARP_TILE][4];
+        bool inside[WARP_TILE];
+        pixel** const in[3] = { img.redGray, img.green, img.blue };
+        pixel* to;
+        const pixel* above;
+        const pixel* below;
+
+        du = llround(inverse[0] * one);
+        dv = llround(inverse[3] * one);
+
+        for (t = first; t < last; t++)
+        {
+            top = (t / tilesAcross) * WARP_TILE;
+            left = (t % tilesAcross) * WARP_TILE;
+            bottom = min(top + WARP_TILE, rows);
+            right = min(left + WARP_TILE, cols);
+            width = right - left;
+
+            for (i = top; i < bottom; i++)
+            {
+                //the source of the first pixel, then one step per pixel
+                u = llround((inverse[0] * left + inverse[1] * i + inverse[2]) * one) + half;
+                v = llround((inverse[3] * left + inverse[4] * i + inverse[5]) * one) + half;
+
+                //the positions are worked out once for the three arrays
+                for (n = 0; n < width; n++, u += du, v += dv)
+                {
+                    col[n] = int(u >> WARP_BITS);
+                    row[n] = int(v >> WARP_BITS);
+                    fu = int((u >> (WARP_BITS - 8)) & 255);
+                    fv = int((v >> (WARP_BITS - 8)) & 255);
+                    weight[n][0] = (256 - fu) * (256 - fv);
+                    weight[n][1] = fu * (256 - fv);
+                    weight[n][2] = (256 - fu) * fv;
+                    weight[n][3] = fu * fv;
+
+                    //a nearest pixel, or all four neighbours, in the image
+                    inside[n] = nearest ?
+                        unsigned(col[n]) < unsigned(cols) && unsigned(row[n]) < unsigned(rows) :
+                        unsigned(col[n]) < unsigned(cols - 1) && unsigned(row[n]) < unsigned(rows - 1);
+                }
+
+                for (k = 0; k < 3; k++)
+                {
+                    to = (k == 0 ? out.redGray : k == 1 ? out.green : out.blue)[i] + left;
+                    for (n = 0; n < width; n++)
+                    {
+                        j = col[n];
+                        if (nearest)
+                        {
+                            to[n] = pixel(inside[n] ? in[k][row[n]][j] :
+                                edgeValue(in[k], img, row[n], j, border));
+                        }
+                        else if (inside[n])
+                        {
+                            above = in[k][row[n]] + j;
+                            below = in[k][row[n] + 1] + j;
+                            to[n] = pixel((above[0] * weight[n][0] + above[1] * weight[n][1] +
+                                below[0] * weight[n][2] + below[1] * weight[n][3] + 32768) >> 16);
+                        }
+                        else
+                        {
+                            to[n] = pixel((edgeValue(in[k], img, row[n], j, border) * weight[n][0] +
+                                edgeValue(in[k], img, row[n], j + 1, border) * weight[n][1] +
+                                edgeValue(in[k], img, row[n] + 1, j, border) * weight[n][2] +
+                                edgeValue(in[k], img, row[n] + 1, j + 1, border) * weight[n][3] +
+                                32768) >> 16);
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    //delete the original arrays and keep the warped ones
+    clearArray(img.redGray, img.rows);
+    clearArray(img.green, img.rows);
+    clearArray(img.blue, img.rows);
+    img.redGray = out.redGray;
+    img.green = out.green;
+    img.blue = out.blue;
+}
@@ -4,6 +4,40 @@
  * @brief   Allocate and clear memory functions for dynamic array
  ***********************************************************************/
 #include "netPBM.h"
+#include <map>
+#include <mutex>
+#include <cstring>
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function returns the owner counts of the arrays that are shared
+ * by more than one image, and the lock that guards them. Arrays that are
+ * not in the table have a single owner.
+ *
+ * @param[out] lock - the lock of the table
+ *
+ * @returns the table of owner counts
+ *
+ * @par Example:
+   @verbatim
+
+   mutex* lock;
+   map<pixel**, int>& owners = sharedArrays(lock);
+
+   @endverbatim
+
+ ***********************************************************************/
+static map<pixel**, int>& sharedArrays(mutex*& lock)
+{
+    static mutex tableLock;
+    static map<pixel**, int> owners;
+
+    lock = &tableLock;
+    return owners;
+}
 
 
 
@@ -51,10 +85,8 @@ pixel** createArrays(int rows, int cols)
     //check if it was able to allocate memory
     if (pointer == nullptr)
     {
-        //unable to allocate memory - error message and exit
-        delete[] pointer;
-        cout << "Unable to allocate memory" << endl;
-        exit(0);
+        //unable to allocate memory
+        throw bad_alloc();
     }
 
 
@@ -64,10 +96,9 @@ pixel** createArrays(int rows, int cols)
         pointer[i] = new (nothrow) pixel[cols];
         if (pointer[i] == nullptr)
         {
-            //unable to allocate memory - error message, clear array exit
-            cout << "Unable to allocate memory" << endl;
-            clearArray(pointer, i - 1);
-            exit(0);
+            //unable to allocate memory - clear the rows made so far
+            clearArray(pointer, i);
+            throw bad_alloc();
         }
     }
 
@@ -83,7 +114,9 @@ pixel** createArrays(int rows, int cols)
  * @par Description:
  * This function receives the pointer to a dynamically allocated
  * 2D array and the number of rows in the array. This function deletes
- * the 2D array
+ * the 2D array and sets the pointer to nullptr. A nullptr is left alone
+ * so arrays that were never created can be cleared safely. A shared
+ * array is only deleted when its last owner clears it
  *
  * @param[in out] pointer - the pointer to a 2D array
  * @param[in] rows - the number of rows in the 2D array
@@ -105,6 +138,31 @@ pixel** createArrays(int rows, int cols)
 void clearArray(pixel**& pointer, int rows)
 {
     int i;
+    mutex* lock;
+    map<pixel**, int>& owners = sharedArrays(lock);
+    map<pixel**, int>::iterator shared;
+
+    //nothing was allocated
+    if (pointer == nullptr)
+    {
+        return;
+    }
+
+    //a shared array is only deleted by its last owner
+    {
+        lock_guard<mutex> guard(*lock);
+        shared = owners.find(pointer);
+        if (shared != owners.end())
+        {
+            if (--shared->second > 0)
+            {
+                pointer = nullptr;
+                return;
+            }
+            owners.erase(shared);
+        }
+    }
+
     //delete every row 
     for (i = 0; i < rows; i++)
     {
@@ -113,4 +171,119 @@ void clearArray(pixel**& pointer, int rows)
 
     //delete the array of pointers
     delete[] pointer;
-}
\ No newline at end of file
+    pointer = nullptr;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function lets more images own the same 2D array. Each owner
+ * clears the array with clearArray when it is done and the memory is
+ * deleted by the last one. Owners must not change the pixels of a
+ * shared array, they call unshareArray first.
+ *
+ * @param[in] pointer - the pointer to a 2D array
+ * @param[in] extra - the number of owners added
+ *
+ * @par Example:
+   @verbatim
+
+   pixel** plane = createArrays(100, 50);
+   shareArray(plane, 2);
+   //plane now has 3 owners, it is deleted by the third clearArray
+
+   @endverbatim
+
+ ***********************************************************************/
+void shareArray(pixel** pointer, int extra)
+{
+    mutex* lock;
+    map<pixel**, int>& owners = sharedArrays(lock);
+    lock_guard<mutex> guard(*lock);
+    map<pixel**, int>::iterator shared = owners.find(pointer);
+
+    if (shared == owners.end())
+    {
+        owners[pointer] = 1 + extra;
+    }
+    else
+    {
+        shared->second += extra;
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function is the copy of copy on write. If the array is shared it
+ * is copied into a new array that only the caller owns and the caller
+ * gives up its share of the old one. An array with one owner is left as
+ * it is.
+ *
+ * @param[in, out] pointer - the pointer to a 2D array
+ * @param[in] rows - the number of rows in the 2D array
+ * @param[in] cols - the number of columns in the 2D array
+ *
+ * @par Example:
+   @verbatim
+
+   unshareArray(img.redGray, img.rows, img.cols);
+   //img.redGray can now be changed without changing any other image
+
+   @endverbatim
+
+ ***********************************************************************/
+void unshareArray(pixel**& pointer, int rows, int cols)
+{
+    int i;
+    pixel** copy;
+    mutex* lock;
+    map<pixel**, int>& owners = sharedArrays(lock);
+
+    {
+        lock_guard<mutex> guard(*lock);
+        if (pointer == nullptr || owners.find(pointer) == owners.end())
+        {
+            return;
+        }
+    }
+
+    copy = createArrays(rows, cols);
+    for (i = 0; i < rows; i++)
+    {
+        memcpy(copy[i], pointer[i], size_t(cols));
+    }
+    clearArray(pointer, rows);
+    pointer = copy;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function unshares all three arrays of an image, for operations
+ * that change every array where it is. Arrays with one owner are left
+ * as they are, so it costs nothing outside of a fan out.
+ *
+ * @param[in, out] img - the image
+ *
+ * @par Example:
+   @verbatim
+
+   unshareImage(img);
+   //every array of img can now be changed without changing any other image
+
+   @endverbatim
+
+ ***********************************************************************/
+void unshareImage(image& img)
+{
+    unshareArray(img.redGray, img.rows, img.cols);
+    unshareArray(img.green, img.rows, img.cols);
+    unshareArray(img.blue, img.rows, img.cols);
+}
@@ -8,6 +8,11 @@
 #include <string>
 #include<iostream>
 #include<iomanip>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+#include <new>
 
 using namespace std;
 
@@ -22,6 +27,17 @@ using namespace std;
   */
 typedef unsigned char pixel;
 
+/*!
+ * @brief how filters treat the pixels outside of the image
+ */
+enum borderMode
+{
+    BORDER_CLAMP,   /*!< repeat the edge pixel */
+    BORDER_MIRROR,  /*!< reflect the image around the edge */
+    BORDER_WRAP,    /*!< continue from the other side of the image */
+    BORDER_ZERO     /*!< use 0 outside of the image */
+};
+
 
 
 /************************************************************************
@@ -49,6 +65,11 @@ struct image
     */
     int cols;
     /**
+    * @brief holds the number of values per pixel in the file, 1 for
+    *        gray, 3 for color and 2 or 4 for a P7 file with alpha
+    */
+    int depth;
+    /**
     * @brief pointer to a 2D dynamica array redGray
     */
     pixel** redGray;
@@ -62,6 +83,51 @@ struct image
     pixel** blue;
 };
 
+/**
+* @brief Holds a 256 entry look up table for each of the three arrays
+*/
+struct pixelLut
+{
+    /**
+    * @brief table[c][v] is the new value of v in array c
+    */
+    pixel table[3][256];
+};
+
+/**
+* @brief Holds the histograms of the three arrays
+*/
+struct imageStats
+{
+    /**
+    * @brief histogram[c][v] is the number of pixels of array c equal to v
+    */
+    unsigned long long histogram[3][256];
+};
+
+/**
+* @brief Holds how much two images differ, for each of the three arrays
+*/
+struct imageCompare
+{
+    /**
+    * @brief true if every value of the two images is the same
+    */
+    bool identical;
+    /**
+    * @brief the largest difference of a value
+    */
+    int maxDiff[3];
+    /**
+    * @brief the mean of the squared differences
+    */
+    double mse[3];
+    /**
+    * @brief the mean structural similarity, 1 for the same image
+    */
+    double ssim[3];
+};
+
 
 /************************************************************************
  *               Prototypes
@@ -71,26 +137,130 @@ void printUsage();
 bool isBinFileOpen(string bfile, ifstream& fin);
 bool isBinOutputOpen(string file, ofstream& fout);
 
-bool readFile(ifstream& fin, image& img, int& maxPixel);
-bool readFileP3(ifstream& fin, image& img);
-bool readFileP6(ifstream& fin, image& img);
+bool readHeader(istream& fin, image& img, int& maxPixel, bool rewind = true);
+bool readFile(istream& fin, image& img, int& maxPixel, const pixelLut* lut = nullptr,
+    imageStats* stats = nullptr);
+bool readFileThumbnail(istream& fin, image& img, int& maxPixel, int factor);
+void readRows(istream& fin, string magicNumber, int rows, int cols, int depth,
+    const function<void(const pixel*, int)>& use);
+bool readFileP3(istream& fin, image& img, const pixelLut* lut = nullptr,
+    imageStats* stats = nullptr, int maxPixel = 255);
+bool readFileP5(istream& fin, image& img, const pixelLut* lut = nullptr,
+    imageStats* stats = nullptr);
+bool readFileP6(istream& fin, image& img, const pixelLut* lut = nullptr,
+    imageStats* stats = nullptr);
+bool readFileQoi(istream& fin, image& img, const pixelLut* lut = nullptr,
+    imageStats* stats = nullptr);
+bool readFileP7(istream& fin, image& img, pixel** alpha = nullptr,
+    const pixelLut* lut = nullptr, imageStats* stats = nullptr);
+void writeHeader(ostream& fout, string magicNumber, image img, int maxPixel);
+void writeRaster(ostream& fout, image img, int samples, bool ascii);
+bool isSeparator(char c);
+const string& asciiNumber(pixel value);
 
 pixel** createArrays(int rows, int cols);
 void clearArray(pixel**& pointer, int rows);
+void shareArray(pixel** pointer, int extra);
+void unshareArray(pixel**& pointer, int rows, int cols);
+void unshareImage(image& img);
 void copyArray(pixel**& array, pixel** array1, image img);
 
 void handleOptions(string option, image& img);
 void rotateImageCW(image& img);
 void rotateImageCCW(image& img);
+void rotateInto(const image& img, image& out, bool clockwise);
 void flipX(image& img);
 void flipY(image& img);
 void grayScale(image& img);
 void sepia(image& img);
 
-void handleOutput(string option, string type, image img, ofstream& fout, int maxPixel);
+void resizeImage(image& img, int newRows, int newCols, string filter);
+bool parseResize(string option, int& newRows, int& newCols, string& filter);
+
+void lutIdentity(pixelLut& lut);
+void lutCompose(pixelLut& lut, const pixel map[256], int channel);
+bool toneMap(string name, string value, pixel map[256]);
+bool parseTone(string option, pixelLut& lut);
+void applyLut(image& img, const pixelLut& lut);
+
+void clearStats(imageStats& stats);
+void addRowStats(imageStats& stats, const pixel* row, int cols);
+void computeStats(image img, imageStats& stats);
+int statsPercentile(const imageStats& stats, int channel, double percent);
+void writeStatsJson(ostream& out, const imageStats& stats, int rows, int cols);
+void autoLevelsLut(const imageStats& stats, pixelLut& lut);
+void equalizeLut(const imageStats& stats, pixelLut& lut);
+void printStats(string file);
+
+void compareImages(const image& first, const image& second, int maxPixel,
+    imageCompare& result);
+void writeCompareJson(ostream& out, const imageCompare& result, int rows, int cols,
+    int maxPixel);
+bool printCompare(string first, string second);
+
+int runServer(string path, int jobs);
+
+unsigned long long hashBytes(const void* data, size_t size, unsigned long long seed);
+string normalizeOption(string option);
+bool runCached(string dir, unsigned long long maxBytes, string option, string type,
+    string input, string output);
+void printCacheStats(string dir);
+
+bool pipeStrips(istream& fin, ostream& fout, string option, string type);
+bool transcodeImage(istream& fin, ostream& fout, string option, string type);
+void runBatch(string option, string type, string outdir, const vector<string>& inputs);
+
+void runFanout(string type, string input, const vector<string>& basenames,
+    const vector<string>& options);
+
+void runStream(string option, string type, int frames);
+
+void runProfile(string option, string type, string input, string output);
+
+int borderIndex(int i, int size, borderMode border);
+bool parseBorder(string name, borderMode& border);
+void convolveImage(image& img, vector<double> kernel, int size, borderMode border);
+bool parseConvolve(string option, vector<double>& kernel, int& size, borderMode& border);
+void gaussianBlur(image& img, double sigma, borderMode border);
+void sharpen(image& img, double amount, borderMode border);
+bool parseSharpen(string option, double& amount, borderMode& border);
+
+bool parseWarp(string option, int rows, int cols, double matrix[6], string& filter,
+    borderMode& border);
+void warpImage(image& img, const double matrix[6], string filter, borderMode border);
+
+void edgeDetect(image& img, int threshold, borderMode border);
+bool parseEdges(string option, int& threshold, borderMode& border);
+
+void morphImage(image& img, string operation, int width, int height);
+bool parseMorph(string option, string& operation, int& width, int& height);
+
+void medianFilter(image& img, int radius, borderMode border);
+bool parseMedian(string option, int& radius, borderMode& border);
+
+void quantizeImage(image& img, string mode, int levels, bool dither);
+bool parseQuantize(string option, string& mode, int& levels, bool& dither);
+
+void overlayImage(image& img, string file, int x, int y, bool tiled);
+bool parseOverlay(string option, string& file, int& x, int& y, bool& tiled);
+
+bool parsePyramid(string option, int& levels);
+void runPyramid(string option, string type, string basename, string input);
+
+int threadCount();
+void parallelFor(int count, const function<void(int, int)>& work);
+
+void handleOutput(string option, string type, image img, ostream& fout, int maxPixel);
+bool isOutputType(string type);
+string outputExtension(string option, string type);
+int outputMaxPixel(string option, int maxPixel);
+bool processImage(istream& fin, string option, image& img, int& maxPixel);
 
-bool writeFileP3(ofstream& fout, image img, int maxPixel);
-bool writeFileP6(ofstream& fout, image img, int maxPixel);
-bool writeGrayP2(ofstream& fout, image img, int maxPixel);
-bool writeGrayP5(ofstream& fout, image img, int maxPixel);
+bool writeFileP3(ostream& fout, image img, int maxPixel);
+bool writeFileP6(ostream& fout, image img, int maxPixel);
+bool writeGrayP2(ostream& fout, image img, int maxPixel);
+bool writeGrayP5(ostream& fout, image img, int maxPixel);
+bool writeFileQoi(ostream& fout, image img);
+void halveRow(const pixel* top, const pixel* bottom, pixel* out, int cols);
+bool writePlanar(ostream& fout, image img, bool subsample, bool gray);
 #endif
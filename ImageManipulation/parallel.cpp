@@ -0,0 +1,304 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Functions to split image work across threads
+ ***********************************************************************/
+#include "netPBM.h"
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function returns the number of worker threads the program should
+ * use. It asks the system for the number of hardware threads and falls
+ * back to one if the system cannot tell.
+ *
+ * @returns the number of threads to use, always at least 1
+ *
+ * @par Example:
+   @verbatim
+
+   int count = threadCount();
+   //count will be 8 on a machine with 8 hardware threads
+
+   @endverbatim
+
+ ***********************************************************************/
+int threadCount()
+{
+    int count = int(thread::hardware_concurrency());
+
+    //the system could not tell us, use a single thread
+    if (count < 1)
+    {
+        count = 1;
+    }
+
+    return count;
+}
+
+
+/************************************************************************
+ *             Structure
+ ***********************************************************************/
+ /**
+ * @brief Threads that are started once and then wait for blocks of work,
+ *        so parallelFor does not pay for starting threads every call
+ */
+struct threadPool
+{
+    /**
+    * @brief the waiting threads
+    */
+    vector<thread> workers;
+    /**
+    * @brief blocks of work that no thread has taken yet
+    */
+    deque<function<void()>> tasks;
+    /**
+    * @brief guards tasks and stop
+    */
+    mutex lock;
+    /**
+    * @brief signalled when a task is added or the pool stops
+    */
+    condition_variable wake;
+    /**
+    * @brief set when the program ends so the threads return
+    */
+    bool stop = false;
+
+    /**
+    * @brief starts one thread less than threadCount, the thread calling
+    *        parallelFor does a share of the work itself
+    */
+    threadPool()
+    {
+        int i;
+        for (i = 1; i < threadCount(); i++)
+        {
+            workers.push_back(thread([this]() { workLoop(); }));
+        }
+    }
+
+    /**
+    * @brief stops and joins the threads
+    */
+    ~threadPool()
+    {
+        unique_lock<mutex> guard(lock);
+        stop = true;
+        guard.unlock();
+        wake.notify_all();
+        for (size_t i = 0; i < workers.size(); i++)
+        {
+            workers[i].join();
+        }
+    }
+
+    /**
+    * @brief takes tasks off the queue and runs them until the pool stops
+    */
+    void workLoop()
+    {
+        function<void()> task;
+
+        while (true)
+        {
+            unique_lock<mutex> guard(lock);
+            wake.wait(guard, [this]() { return stop || !tasks.empty(); });
+            if (tasks.empty())
+            {
+                return;
+            }
+            task = move(tasks.front());
+            tasks.pop_front();
+            guard.unlock();
+            task();
+        }
+    }
+
+    /**
+    * @brief runs one waiting task on the calling thread if there is one
+    * @returns true - if a task was run
+    */
+    bool helpOnce()
+    {
+        function<void()> task;
+        unique_lock<mutex> guard(lock);
+
+        if (tasks.empty())
+        {
+            return false;
+        }
+        task = move(tasks.front());
+        tasks.pop_front();
+        guard.unlock();
+        task();
+        return true;
+    }
+};
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function returns the thread pool shared by the whole program. It
+ * is made the first time it is needed and its threads stay alive until
+ * the program ends, so later calls find the threads already running.
+ *
+ * @returns the thread pool
+ *
+ * @par Example:
+   @verbatim
+
+   threadPool& pool = sharedPool();
+
+   @endverbatim
+
+ ***********************************************************************/
+static threadPool& sharedPool()
+{
+    static threadPool pool;
+    return pool;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function splits the range 0 to count into one block per thread
+ * and calls work(first, last) for every block. The blocks are handed to
+ * the threads of the shared pool and the first block is done on the
+ * calling thread. While waiting, the calling thread takes any blocks that
+ * are still queued, so parallelFor can be called from several threads at
+ * once, or from inside another parallelFor, without running out of
+ * threads. The blocks do not overlap so every thread can write its own
+ * rows without locking. Small ranges are run on the calling thread.
+ * If a block throws, the other blocks still finish, since they use the
+ * locals of this call, and then the first exception is thrown again on
+ * the calling thread.
+ *
+ * @param[in] count - the number of items (usually rows) to process
+ * @param[in] work - the function called with the first and one past the
+ *                   last item of a block
+ *
+ * @par Example:
+   @verbatim
+
+   parallelFor(img.rows, [&](int first, int last)
+   {
+       for (int i = first; i < last; i++)
+       {
+           //process row i
+       }
+   });
+
+   @endverbatim
+
+ ***********************************************************************/
+void parallelFor(int count, const function<void(int, int)>& work)
+{
+    int i;
+    int threads = threadCount();
+    int block;
+    int remaining;
+    mutex lock;
+    condition_variable done;
+    exception_ptr error;
+    threadPool& pool = sharedPool();
+
+    //never make more blocks than there are items
+    if (threads > count)
+    {
+        threads = count;
+    }
+
+    //not worth using threads, do the work here
+    if (threads <= 1)
+    {
+        if (count > 0)
+        {
+            work(0, count);
+        }
+        return;
+    }
+
+    //size of each block, rounded up so every item is covered
+    block = (count + threads - 1) / threads;
+    remaining = (count + block - 1) / block;
+
+    //queue every block but the first
+    {
+        unique_lock<mutex> guard(pool.lock);
+        for (i = block; i < count; i += block)
+        {
+            pool.tasks.push_back([&, i]()
+            {
+                exception_ptr failed;
+                try
+                {
+                    work(i, min(i + block, count));
+                }
+                catch (...)
+                {
+                    failed = current_exception();
+                }
+                unique_lock<mutex> finished(lock);
+                if (failed && !error)
+                {
+                    error = failed;
+                }
+                if (--remaining == 0)
+                {
+                    done.notify_all();
+                }
+            });
+        }
+    }
+    pool.wake.notify_all();
+
+    //do the first block here, an error waits until the other blocks
+    //stop using the locals of this call
+    exception_ptr failed;
+    try
+    {
+        work(0, min(block, count));
+    }
+    catch (...)
+    {
+        failed = current_exception();
+    }
+
+    //help with queued blocks, then wait for the rest to finish
+    unique_lock<mutex> guard(lock);
+    if (failed && !error)
+    {
+        error = failed;
+    }
+    remaining--;
+    while (remaining > 0)
+    {
+        guard.unlock();
+        if (!pool.helpOnce())
+        {
+            guard.lock();
+            done.wait(guard, [&]() { return remaining == 0; });
+            break;
+        }
+        guard.lock();
+    }
+    if (error)
+    {
+        rethrow_exception(error);
+    }
+}
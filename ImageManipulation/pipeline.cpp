@@ -0,0 +1,606 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Read, compute and write stages that run at the same time
+ ***********************************************************************/
+#include "pipeline.h"
+#include "pixelOps.h"
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <exception>
+
+/************************************************************************
+ *             Constants
+ ***********************************************************************/
+ /*!
+  * @brief buffers in flight, three so one can be read, one computed and
+  *        one written at the same time
+  */
+const int PIPELINE_SLOTS = 3;
+
+/*!
+ * @brief rows in one strip of a single image
+ */
+const int PIPELINE_STRIP_ROWS = 64;
+
+/*!
+ * @brief times a stage tries again before it sleeps while waiting
+ */
+const int PIPELINE_SPINS = 64;
+
+
+/************************************************************************
+ *             Structure
+ ***********************************************************************/
+ /**
+ * @brief A fixed size ring of slot numbers with one thread pushing and
+ *        one thread popping. The two ends only share two atomic
+ *        positions so no lock is taken.
+ */
+struct spscQueue
+{
+    /**
+    * @brief the ring, one entry larger than the capacity so a full ring
+    *        can be told from an empty one
+    */
+    vector<int> items;
+    /**
+    * @brief the next entry to pop, only changed by the popping thread
+    */
+    atomic<size_t> head;
+    /**
+    * @brief the next entry to push, only changed by the pushing thread
+    */
+    atomic<size_t> tail;
+
+    /**
+    * @brief makes an empty ring holding up to capacity slot numbers
+    */
+    spscQueue(int capacity) : items(size_t(capacity) + 1), head(0), tail(0)
+    {
+    }
+
+    /**
+    * @brief waits while the ring is full, then adds a slot number
+    */
+    void push(int value)
+    {
+        size_t at = tail.load(memory_order_relaxed);
+        size_t next = (at + 1) % items.size();
+        int tries = 0;
+
+        while (next == head.load(memory_order_acquire))
+        {
+            pause(tries);
+        }
+        items[at] = value;
+        tail.store(next, memory_order_release);
+    }
+
+    /**
+    * @brief waits while the ring is empty, then takes a slot number
+    */
+    int pop()
+    {
+        size_t at = head.load(memory_order_relaxed);
+        int value, tries = 0;
+
+        while (at == tail.load(memory_order_acquire))
+        {
+            pause(tries);
+        }
+        value = items[at];
+        head.store((at + 1) % items.size(), memory_order_release);
+        return value;
+    }
+
+    /**
+    * @brief gives up the processor while waiting, and sleeps once the
+    *        wait is long so a stage waiting on I/O does not take a core
+    */
+    static void pause(int& tries)
+    {
+        if (++tries < PIPELINE_SPINS)
+        {
+            this_thread::yield();
+        }
+        else
+        {
+            this_thread::sleep_for(chrono::microseconds(50));
+        }
+    }
+};
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function makes sure the arrays of the slot can hold rows X cols
+ * pixels. Arrays that are large enough are kept, so a slot used for
+ * items of the same size allocates only once. Arrays an option left
+ * shared, like the edges option does, are made again.
+ *
+ * @param[in, out] slot - the slot
+ * @param[in] rows - the rows needed
+ * @param[in] cols - the columns needed
+ *
+ * @par Example:
+   @verbatim
+
+   pipelineSlot slot;
+   reserveSlot(slot, 2160, 3840);
+   //slot.img can hold a 4K frame
+
+   @endverbatim
+
+ ***********************************************************************/
+void reserveSlot(pipelineSlot& slot, int rows, int cols)
+{
+    if (slot.img.redGray != nullptr && slot.img.green != slot.img.redGray &&
+        rows <= slot.allocRows && cols <= slot.allocCols)
+    {
+        slot.img.rows = rows;
+        slot.img.cols = cols;
+        return;
+    }
+
+    releaseSlot(slot);
+    slot.img.redGray = createArrays(rows, cols);
+    slot.img.green = createArrays(rows, cols);
+    slot.img.blue = createArrays(rows, cols);
+    slot.img.rows = slot.allocRows = rows;
+    slot.img.cols = slot.allocCols = cols;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function deletes the arrays of the slot and its spare arrays. An
+ * operation can put new arrays of a different size in img, those are
+ * deleted with the size of img.
+ *
+ * @param[in, out] slot - the slot
+ *
+ * @par Example:
+   @verbatim
+
+   releaseSlot(slot);
+
+   @endverbatim
+
+ ***********************************************************************/
+void releaseSlot(pipelineSlot& slot)
+{
+    int rows = max(slot.img.rows, slot.allocRows);
+
+    clearArray(slot.img.redGray, rows);
+    clearArray(slot.img.green, rows);
+    clearArray(slot.img.blue, rows);
+    slot.img.rows = slot.img.cols = 0;
+    slot.allocRows = slot.allocCols = 0;
+
+    rows = max(slot.spare.rows, slot.spareRows);
+    clearArray(slot.spare.redGray, rows);
+    clearArray(slot.spare.green, rows);
+    clearArray(slot.spare.blue, rows);
+    slot.spare.rows = slot.spare.cols = 0;
+    slot.spareRows = slot.spareCols = 0;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function runs a three stage pipeline. A reader thread fills free
+ * slots with read, worker threads run work on them and the calling
+ * thread writes them with write, so reading, computing and writing of
+ * different items happen at the same time. The stages are joined by
+ * lock free single producer queues. Item n goes to worker n % workers
+ * and the writer takes the items back in the same order, so the output
+ * is always in the order of the input. Written slots go back to the
+ * reader, so only slots buffers are ever in flight. The pipeline ends
+ * when read returns false. An item that fails is reported on report and
+ * is not written.
+ *
+ * @param[in] slots - the number of buffers, at least workers + 2
+ * @param[in] workers - the number of compute threads
+ * @param[in] read - fills a slot, returns false when there is no more
+ * @param[in] work - computes a slot
+ * @param[in] write - writes a slot
+ * @param[out] report - the stream errors are printed on
+ *
+ * @par Example:
+   @verbatim
+
+   runPipeline(3, 1, readStrip, computeStrip, writeStrip);
+
+   @endverbatim
+
+ ***********************************************************************/
+void runPipeline(int slots, int workers, const function<bool(pipelineSlot&)>& read,
+    const function<void(pipelineSlot&)>& work,
+    const function<void(pipelineSlot&)>& write, ostream& report)
+{
+    int i, s;
+    long long n;
+    vector<pipelineSlot> buffers;
+    vector<unique_ptr<spscQueue>> toWorker, toWriter;
+    spscQueue freeSlots(max(slots, workers + 2));
+    vector<thread> threads;
+
+    workers = max(workers, 1);
+    slots = max(slots, workers + 2);
+    buffers.resize(slots);
+    for (i = 0; i < workers; i++)
+    {
+        toWorker.push_back(unique_ptr<spscQueue>(new spscQueue(slots)));
+        toWriter.push_back(unique_ptr<spscQueue>(new spscQueue(slots)));
+    }
+    for (s = 0; s < slots; s++)
+    {
+        freeSlots.push(s);
+    }
+
+    //reader
+    threads.push_back(thread([&]()
+    {
+        long long count = 0;
+        int slot, w;
+
+        while (true)
+        {
+            slot = freeSlots.pop();
+            buffers[slot].index = count;
+            buffers[slot].error.clear();
+            try
+            {
+                if (!read(buffers[slot]))
+                {
+                    break;
+                }
+            }
+            catch (exception& problem)
+            {
+                buffers[slot].error = problem.what();
+            }
+            toWorker[count % workers]->push(slot);
+            count++;
+        }
+
+        //tell every worker, and through it the writer, that it is over
+        for (w = 0; w < workers; w++)
+        {
+            toWorker[w]->push(-1);
+        }
+    }));
+
+    //workers
+    for (i = 0; i < workers; i++)
+    {
+        threads.push_back(thread([&, i]()
+        {
+            int slot;
+
+            while ((slot = toWorker[i]->pop()) >= 0)
+            {
+                if (buffers[slot].error.empty())
+                {
+                    try
+                    {
+                        work(buffers[slot]);
+                    }
+                    catch (exception& problem)
+                    {
+                        buffers[slot].error = problem.what();
+                    }
+                }
+                toWriter[i]->push(slot);
+            }
+            toWriter[i]->push(-1);
+        }));
+    }
+
+    //the writer takes the items back in order
+    for (n = 0; (s = toWriter[n % workers]->pop()) >= 0; n++)
+    {
+        try
+        {
+            if (buffers[s].error.empty())
+            {
+                write(buffers[s]);
+            }
+        }
+        catch (exception& problem)
+        {
+            buffers[s].error = problem.what();
+        }
+        if (!buffers[s].error.empty())
+        {
+            report << (buffers[s].input.empty() ? "item " + to_string(n) : buffers[s].input)
+                << ": " << buffers[s].error << endl;
+        }
+        freeSlots.push(s);
+    }
+
+    //the other workers still have their end marker queued
+    for (i = 1; i < workers; i++)
+    {
+        while (toWriter[(n + i) % workers]->pop() >= 0)
+        {
+        }
+    }
+
+    for (i = 0; i < int(threads.size()); i++)
+    {
+        threads[i].join();
+    }
+    for (s = 0; s < slots; s++)
+    {
+        releaseSlot(buffers[s]);
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function tells if an option works on every pixel by itself, so
+ * an image can be handled a strip of rows at a time.
+ *
+ * @param[in] option - the image manupulation option
+ *
+ * @returns true - if the option can be run on strips
+ *
+ * @par Example:
+   @verbatim
+
+   bool strips = isStripOption("--sepia");
+   //strips is true
+
+   @endverbatim
+
+ ***********************************************************************/
+static bool isStripOption(string option)
+{
+    return option == "" || option == "--sepia" || option == "--grayscale" ||
+        option.compare(0, 7, "--tone=") == 0 || option.compare(0, 8, "--chain=") == 0;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function handles a single P5 or P6 image a strip of rows at a time
+ * when the option works on every pixel by itself. One thread reads the
+ * next strip while the option runs on the strip before it and a third
+ * strip is written, with three strip buffers in flight, so the time is
+ * close to the longer of the I/O and the compute instead of their sum.
+ * The whole image is never held in memory. The first strip that fails
+ * stops the reading, nothing after it is written and its error is thrown
+ * once every stage has finished. Other images, options and a
+ * QOI or planar output return false with the stream back at the start so
+ * the caller can handle them the usual way.
+ *
+ * @param[in, out] fin - the input stream
+ * @param[out] fout - the output stream
+ * @param[in] option - the image manupulation option, can be empty
+ * @param[in] type - --binary or --ascii
+ *
+ * @returns true - if the image was handled in strips
+ *
+ * @par Example:
+   @verbatim
+
+   if (!pipeStrips(fin, fout, "--sepia", "--binary"))
+   {
+       //read the whole image
+   }
+
+   @endverbatim
+
+ ***********************************************************************/
+bool pipeStrips(istream& fin, ostream& fout, string option, string type)
+{
+    image header{}, probe{};
+    int maxPixel, next = 0;
+    bool gray = isGrayChain(option);
+    bool ascii = type == "--ascii";
+    atomic<bool> ended(false);
+    exception_ptr failure;
+    mutex lock;
+
+    //keep the first error of any stage and stop the image
+    auto fail = [&]()
+    {
+        lock_guard<mutex> guard(lock);
+        if (!failure)
+        {
+            failure = current_exception();
+        }
+        ended = true;
+    };
+
+    if (!isStripOption(option) || (type != "--binary" && type != "--ascii"))
+    {
+        return false;
+    }
+
+    //a bad option throws here on an empty image, before anything is written
+    if (option != "")
+    {
+        handleOptions(option, probe);
+    }
+
+    readHeader(fin, header, maxPixel);
+    if (header.magicNumber != "P5" && header.magicNumber != "P6")
+    {
+        fin.clear();
+        fin.seekg(0, ios::beg);
+        return false;
+    }
+
+    writeHeader(fout, gray ? (ascii ? "P2" : "P5") : (ascii ? "P3" : "P6"), header, maxPixel);
+
+    runPipeline(PIPELINE_SLOTS, 1, [&](pipelineSlot& slot)
+    {
+        int rows = min(PIPELINE_STRIP_ROWS, header.rows - next);
+
+        if (ended || rows <= 0)
+        {
+            return false;
+        }
+        next += rows;
+        try
+        {
+            reserveSlot(slot, rows, header.cols);
+            slot.img.magicNumber = header.magicNumber;
+            if (header.magicNumber == "P6")
+            {
+                readFileP6(fin, slot.img);
+            }
+            else
+            {
+                readFileP5(fin, slot.img);
+            }
+        }
+        catch (...)
+        {
+            fail();
+            return false;
+        }
+        return true;
+    },
+    [&](pipelineSlot& slot)
+    {
+        try
+        {
+            if (!ended && option != "")
+            {
+                handleOptions(option, slot.img);
+            }
+        }
+        catch (...)
+        {
+            fail();
+        }
+    },
+    [&](pipelineSlot& slot)
+    {
+        //a strip after a failed one is not written
+        try
+        {
+            if (!ended)
+            {
+                writeRaster(fout, slot.img, gray ? 1 : 3, ascii);
+            }
+        }
+        catch (...)
+        {
+            fail();
+        }
+    });
+
+    if (failure)
+    {
+        rethrow_exception(failure);
+    }
+    return true;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function handles a batch of images with the same option. One
+ * thread reads the next image while the option runs on the image before
+ * it and the one before that is written, so the disk and the processor
+ * are busy at the same time. Each image is written to outdir with the
+ * name of the input and a .ppm or .pgm extension. An image that fails
+ * prints its error and the batch goes on.
+ *
+ * @param[in] option - the image manupulation option, - for none
+ * @param[in] type - --binary, --ascii or --qoi
+ * @param[in] outdir - the directory of the outputs
+ * @param[in] inputs - the paths of the input images
+ *
+ * @par Example:
+   @verbatim
+
+   runBatch("--sepia", "--binary", "out", { "a.ppm", "b.ppm" });
+   //writes out/a.ppm and out/b.ppm
+
+   @endverbatim
+
+ ***********************************************************************/
+void runBatch(string option, string type, string outdir, const vector<string>& inputs)
+{
+    size_t next = 0;
+    string extension = outputExtension(option, type);
+
+    if (!isOutputType(type))
+    {
+        throw invalid_argument("Invalid output type: " + type);
+    }
+    if (option == "-")
+    {
+        option = "";
+    }
+
+    runPipeline(PIPELINE_SLOTS, 1, [&](pipelineSlot& slot)
+    {
+        ifstream fin;
+        string name;
+
+        if (next >= inputs.size())
+        {
+            return false;
+        }
+        slot.input = inputs[next++];
+
+        //the output is the name of the input without its directory
+        name = slot.input.substr(slot.input.find_last_of("/\\") + 1);
+        name = name.substr(0, name.rfind('.'));
+        slot.output = outdir + "/" + name + extension;
+
+        //every image can have its own size
+        releaseSlot(slot);
+        isBinFileOpen(slot.input, fin);
+
+        //a thumbnail or a tone option is done while reading
+        if (option.compare(0, 12, "--thumbnail=") == 0 ||
+            option.compare(0, 7, "--tone=") == 0)
+        {
+            processImage(fin, option, slot.img, slot.maxPixel);
+        }
+        else
+        {
+            readFile(fin, slot.img, slot.maxPixel);
+        }
+        return true;
+    },
+    [&](pipelineSlot& slot)
+    {
+        if (option != "" && option.compare(0, 12, "--thumbnail=") != 0 &&
+            option.compare(0, 7, "--tone=") != 0)
+        {
+            handleOptions(option, slot.img);
+        }
+    },
+    [&](pipelineSlot& slot)
+    {
+        ofstream fout;
+
+        isBinOutputOpen(slot.output, fout);
+        handleOutput(option, type, slot.img, fout, slot.maxPixel);
+    });
+}
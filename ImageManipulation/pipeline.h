@@ -0,0 +1,79 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Read, compute and write stages that run at the same time
+ ***********************************************************************/
+#include "netPBM.h"
+
+#ifndef _PIPELINE_H_
+#define  _PIPELINE_H_
+
+/************************************************************************
+ *             Structure
+ ***********************************************************************/
+ /**
+ * @brief One buffer moving through the pipeline. It holds a whole image,
+ *        a strip of rows of an image or a frame of a stream. The arrays
+ *        stay with the slot so they are reused by the next item.
+ */
+struct pipelineSlot
+{
+    /**
+    * @brief the image, strip or frame
+    */
+    image img{};
+    /**
+    * @brief the maximum pixel value of the image
+    */
+    int maxPixel = 255;
+    /**
+    * @brief the number of rows allocated in the arrays of img
+    */
+    int allocRows = 0;
+    /**
+    * @brief the number of columns allocated in the arrays of img
+    */
+    int allocCols = 0;
+    /**
+    * @brief a second set of arrays an operation can write into, so a
+    *        frame that changes shape does not allocate
+    */
+    image spare{};
+    /**
+    * @brief the number of rows allocated in the arrays of spare
+    */
+    int spareRows = 0;
+    /**
+    * @brief the number of columns allocated in the arrays of spare
+    */
+    int spareCols = 0;
+    /**
+    * @brief the position of the item in the input, items are written in
+    *        this order
+    */
+    long long index = 0;
+    /**
+    * @brief the path the item was read from
+    */
+    string input;
+    /**
+    * @brief the path the item is written to
+    */
+    string output;
+    /**
+    * @brief what went wrong with the item, empty if nothing did
+    */
+    string error;
+};
+
+
+/************************************************************************
+ *               Prototypes
+ ***********************************************************************/
+void runPipeline(int slots, int workers, const function<bool(pipelineSlot&)>& read,
+    const function<void(pipelineSlot&)>& work,
+    const function<void(pipelineSlot&)>& write, ostream& report = cout);
+void reserveSlot(pipelineSlot& slot, int rows, int cols);
+void releaseSlot(pipelineSlot& slot);
+
+#endif
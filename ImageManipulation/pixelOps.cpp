@@ -0,0 +1,598 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Chains of per pixel operations read from the command line
+ ***********************************************************************/
+#include "pixelOps.h"
+#include <cmath>
+#include <cctype>
+
+/************************************************************************
+ *             Constants
+ ***********************************************************************/
+ /*!
+  * @brief number of pixels loaded at a time by a command line chain,
+  *        small enough that the block stays in the L1 cache
+  */
+const int CHAIN_BLOCK = 256;
+
+/*!
+ * @brief the longest chain joined into one pointChain at compile time,
+ *        every pair of steps is its own loop
+ */
+const int CHAIN_FUSED = 2;
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function runs one operation over a block of CHAIN_BLOCK pixels.
+ * The type of the operation and the number of pixels are known here so
+ * the loop is built for them and can be vectorized.
+ *
+ * @param[in] op - the operation
+ * @param[in, out] r - the red values of the block
+ * @param[in, out] g - the green values of the block
+ * @param[in, out] b - the blue values of the block
+ *
+ * @par Example:
+   @verbatim
+
+   int r[CHAIN_BLOCK], g[CHAIN_BLOCK], b[CHAIN_BLOCK];
+   runBlock(sepiaOp(), r, g, b);
+
+   @endverbatim
+
+ ***********************************************************************/
+template <class Op>
+static void runBlock(const Op& op, int* r, int* g, int* b)
+{
+    int k;
+
+    for (k = 0; k < CHAIN_BLOCK; k++)
+    {
+        op(r[k], g[k], b[k]);
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function builds the fixed point matrix between RGB and YCbCr.
+ * The value is the standard, 601 (the default, as in JPEG) or 709, and
+ * the range, full (the default) or limited, split by colons, like
+ * 709:limited. Full range uses 0 to 255 for all three, limited range
+ * 16 to 235 for Y and 16 to 240 for Cb and Cr. The inverse matrix turns
+ * YCbCr back into RGB. The matrix is worked out in doubles and rounded
+ * to 16 bits after the point once.
+ *
+ * @param[in] value - the standard and range
+ * @param[in] inverse - true for YCbCr to RGB
+ * @param[out] op - the conversion
+ *
+ * @returns true - if the value could be read
+ *
+ * @par Example:
+   @verbatim
+
+   fixedMatrixOp op;
+   ycbcrMatrix("709:limited", false, op);
+   applyPointOps(img, op);
+
+   @endverbatim
+
+ ***********************************************************************/
+bool ycbcrMatrix(string value, bool inverse, fixedMatrixOp& op)
+{
+    double kr = 0.299, kb = 0.114, kg;
+    double m[9], n[9], offset[3] = { 0.0, 128.0, 128.0 }, back[3];
+    double det, range[3] = { 1.0, 1.0, 1.0 };
+    size_t start, end;
+    string part;
+    int k;
+
+    for (start = 0; start < value.size(); start = end + 1)
+    {
+        end = value.find(':', start);
+        if (end == string::npos)
+        {
+            end = value.size();
+        }
+        part = value.substr(start, end - start);
+        if (part == "709")
+        {
+            kr = 0.2126;
+            kb = 0.0722;
+        }
+        else if (part == "limited")
+        {
+            range[0] = 219.0 / 255.0;
+            range[1] = range[2] = 224.0 / 255.0;
+            offset[0] = 16.0;
+        }
+        else if (part != "601" && part != "full")
+        {
+            return false;
+        }
+    }
+
+    //Y, Cb and Cr rows of RGB to YCbCr
+    kg = 1.0 - kr - kb;
+    m[0] = kr;
+    m[1] = kg;
+    m[2] = kb;
+    m[3] = -kr / (2.0 * (1.0 - kb));
+    m[4] = -kg / (2.0 * (1.0 - kb));
+    m[5] = 0.5;
+    m[6] = 0.5;
+    m[7] = -kg / (2.0 * (1.0 - kr));
+    m[8] = -kb / (2.0 * (1.0 - kr));
+    for (k = 0; k < 9; k++)
+    {
+        m[k] *= range[k / 3];
+    }
+
+    //the inverse is the inverse matrix and the offset taken off first
+    if (inverse)
+    {
+        det = m[0] * (m[4] * m[8] - m[5] * m[7]) - m[1] * (m[3] * m[8] - m[5] * m[6]) +
+            m[2] * (m[3] * m[7] - m[4] * m[6]);
+        n[0] = (m[4] * m[8] - m[5] * m[7]) / det;
+        n[1] = (m[2] * m[7] - m[1] * m[8]) / det;
+        n[2] = (m[1] * m[5] - m[2] * m[4]) / det;
+        n[3] = (m[5] * m[6] - m[3] * m[8]) / det;
+        n[4] = (m[0] * m[8] - m[2] * m[6]) / det;
+        n[5] = (m[2] * m[3] - m[0] * m[5]) / det;
+        n[6] = (m[3] * m[7] - m[4] * m[6]) / det;
+        n[7] = (m[1] * m[6] - m[0] * m[7]) / det;
+        n[8] = (m[0] * m[4] - m[1] * m[3]) / det;
+        for (k = 0; k < 3; k++)
+        {
+            back[k] = -(n[k * 3] * offset[0] + n[k * 3 + 1] * offset[1] + n[k * 3 + 2] * offset[2]);
+        }
+        for (k = 0; k < 9; k++)
+        {
+            m[k] = n[k];
+        }
+        for (k = 0; k < 3; k++)
+        {
+            offset[k] = back[k];
+        }
+    }
+
+    for (k = 0; k < 9; k++)
+    {
+        op.m[k] = int(lround(m[k] * 65536.0));
+    }
+    for (k = 0; k < 3; k++)
+    {
+        op.add[k] = int(lround(offset[k] * 65536.0)) + (1 << 15);
+    }
+    return true;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function reads a chain option. The option looks like
+ * --chain=sepia+matrix=1,0,0,0,1,0,0,0,1+gamma=1.2+grayscale
+ * The steps are split by a plus. A step is sepia, grayscale, a 3 X 3
+ * color matrix given row by row, or any of the tone operations. Tone
+ * operations next to each other are joined into one look up table. The
+ * color space steps ycbcr[=STANDARD[:RANGE]] and hsv, and fromycbcr and
+ * fromhsv to go back to RGB, leave the new values in the red, green and
+ * blue arrays in that order.
+ *
+ * @param[in] option - the full option string
+ * @param[out] steps - the steps of the chain
+ *
+ * @returns true - if every step could be read
+ *
+ * @par Example:
+   @verbatim
+
+   vector<pointStep> steps;
+   parseChain("--chain=sepia+brightness=10+contrast=1.2", steps);
+   //steps has a sepia step and one look up table step
+
+   @endverbatim
+
+ ***********************************************************************/
+bool parseChain(string option, vector<pointStep>& steps)
+{
+    size_t start, stop, equal;
+    int k;
+    string text = option.substr(option.find('=') + 1);
+    string op, name, value;
+    pointStep step;
+    pixel map[256];
+    const char* number;
+    char* end;
+
+    steps.clear();
+    for (start = 0; start <= text.size(); start = stop + 1)
+    {
+        //one step up to the next plus
+        stop = text.find('+', start);
+        if (stop == string::npos)
+        {
+            stop = text.size();
+        }
+        op = text.substr(start, stop - start);
+        equal = op.find('=');
+        name = op.substr(0, equal);
+        value = equal == string::npos ? "" : op.substr(equal + 1);
+
+        if (name == "sepia" || name == "grayscale")
+        {
+            step.kind = name == "sepia" ? STEP_SEPIA : STEP_GRAY;
+            steps.push_back(step);
+        }
+        else if (name == "matrix")
+        {
+            //nine numbers split by commas, nothing else
+            step.kind = STEP_MATRIX;
+            number = value.c_str();
+            for (k = 0; k < 9; k++)
+            {
+                if (isspace((unsigned char)*number))
+                {
+                    return false;
+                }
+                step.matrix.m[k] = strtod(number, &end);
+                if (end == number || !std::isfinite(step.matrix.m[k]) ||
+                    *end != (k < 8 ? ',' : '\0'))
+                {
+                    return false;
+                }
+                number = end + 1;
+            }
+            steps.push_back(step);
+        }
+        else if (name == "ycbcr" || name == "fromycbcr")
+        {
+            step.kind = STEP_FIXED;
+            if (!ycbcrMatrix(value, name == "fromycbcr", step.fixed))
+            {
+                return false;
+            }
+            steps.push_back(step);
+        }
+        else if ((name == "hsv" || name == "fromhsv") && equal == string::npos)
+        {
+            step.kind = name == "hsv" ? STEP_HSV : STEP_FROMHSV;
+            steps.push_back(step);
+        }
+        else if (toneMap(name, value, map))
+        {
+            //join with the table before it if there is one
+            if (steps.empty() || steps.back().kind != STEP_LUT)
+            {
+                step.kind = STEP_LUT;
+                lutIdentity(step.lut);
+                steps.push_back(step);
+            }
+            lutCompose(steps.back().lut, map, -1);
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function runs the first step of a chain and then the second one
+ * as one pointChain, so the loop is built for the two operations and a
+ * pixel goes through both in registers.
+ *
+ * @param[in, out] img - the structure where the data of the image is stored
+ * @param[in] first - the operation of the first step
+ * @param[in] second - the second step
+ *
+ * @par Example:
+   @verbatim
+
+   applySecond(img, sepiaOp(), steps[1]);
+
+   @endverbatim
+
+ ***********************************************************************/
+template <class First>
+static void applySecond(image& img, const First& first, const pointStep& second)
+{
+    lutOp table;
+
+    if (second.kind == STEP_SEPIA)
+    {
+        applyPointOps(img, makeChain(first, sepiaOp()));
+    }
+    else if (second.kind == STEP_GRAY)
+    {
+        applyPointOps(img, makeChain(first, grayOp()));
+    }
+    else if (second.kind == STEP_MATRIX)
+    {
+        applyPointOps(img, makeChain(first, second.matrix));
+    }
+    else if (second.kind == STEP_FIXED)
+    {
+        applyPointOps(img, makeChain(first, second.fixed));
+    }
+    else if (second.kind == STEP_HSV)
+    {
+        applyPointOps(img, makeChain(first, hsvOp()));
+    }
+    else if (second.kind == STEP_FROMHSV)
+    {
+        applyPointOps(img, makeChain(first, fromHsvOp()));
+    }
+    else
+    {
+        table.lut = &second.lut;
+        applyPointOps(img, makeChain(first, table));
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function runs a chain of one step with applyPointOps, or hands
+ * the first step of a chain of two to applySecond.
+ *
+ * @param[in, out] img - the structure where the data of the image is stored
+ * @param[in] first - the operation of the first step
+ * @param[in] steps - the steps of the chain, one or two
+ *
+ * @par Example:
+   @verbatim
+
+   applyFirst(img, sepiaOp(), steps);
+
+   @endverbatim
+
+ ***********************************************************************/
+template <class First>
+static void applyFirst(image& img, const First& first, const vector<pointStep>& steps)
+{
+    if (steps.size() == 1)
+    {
+        applyPointOps(img, first);
+    }
+    else
+    {
+        applySecond(img, first, steps[1]);
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function runs a chain of up to CHAIN_FUSED steps as one loop
+ * made at compile time. Every kind of first step is paired with every
+ * kind of second step, so the loop for the chain is picked once for
+ * the whole image and not for every block.
+ *
+ * @param[in, out] img - the structure where the data of the image is stored
+ * @param[in] steps - the steps of the chain, one or two
+ *
+ * @par Example:
+   @verbatim
+
+   parseChain("--chain=ycbcr+fromycbcr", steps);
+   applyFused(img, steps);
+
+   @endverbatim
+
+ ***********************************************************************/
+static void applyFused(image& img, const vector<pointStep>& steps)
+{
+    lutOp table;
+
+    if (steps[0].kind == STEP_SEPIA)
+    {
+        applyFirst(img, sepiaOp(), steps);
+    }
+    else if (steps[0].kind == STEP_GRAY)
+    {
+        applyFirst(img, grayOp(), steps);
+    }
+    else if (steps[0].kind == STEP_MATRIX)
+    {
+        applyFirst(img, steps[0].matrix, steps);
+    }
+    else if (steps[0].kind == STEP_FIXED)
+    {
+        applyFirst(img, steps[0].fixed, steps);
+    }
+    else if (steps[0].kind == STEP_HSV)
+    {
+        applyFirst(img, hsvOp(), steps);
+    }
+    else if (steps[0].kind == STEP_FROMHSV)
+    {
+        applyFirst(img, fromHsvOp(), steps);
+    }
+    else
+    {
+        table.lut = &steps[0].lut;
+        applyFirst(img, table, steps);
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function runs a chain read from the command line over the image
+ * in one pass. The order of the steps is only known at run time, so each
+ * thread loads CHAIN_BLOCK pixels of a row into small arrays, runs every
+ * step over the block and stores the block back. The block stays in the
+ * L1 cache between steps so the image is still read and written once.
+ * A short block at the end of a row is filled up with 0 so every step
+ * runs over a whole block, a loop the compiler can vectorize.
+ * A chain of up to CHAIN_FUSED steps goes to applyFused instead, where
+ * the steps are one pointChain and never leave the registers.
+ *
+ * @param[in, out] img - the structure where the data of the image is stored
+ * @param[in] steps - the steps of the chain
+ *
+ * @par Example:
+   @verbatim
+
+   image img;
+   vector<pointStep> steps;
+   parseChain("--chain=sepia+grayscale", steps);
+
+   applyChain(img, steps);
+
+   @endverbatim
+
+ ***********************************************************************/
+void applyChain(image& img, vector<pointStep>& steps)
+{
+    unshareImage(img);
+
+    //short chains are one loop made at compile time
+    if (steps.size() <= size_t(CHAIN_FUSED))
+    {
+        applyFused(img, steps);
+        return;
+    }
+
+    parallelFor(img.rows, [&](int first, int last)
+    {
+        int i, j, k, n;
+        size_t s;
+        int r[CHAIN_BLOCK], g[CHAIN_BLOCK], b[CHAIN_BLOCK];
+        lutOp rowTable;
+        hsvOp hsv;
+        pixel* red;
+        pixel* green;
+        pixel* blue;
+
+        for (i = first; i < last; i++)
+        {
+            red = img.redGray[i];
+            green = img.green[i];
+            blue = img.blue[i];
+            for (j = 0; j < img.cols; j += CHAIN_BLOCK)
+            {
+                n = min(CHAIN_BLOCK, img.cols - j);
+
+                //load the block, the end of a short block is 0
+                for (k = 0; k < n; k++)
+                {
+                    r[k] = red[j + k];
+                    g[k] = green[j + k];
+                    b[k] = blue[j + k];
+                }
+                for (; k < CHAIN_BLOCK; k++)
+                {
+                    r[k] = g[k] = b[k] = 0;
+                }
+
+                //run every step over the block
+                for (s = 0; s < steps.size(); s++)
+                {
+                    if (steps[s].kind == STEP_SEPIA)
+                    {
+                        runBlock(sepiaOp(), r, g, b);
+                    }
+                    else if (steps[s].kind == STEP_GRAY)
+                    {
+                        runBlock(grayOp(), r, g, b);
+                    }
+                    else if (steps[s].kind == STEP_MATRIX)
+                    {
+                        runBlock(steps[s].matrix, r, g, b);
+                    }
+                    else if (steps[s].kind == STEP_FIXED)
+                    {
+                        runBlock(steps[s].fixed, r, g, b);
+                    }
+                    else if (steps[s].kind == STEP_HSV)
+                    {
+                        runBlock(hsv, r, g, b);
+                    }
+                    else if (steps[s].kind == STEP_FROMHSV)
+                    {
+                        runBlock(fromHsvOp(), r, g, b);
+                    }
+                    else
+                    {
+                        rowTable.lut = &steps[s].lut;
+                        runBlock(rowTable, r, g, b);
+                    }
+                }
+
+                //store the block, one array per loop so they can not overlap
+                for (k = 0; k < n; k++)
+                {
+                    red[j + k] = pixel(r[k]);
+                }
+                for (k = 0; k < n; k++)
+                {
+                    green[j + k] = pixel(g[k]);
+                }
+                for (k = 0; k < n; k++)
+                {
+                    blue[j + k] = pixel(b[k]);
+                }
+            }
+        }
+    });
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function tells if an option leaves a gray image, so the output
+ * is written as a .pgm with the magic number P2 or P5. That is the
+ * grayscale option, any chain that ends with grayscale, the edges
+ * option and quantizing to levels of gray.
+ *
+ * @param[in] option - the image manupulation option
+ *
+ * @returns true - if the output is gray
+ *
+ * @par Example:
+   @verbatim
+
+   bool gray = isGrayChain("--chain=sepia+grayscale");
+   //gray is true
+
+   @endverbatim
+
+ ***********************************************************************/
+bool isGrayChain(string option)
+{
+    string last = "+grayscale";
+
+    if (option == "--grayscale" || option == "--chain=grayscale" ||
+        option.compare(0, 7, "--edges") == 0 || option.compare(0, 15, "--quantize=gray") == 0)
+    {
+        return true;
+    }
+
+    return option.compare(0, 8, "--chain=") == 0 && option.size() > last.size() &&
+        option.compare(option.size() - last.size(), last.size(), last) == 0;
+}
@@ -0,0 +1,476 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Per pixel operations that can be joined into one loop
+ ***********************************************************************/
+#include "netPBM.h"
+
+#ifndef _PIXELOPS_H_
+#define  _PIXELOPS_H_
+
+/************************************************************************
+ *             Constants
+ ***********************************************************************/
+ /*!
+  * @brief pixels of a row loaded into local arrays at a time by
+  *        applyPointOps, a fixed count the compiler can vectorize
+  */
+const int POINT_BLOCK = 64;
+
+
+/************************************************************************
+ *             Typedef
+ ***********************************************************************/
+ /*!
+  * @brief the operation of one step of a command line chain
+  */
+enum stepKind
+{
+    STEP_GRAY,      /*!< grayOp */
+    STEP_SEPIA,     /*!< sepiaOp */
+    STEP_MATRIX,    /*!< matrixOp */
+    STEP_FIXED,     /*!< fixedMatrixOp, YCbCr and back */
+    STEP_HSV,       /*!< hsvOp */
+    STEP_FROMHSV,   /*!< fromHsvOp */
+    STEP_LUT        /*!< lutOp, the tone steps joined into one table */
+};
+
+
+/************************************************************************
+ *             Functions
+ ***********************************************************************/
+ /** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function divides by 255 with rounding, using only a shift and an
+ * add so it works in 16 bit lanes for any value up to 255 X 255.
+ *
+ * @param[in] value - the value to divide
+ *
+ * @returns value / 255 rounded to the nearest integer
+ *
+ * @par Example:
+   @verbatim
+
+   unsigned v = divide255(200 * 128);
+   //v is 100
+
+   @endverbatim
+
+ ***********************************************************************/
+inline unsigned divide255(unsigned value)
+{
+    value += 128;
+    return (value + (value >> 8)) >> 8;
+}
+
+
+/************************************************************************
+ *             Functors
+ ***********************************************************************/
+ /**
+ * @brief Turns a pixel gray, the same weights as grayScale
+ */
+struct grayOp
+{
+    /**
+    * @brief sets all three values to the gray value of the pixel
+    */
+    inline void operator()(int& r, int& g, int& b) const
+    {
+        int value = int(0.3 * r + 0.6 * g + 0.1 * b);
+        r = value;
+        g = value;
+        b = value;
+    }
+};
+
+/**
+* @brief Turns a pixel sepia, the same weights as sepia
+*/
+struct sepiaOp
+{
+    /**
+    * @brief sets the three values to their sepia values, at most 255
+    */
+    inline void operator()(int& r, int& g, int& b) const
+    {
+        int tempRedGray = int(0.393 * r + 0.769 * g + 0.189 * b);
+        int tempGreen = int(0.349 * r + 0.686 * g + 0.168 * b);
+        int tempBlue = int(0.272 * r + 0.534 * g + 0.131 * b);
+
+        r = tempRedGray > 255 ? 255 : tempRedGray;
+        g = tempGreen > 255 ? 255 : tempGreen;
+        b = tempBlue > 255 ? 255 : tempBlue;
+    }
+};
+
+/**
+* @brief Multiplies a pixel by a 3 X 3 color matrix
+*/
+struct matrixOp
+{
+    /**
+    * @brief the matrix row by row, the first row gives the new red
+    */
+    double m[9];
+
+    /**
+    * @brief sets the three values to the matrix times the pixel, rounded
+    *        and kept between 0 and 255
+    */
+    inline void operator()(int& r, int& g, int& b) const
+    {
+        int red = int(m[0] * r + m[1] * g + m[2] * b + 0.5);
+        int green = int(m[3] * r + m[4] * g + m[5] * b + 0.5);
+        int blue = int(m[6] * r + m[7] * g + m[8] * b + 0.5);
+
+        r = red < 0 ? 0 : (red > 255 ? 255 : red);
+        g = green < 0 ? 0 : (green > 255 ? 255 : green);
+        b = blue < 0 ? 0 : (blue > 255 ? 255 : blue);
+    }
+};
+
+/**
+* @brief Multiplies a pixel by a 3 X 3 matrix and adds an offset in fixed
+*        point with 16 bits after the point, like RGB to YCbCr
+*/
+struct fixedMatrixOp
+{
+    /**
+    * @brief the matrix row by row times 65536
+    */
+    int m[9];
+    /**
+    * @brief the offset of each row times 65536, plus one half to round
+    */
+    int add[3];
+
+    /**
+    * @brief sets the three values to the matrix times the pixel plus the
+    *        offset, kept between 0 and 255
+    */
+    inline void operator()(int& r, int& g, int& b) const
+    {
+        int first = (m[0] * r + m[1] * g + m[2] * b + add[0]) >> 16;
+        int second = (m[3] * r + m[4] * g + m[5] * b + add[1]) >> 16;
+        int third = (m[6] * r + m[7] * g + m[8] * b + add[2]) >> 16;
+
+        r = first < 0 ? 0 : (first > 255 ? 255 : first);
+        g = second < 0 ? 0 : (second > 255 ? 255 : second);
+        b = third < 0 ? 0 : (third > 255 ? 255 : third);
+    }
+};
+
+/**
+* @brief Turns a pixel into hue, saturation and value, all 0 to 255 with
+*        a full turn of hue as 256. There are no branches so a block of
+*        pixels can be done with vector instructions
+*/
+struct hsvOp
+{
+    /**
+    * @brief sets the three values to the hue, saturation and value
+    */
+    inline void operator()(int& r, int& g, int& b) const
+    {
+        int high = g > b ? g : b, low = g < b ? g : b;
+        int v = r > high ? r : high;
+        int d = v - (r < low ? r : low);
+        int diff = v == r ? g - b : (v == g ? b - r : r - g);
+        float start = v == r ? 256.0f : (v == g ? 256.0f / 3.0f : 512.0f / 3.0f);
+        float hue = start + float(diff) * (256.0f / 6.0f) / float(d > 1 ? d : 1);
+
+        //a gray pixel has a d of 0 and so a diff of 0 too
+        r = int(hue + 0.5f) & 255;
+        g = int(float(d) * 255.0f / float(v > 1 ? v : 1) + 0.5f);
+        b = v;
+    }
+};
+
+/**
+* @brief Turns hue, saturation and value from hsvOp back into a pixel.
+*        Each value is v less an amount that depends on how far the hue
+*        is from it, worked out without branches
+*/
+struct fromHsvOp
+{
+    /**
+    * @brief how much of the saturation is taken off a value, 0 to 256,
+    *        for the hue in 256ths of a sixth of a turn moved on by k
+    */
+    static inline int weight(int k)
+    {
+        int wrapped = k - 6 * 256, w, other;
+
+        k = k >= 6 * 256 ? wrapped : k;
+        other = 4 * 256 - k;
+        w = k < other ? k : other;
+        w = w > 256 ? 256 : w;
+        return w < 0 ? 0 : w;
+    }
+
+    /**
+    * @brief sets the three values to the red, green and blue
+    */
+    inline void operator()(int& r, int& g, int& b) const
+    {
+        int sixths = r * 6, value = b;
+        int amount = int(divide255(unsigned(b * g)));
+
+        r = value - ((amount * weight(sixths + 5 * 256) + 128) >> 8);
+        g = value - ((amount * weight(sixths + 3 * 256) + 128) >> 8);
+        b = value - ((amount * weight(sixths + 1 * 256) + 128) >> 8);
+    }
+};
+
+/**
+* @brief Passes a pixel through a look up table
+*/
+struct lutOp
+{
+    /**
+    * @brief the look up table
+    */
+    const pixelLut* lut;
+
+    /**
+    * @brief replaces each value by its entry in the table
+    */
+    inline void operator()(int& r, int& g, int& b) const
+    {
+        r = lut->table[0][r];
+        g = lut->table[1][g];
+        b = lut->table[2][b];
+    }
+};
+
+
+/************************************************************************
+ *             Templates
+ ***********************************************************************/
+ /**
+ * @brief A list of operations done one after the other on the same
+ *        pixel, the compiler inlines the whole list into one body
+ */
+template <class... Ops>
+struct pointChain;
+
+/**
+* @brief The empty chain leaves the pixel alone
+*/
+template <>
+struct pointChain<>
+{
+    /**
+    * @brief does nothing
+    */
+    inline void operator()(int&, int&, int&) const
+    {
+    }
+};
+
+/**
+* @brief A chain is its first operation followed by the rest of the chain
+*/
+template <class First, class... Rest>
+struct pointChain<First, Rest...>
+{
+    /**
+    * @brief the first operation
+    */
+    First first;
+    /**
+    * @brief the rest of the chain
+    */
+    pointChain<Rest...> rest;
+
+    /**
+    * @brief runs the first operation then the rest on the same values
+    */
+    inline void operator()(int& r, int& g, int& b) const
+    {
+        first(r, g, b);
+        rest(r, g, b);
+    }
+};
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function joins the given operations into one chain. The type of
+ * the chain names every operation so the compiler builds a separate
+ * loop for every chain.
+ *
+ * @returns the chain of operations
+ *
+ * @par Example:
+   @verbatim
+
+   auto chain = makeChain(sepiaOp(), grayOp());
+   //chain(r, g, b) does sepia then gray
+
+   @endverbatim
+
+ ***********************************************************************/
+inline pointChain<> makeChain()
+{
+    return pointChain<>();
+}
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function joins the given operations into one chain.
+ *
+ * @param[in] first - the first operation
+ * @param[in] rest - the rest of the operations
+ *
+ * @returns the chain of operations
+ *
+ * @par Example:
+   @verbatim
+
+   auto chain = makeChain(sepiaOp(), grayOp());
+
+   @endverbatim
+
+ ***********************************************************************/
+template <class First, class... Rest>
+pointChain<First, Rest...> makeChain(First first, Rest... rest)
+{
+    pointChain<First, Rest...> chain;
+    chain.first = first;
+    chain.rest = makeChain(rest...);
+    return chain;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function runs an operation, or a chain of them, over every pixel
+ * of the image in one loop. Each pixel is read once, goes through every
+ * operation in registers and is written once, so a chain of four
+ * operations moves the same amount of memory as one. A row is done
+ * POINT_BLOCK pixels at a time through local arrays, every array stored
+ * by its own loop, so the compiler knows the arrays do not overlap and
+ * can use vector instructions. The rows are split across threads.
+ *
+ * @param[in, out] img - the structure where the data of the image is stored
+ * @param[in] op - the operation or chain
+ *
+ * @par Example:
+   @verbatim
+
+   image img;
+
+   applyPointOps(img, makeChain(sepiaOp(), grayOp()));
+   //img is now a gray version of its sepia
+
+   @endverbatim
+
+ ***********************************************************************/
+template <class Op>
+void applyPointOps(image& img, const Op& op)
+{
+    int cols = img.cols;
+
+    unshareImage(img);
+    parallelFor(img.rows, [&](int first, int last)
+    {
+        int i, j, k, r[POINT_BLOCK], g[POINT_BLOCK], b[POINT_BLOCK];
+        pixel* red;
+        pixel* green;
+        pixel* blue;
+
+        for (i = first; i < last; i++)
+        {
+            red = img.redGray[i];
+            green = img.green[i];
+            blue = img.blue[i];
+
+            //whole blocks through the local arrays
+            for (j = 0; j + POINT_BLOCK <= cols; j += POINT_BLOCK)
+            {
+                for (k = 0; k < POINT_BLOCK; k++)
+                {
+                    r[k] = red[j + k];
+                    g[k] = green[j + k];
+                    b[k] = blue[j + k];
+                }
+                for (k = 0; k < POINT_BLOCK; k++)
+                {
+                    op(r[k], g[k], b[k]);
+                }
+                for (k = 0; k < POINT_BLOCK; k++)
+                {
+                    red[j + k] = pixel(r[k]);
+                }
+                for (k = 0; k < POINT_BLOCK; k++)
+                {
+                    green[j + k] = pixel(g[k]);
+                }
+                for (k = 0; k < POINT_BLOCK; k++)
+                {
+                    blue[j + k] = pixel(b[k]);
+                }
+            }
+
+            //the rest of the row one pixel at a time
+            for (; j < cols; j++)
+            {
+                r[0] = red[j];
+                g[0] = green[j];
+                b[0] = blue[j];
+                op(r[0], g[0], b[0]);
+                red[j] = pixel(r[0]);
+                green[j] = pixel(g[0]);
+                blue[j] = pixel(b[0]);
+            }
+        }
+    });
+}
+
+
+/************************************************************************
+ *             Structure
+ ***********************************************************************/
+ /**
+ * @brief One operation of a chain read from the command line
+ */
+struct pointStep
+{
+    /**
+    * @brief the operation of the step
+    */
+    stepKind kind;
+    /**
+    * @brief the operation when kind is STEP_MATRIX
+    */
+    matrixOp matrix;
+    /**
+    * @brief the operation when kind is STEP_FIXED
+    */
+    fixedMatrixOp fixed;
+    /**
+    * @brief the table when kind is STEP_LUT
+    */
+    pixelLut lut;
+};
+
+
+/************************************************************************
+ *               Prototypes
+ ***********************************************************************/
+bool ycbcrMatrix(string value, bool inverse, fixedMatrixOp& op);
+bool parseChain(string option, vector<pointStep>& steps);
+void applyChain(image& img, vector<pointStep>& steps);
+bool isGrayChain(string option);
+
+#endif
@@ -0,0 +1,594 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Server mode taking image jobs on a local socket
+ *
+ * @par Protocol:
+ * A client connects to the UNIX domain socket and sends one or more jobs.
+ * Every job is one line of text
+   @verbatim
+   JOB <option> <--binary|--ascii> <path> <length>
+   @endverbatim
+ * option is any image manupulation option or - for none. If path is - the
+ * image is sent inline as length bytes right after the line, otherwise
+ * the image is read from path and length is 0. The server answers
+   @verbatim
+   OK <length>
+   @endverbatim
+ * followed by length bytes of the netPBM output, or
+   @verbatim
+   ERROR <message>
+   @endverbatim
+ * The connection stays open for the next job until the client closes it.
+ ***********************************************************************/
+#include "netPBM.h"
+#include <sstream>
+#include <thread>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <signal.h>
+#include <cstring>
+#endif
+
+/************************************************************************
+ *             Constants
+ ***********************************************************************/
+ /*!
+  * @brief jobs waiting for a worker, per worker, before the connections
+  *        stop reading new ones
+  */
+const int QUEUE_PER_JOB = 4;
+
+/*!
+ * @brief the largest inline image a job can send, in bytes
+ */
+const size_t MAX_INLINE_BYTES = size_t(1) << 30;
+
+
+#ifndef _WIN32
+
+/************************************************************************
+ *             Structure
+ ***********************************************************************/
+ /**
+ * @brief One client connection and the bytes read from it but not used
+ */
+struct connection
+{
+    /**
+    * @brief the socket of the client
+    */
+    int fd;
+    /**
+    * @brief bytes read past the end of the last line
+    */
+    string pending;
+};
+
+/**
+* @brief One job read from a connection and waiting for a worker
+*/
+struct serverJob
+{
+    /**
+    * @brief the socket the answer is sent to
+    */
+    int fd;
+    /**
+    * @brief the image manupulation option, - for none
+    */
+    string option;
+    /**
+    * @brief --binary, --ascii or --qoi
+    */
+    string type;
+    /**
+    * @brief the image file, - for inline bytes
+    */
+    string path;
+    /**
+    * @brief the inline image, owned by the connection
+    */
+    const string* input;
+    /**
+    * @brief true once the answer is sent
+    */
+    bool done;
+    /**
+    * @brief true if the answer could not be sent
+    */
+    bool lost;
+};
+
+/**
+* @brief The jobs waiting for a worker, shared by the connections and the
+*        workers
+*/
+struct jobQueue
+{
+    /**
+    * @brief the jobs in the order they were read
+    */
+    deque<serverJob*> waiting;
+    /**
+    * @brief the most jobs that can wait
+    */
+    size_t limit;
+    /**
+    * @brief guards everything in the queue and the done flag of the jobs
+    */
+    mutex lock;
+    /**
+    * @brief signaled when a job is added
+    */
+    condition_variable hasWork;
+    /**
+    * @brief signaled when a job is taken
+    */
+    condition_variable hasRoom;
+    /**
+    * @brief signaled when a job is answered
+    */
+    condition_variable finished;
+};
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function reads from the connection until it has a full line and
+ * returns the line without the new line.
+ *
+ * @param[in, out] conn - the connection
+ * @param[out] line - the line that was read
+ *
+ * @returns true - if a line was read, false if the client closed
+ *
+ * @par Example:
+   @verbatim
+
+   string line;
+   while (readLine(conn, line))
+   {
+       //handle the line
+   }
+
+   @endverbatim
+
+ ***********************************************************************/
+static bool readLine(connection& conn, string& line)
+{
+    char buffer[4096];
+    ssize_t got;
+    size_t end;
+
+    while ((end = conn.pending.find('\n')) == string::npos)
+    {
+        got = recv(conn.fd, buffer, sizeof(buffer), 0);
+        if (got <= 0)
+        {
+            return false;
+        }
+        conn.pending.append(buffer, size_t(got));
+    }
+
+    line = conn.pending.substr(0, end);
+    conn.pending.erase(0, end + 1);
+    return true;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function reads exactly count bytes from the connection, starting
+ * with any bytes that were read past the last line. The buffer grows as
+ * the bytes arrive, so a length larger than what is sent costs nothing.
+ *
+ * @param[in, out] conn - the connection
+ * @param[in] count - the number of bytes wanted
+ * @param[out] data - the bytes, its capacity is kept between jobs
+ *
+ * @returns true - if all of the bytes were read
+ *
+ * @par Example:
+   @verbatim
+
+   string data;
+   readBytes(conn, 1000, data);
+
+   @endverbatim
+
+ ***********************************************************************/
+static bool readBytes(connection& conn, size_t count, string& data)
+{
+    char buffer[65536];
+    ssize_t got;
+    size_t have;
+
+    have = min(count, conn.pending.size());
+    data.assign(conn.pending, 0, have);
+    conn.pending.erase(0, have);
+
+    while (data.size() < count)
+    {
+        got = recv(conn.fd, buffer, min(sizeof(buffer), count - data.size()), 0);
+        if (got <= 0)
+        {
+            return false;
+        }
+        data.append(buffer, size_t(got));
+    }
+    return true;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function sends all of the bytes to the client.
+ *
+ * @param[in] fd - the socket of the client
+ * @param[in] data - the bytes to send
+ * @param[in] count - the number of bytes
+ *
+ * @returns true - if all of the bytes were sent
+ *
+ * @par Example:
+   @verbatim
+
+   sendAll(conn.fd, "OK 0\n", 5);
+
+   @endverbatim
+
+ ***********************************************************************/
+static bool sendAll(int fd, const char* data, size_t count)
+{
+    ssize_t sent;
+
+    while (count > 0)
+    {
+        sent = send(fd, data, count, 0);
+        if (sent <= 0)
+        {
+            return false;
+        }
+        data += sent;
+        count -= size_t(sent);
+    }
+    return true;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function runs one job. The image is read from the file or from
+ * the inline bytes, the option is handled by processImage and the result
+ * is encoded into the output buffer by handleOutput, the same way main
+ * does it. Errors are returned as a message instead of ending the
+ * server.
+ *
+ * @param[in] option - the image manupulation option, - for none
+ * @param[in] type - --binary, --ascii or --qoi
+ * @param[in] path - the image file, - for inline bytes
+ * @param[in] input - the inline bytes when path is -
+ * @param[in, out] output - the encoded image, kept by the worker
+ * @param[out] error - the message if the job failed
+ *
+ * @returns true - if the job worked and output holds the image
+ *
+ * @par Example:
+   @verbatim
+
+   ostringstream output;
+   string error;
+   runJob("--sepia", "--binary", "image.ppm", "", output, error);
+
+   @endverbatim
+
+ ***********************************************************************/
+static bool runJob(string option, string type, string path, const string& input,
+    ostringstream& output, string& error)
+{
+    image img{};
+    int maxPixel;
+    ifstream fin;
+    istringstream inlineIn;
+    istream* in = &inlineIn;
+    bool worked = false;
+
+    output.str("");
+    output.clear();
+
+    if (!isOutputType(type))
+    {
+        error = "Invalid output type";
+        return false;
+    }
+
+    //open the file or read the inline bytes
+    if (path != "-")
+    {
+        fin.open(path, ios::in | ios::binary);
+        if (!fin.is_open())
+        {
+            error = "Unable to open binary file: " + path;
+            return false;
+        }
+        in = &fin;
+    }
+    else
+    {
+        inlineIn.str(input);
+    }
+
+    try
+    {
+        processImage(*in, option == "-" ? "" : option, img, maxPixel);
+        handleOutput(option, type, img, output, maxPixel);
+        worked = true;
+    }
+    catch (exception& problem)
+    {
+        error = problem.what();
+    }
+
+    clearArray(img.redGray, img.rows);
+    clearArray(img.green, img.rows);
+    clearArray(img.blue, img.rows);
+    return worked;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function runs a job and sends its answer to the client.
+ *
+ * @param[in] job - the job
+ * @param[in, out] output - the encoded image, kept by the worker
+ *
+ * @returns true - if the answer was sent
+ *
+ * @par Example:
+   @verbatim
+
+   ostringstream output;
+   answerJob(*job, output);
+
+   @endverbatim
+
+ ***********************************************************************/
+static bool answerJob(const serverJob& job, ostringstream& output)
+{
+    string error, reply, result;
+
+    if (runJob(job.option, job.type, job.path, *job.input, output, error))
+    {
+        result = output.str();
+        reply = "OK " + to_string(result.size()) + "\n";
+        return sendAll(job.fd, reply.data(), reply.size()) &&
+            sendAll(job.fd, result.data(), result.size());
+    }
+    reply = "ERROR " + error + "\n";
+    return sendAll(job.fd, reply.data(), reply.size());
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function reads jobs from one client on its own thread until the
+ * client closes the connection or sends something that is not a job.
+ * Every job is handed to the queue and the next line is read once its
+ * answer is sent, so the answers come back in order. A client that is
+ * idle only holds this thread, never a worker.
+ *
+ * @param[in] fd - the socket of the client
+ * @param[in, out] queue - the jobs waiting for a worker
+ *
+ * @par Example:
+   @verbatim
+
+   thread(serveConnection, fd, ref(queue)).detach();
+
+   @endverbatim
+
+ ***********************************************************************/
+static void serveConnection(int fd, jobQueue& queue)
+{
+    connection conn;
+    serverJob job;
+    string line, word, input, reply;
+    size_t length;
+
+    conn.fd = fd;
+    job.fd = fd;
+    job.input = &input;
+    while (readLine(conn, line))
+    {
+        istringstream words(line);
+        length = 0;
+        if (!(words >> word >> job.option >> job.type >> job.path >> length) ||
+            word != "JOB" || length > MAX_INLINE_BYTES)
+        {
+            reply = "ERROR Invalid job\n";
+            sendAll(fd, reply.data(), reply.size());
+            break;
+        }
+
+        //inline images come right after the line
+        input.clear();
+        if (job.path == "-" && !readBytes(conn, length, input))
+        {
+            break;
+        }
+
+        //wait for room, then for a worker to answer
+        unique_lock<mutex> guard(queue.lock);
+        queue.hasRoom.wait(guard, [&]() { return queue.waiting.size() < queue.limit; });
+        job.done = false;
+        job.lost = false;
+        queue.waiting.push_back(&job);
+        queue.hasWork.notify_one();
+        queue.finished.wait(guard, [&]() { return job.done; });
+        if (job.lost)
+        {
+            break;
+        }
+    }
+    close(fd);
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function runs the server. It listens on a UNIX domain socket at
+ * path and starts jobs worker threads that stay alive for the life of
+ * the server, each with its own output buffer. Every connection is read
+ * on its own thread and each job it sends waits in a queue for a worker,
+ * so a client that keeps its connection open between jobs never holds a
+ * worker. When the queue is full the connections stop reading jobs until
+ * a worker is free, so the server never takes on more work than it can
+ * do. The image operations inside a job share the warm thread pool of
+ * parallelFor.
+ *
+ * @param[in] path - the path of the socket
+ * @param[in] jobs - the number of jobs run at the same time
+ *
+ * @returns 0 when the server stops
+ *
+ * @par Example:
+   @verbatim
+
+   runServer("/tmp/image.sock", 4);
+   //the server runs until it is killed
+
+   @endverbatim
+
+ ***********************************************************************/
+int runServer(string path, int jobs)
+{
+    int i, listener, client;
+    sockaddr_un address;
+    jobQueue queue;
+    vector<thread> workers;
+
+    if (jobs < 1)
+    {
+        jobs = 1;
+    }
+    queue.limit = size_t(jobs) * QUEUE_PER_JOB;
+
+    //a client going away must not end the server
+    signal(SIGPIPE, SIG_IGN);
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        cout << "Socket path is too long: " << path << endl;
+        return 0;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+    if (listener < 0 || bind(listener, (sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(listener, 128) != 0)
+    {
+        cout << "Unable to listen on socket: " << path << endl;
+        return 0;
+    }
+
+    //warm workers, each keeps its own output buffer from job to job
+    for (i = 0; i < jobs; i++)
+    {
+        workers.push_back(thread([&]()
+        {
+            ostringstream output;
+            serverJob* job;
+            bool sent;
+
+            while (true)
+            {
+                unique_lock<mutex> guard(queue.lock);
+                queue.hasWork.wait(guard, [&]() { return !queue.waiting.empty(); });
+                job = queue.waiting.front();
+                queue.waiting.pop_front();
+                guard.unlock();
+                queue.hasRoom.notify_one();
+
+                sent = answerJob(*job, output);
+
+                guard.lock();
+                job->lost = !sent;
+                job->done = true;
+                guard.unlock();
+                queue.finished.notify_all();
+            }
+        }));
+    }
+
+    cout << "Serving on " << path << " with " << jobs << " jobs" << endl;
+
+    //every client is read on its own thread
+    while (true)
+    {
+        client = accept(listener, nullptr, nullptr);
+        if (client < 0)
+        {
+            continue;
+        }
+        thread(serveConnection, client, ref(queue)).detach();
+    }
+
+    return 0;
+}
+
+#else
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * UNIX domain sockets are not used on Windows, so the server mode only
+ * prints a message.
+ *
+ * @param[in] path - the path of the socket
+ * @param[in] jobs - the number of jobs run at the same time
+ *
+ * @returns 0
+ *
+ * @par Example:
+   @verbatim
+
+   runServer("image.sock", 4);
+   //prints that the server is not available
+
+   @endverbatim
+
+ ***********************************************************************/
+int runServer(string path, int jobs)
+{
+    cout << "Server mode is not available on this platform: " << path
+        << " " << jobs << endl;
+    return 0;
+}
+
+#endif
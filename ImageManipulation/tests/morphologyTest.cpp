@@ -0,0 +1,286 @@
+/** *********************************************************************
+ * @file
+ *
+ * @brief   Checks of erode, dilate, open and close against a plain
+ *          window search
+ ***********************************************************************/
+#include "../netPBM.h"
+#include <random>
+#include <cstring>
+
+/************************************************************************
+ *             Constants
+ ***********************************************************************/
+ /*!
+  * @brief the rectangles checked, width then height
+  */
+const int TEST_SIZES[][2] = { { 1, 1 }, { 2, 2 }, { 3, 3 }, { 4, 3 }, { 2, 5 }, { 6, 6 },
+    { 15, 1 }, { 1, 9 }, { 40, 40 } };
+
+/*!
+ * @brief the images checked, rows then columns
+ */
+const int TEST_IMAGES[][2] = { { 1, 1 }, { 23, 37 }, { 64, 65 }, { 130, 7 }, { 9, 600 } };
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function makes an image of random noise with a few flat squares,
+ * so both specks and shapes larger than the rectangle are in it.
+ *
+ * @param[in] rows - the number of rows
+ * @param[in] cols - the number of columns
+ * @param[in, out] random - the random numbers
+ *
+ * @returns the image, its arrays are cleared by the caller
+ *
+ * @par Example:
+   @verbatim
+
+   mt19937 random(1);
+   image img = makeImage(23, 37, random);
+
+   @endverbatim
+
+ ***********************************************************************/
+static image makeImage(int rows, int cols, mt19937& random)
+{
+    image img{};
+    pixel** planes[3];
+    int i, j, k;
+
+    img.magicNumber = "P6";
+    img.rows = rows;
+    img.cols = cols;
+    img.depth = 3;
+    img.redGray = planes[0] = createArrays(rows, cols);
+    img.green = planes[1] = createArrays(rows, cols);
+    img.blue = planes[2] = createArrays(rows, cols);
+
+    for (k = 0; k < 3; k++)
+    {
+        for (i = 0; i < rows; i++)
+        {
+            for (j = 0; j < cols; j++)
+            {
+                planes[k][i][j] = (i / 8 + j / 8) % 3 == 0 ? pixel(200) : pixel(random());
+            }
+        }
+    }
+    return img;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function erodes or dilates one array by looking at every pixel
+ * of the rectangle of every pixel. Pixels outside of the image are left
+ * out and mirrored turns the rectangle around the pixel, the same as
+ * morphImage.
+ *
+ * @param[in] from - the input array
+ * @param[out] to - the output array
+ * @param[in] rows - the number of rows
+ * @param[in] cols - the number of columns
+ * @param[in] width - the width of the rectangle
+ * @param[in] height - the height of the rectangle
+ * @param[in] erode - true for the minimum, false for the maximum
+ * @param[in] mirrored - true for the rectangle turned around the pixel
+ *
+ * @par Example:
+   @verbatim
+
+   slowMorph(img.redGray, out, img.rows, img.cols, 3, 3, true, false);
+
+   @endverbatim
+
+ ***********************************************************************/
+static void slowMorph(pixel** from, pixel** to, int rows, int cols, int width, int height,
+    bool erode, bool mirrored)
+{
+    int i, j, y, x, best;
+    int left = mirrored ? width - 1 - width / 2 : width / 2;
+    int top = mirrored ? height - 1 - height / 2 : height / 2;
+
+    for (i = 0; i < rows; i++)
+    {
+        for (j = 0; j < cols; j++)
+        {
+            best = erode ? 255 : 0;
+            for (y = max(i - top, 0); y < min(i - top + height, rows); y++)
+            {
+                for (x = max(j - left, 0); x < min(j - left + width, cols); x++)
+                {
+                    best = erode ? min(best, int(from[y][x])) : max(best, int(from[y][x]));
+                }
+            }
+            to[i][j] = pixel(best);
+        }
+    }
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * This function runs an operation with morphImage and with slowMorph on
+ * copies of the same image and tells if they agree. An open or close is
+ * also checked to never move a pixel the wrong way and to not change
+ * the image when it is done a second time.
+ *
+ * @param[in] source - the image, it is not changed
+ * @param[in] operation - erode, dilate, open or close
+ * @param[in] width - the width of the rectangle
+ * @param[in] height - the height of the rectangle
+ *
+ * @returns the number of failed checks, printed on the standard output
+ *
+ * @par Example:
+   @verbatim
+
+   int failed = checkMorph(img, "open", 4, 3);
+
+   @endverbatim
+
+ ***********************************************************************/
+static int checkMorph(const image& source, string operation, int width, int height)
+{
+    image fast = source, twice = source;
+    pixel** planes[3] = { source.redGray, source.green, source.blue };
+    pixel** slow = createArrays(source.rows, source.cols);
+    pixel** spare = createArrays(source.rows, source.cols);
+    pixel** got[3];
+    pixel** again[3];
+    bool erode = operation == "erode" || operation == "open";
+    bool twoHalves = operation == "open" || operation == "close";
+    bool differs = false, moved = false, changed = false;
+    int i, j, k, failed = 0;
+
+    fast.redGray = got[0] = createArrays(source.rows, source.cols);
+    fast.green = got[1] = createArrays(source.rows, source.cols);
+    fast.blue = got[2] = createArrays(source.rows, source.cols);
+    twice.redGray = again[0] = createArrays(source.rows, source.cols);
+    twice.green = again[1] = createArrays(source.rows, source.cols);
+    twice.blue = again[2] = createArrays(source.rows, source.cols);
+    for (k = 0; k < 3; k++)
+    {
+        copyArray(got[k], planes[k], source);
+    }
+    morphImage(fast, operation, width, height);
+    got[0] = fast.redGray;
+    got[1] = fast.green;
+    got[2] = fast.blue;
+
+    for (k = 0; k < 3; k++)
+    {
+        slowMorph(planes[k], slow, source.rows, source.cols, width, height, erode, false);
+        if (twoHalves)
+        {
+            slowMorph(slow, spare, source.rows, source.cols, width, height, !erode, true);
+            swap(slow, spare);
+        }
+        copyArray(again[k], got[k], source);
+        for (i = 0; i < source.rows; i++)
+        {
+            for (j = 0; j < source.cols; j++)
+            {
+                differs = differs || got[k][i][j] != slow[i][j];
+                moved = moved || (operation == "open" && got[k][i][j] > planes[k][i][j]) ||
+                    (operation == "close" && got[k][i][j] < planes[k][i][j]);
+            }
+        }
+    }
+
+    if (twoHalves)
+    {
+        morphImage(twice, operation, width, height);
+        again[0] = twice.redGray;
+        again[1] = twice.green;
+        again[2] = twice.blue;
+        for (k = 0; k < 3; k++)
+        {
+            for (i = 0; i < source.rows; i++)
+            {
+                changed = changed || memcmp(again[k][i], got[k][i], size_t(source.cols)) != 0;
+            }
+        }
+    }
+
+    if (differs)
+    {
+        cout << "FAIL " << operation << " " << width << "x" << height << " on "
+            << source.cols << "x" << source.rows << " differs from the window search" << endl;
+        failed++;
+    }
+    if (moved)
+    {
+        cout << "FAIL " << operation << " " << width << "x" << height << " on "
+            << source.cols << "x" << source.rows << " moved a pixel the wrong way" << endl;
+        failed++;
+    }
+    if (changed)
+    {
+        cout << "FAIL a second " << operation << " " << width << "x" << height << " on "
+            << source.cols << "x" << source.rows << " changed the image" << endl;
+        failed++;
+    }
+
+    for (k = 0; k < 3; k++)
+    {
+        clearArray(got[k], source.rows);
+        clearArray(again[k], source.rows);
+    }
+    clearArray(slow, source.rows);
+    clearArray(spare, source.rows);
+    return failed;
+}
+
+
+/** *********************************************************************
+ * @author Niven Fernandes
+ *
+ * @par Description:
+ * Runs every operation with every rectangle on every test image and
+ * prints the checks that failed.
+ *
+ * @returns 0 if every check passed, 1 otherwise
+ *
+ * @par Example:
+   @verbatim
+
+   C:\> morphologyTest.exe
+   morphology: 144 runs, 0 failed
+
+   @endverbatim
+
+ ***********************************************************************/
+int main()
+{
+    const string operations[] = { "erode", "dilate", "open", "close" };
+    mt19937 random(12345);
+    int runs = 0, failed = 0;
+
+    for (const auto& shape : TEST_IMAGES)
+    {
+        image img = makeImage(shape[0], shape[1], random);
+        for (const auto& size : TEST_SIZES)
+        {
+            for (const string& operation : operations)
+            {
+                failed += checkMorph(img, operation, size[0], size[1]);
+                runs++;
+            }
+        }
+        clearArray(img.redGray, img.rows);
+        clearArray(img.green, img.rows);
+        clearArray(img.blue, img.rows);
+    }
+
+    cout << "morphology: " << runs << " runs, " << failed << " failed" << endl;
+    return failed == 0 ? 0 : 1;
+}